@@ -0,0 +1,41 @@
+#version 450
+
+// CompactVertex12/CompactVertex8: unorm16 position inside the mesh bounds, snorm octahedral normal
+layout (location = 0) in vec3 vPosition;
+layout (location = 1) in vec2 vNormal;
+
+
+layout(std140, binding = 0) uniform constants {
+  mat4 camera;
+  mat4 mvp;
+  mat4 normalMat;
+  vec4 lightPosition;
+};
+
+// xyz: bounds min and extent from VertexQuantization
+layout(std140, binding = 2) uniform quantizationConstants {
+  vec4 positionOffset;
+  vec4 positionScale;
+};
+
+
+out vec3 eye_vPosition;
+out vec3 eye_LightPosition;
+out vec3 eye_normal;
+
+vec3 octahedralDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy -= t * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+
+void main()
+{
+  vec4 position = vec4(positionOffset.xyz + vPosition * positionScale.xyz, 1.0);
+  gl_Position = mvp * position;
+  eye_vPosition = vec3(camera * position);
+  eye_LightPosition = vec3(camera * lightPosition);
+  eye_normal = vec3(normalMat * vec4(octahedralDecode(vNormal), 0.0));
+}
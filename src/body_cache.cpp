@@ -0,0 +1,536 @@
+#include "body_cache.hpp"
+
+#include "mesh_cache.hpp"
+#include "mesh_normals.hpp"
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+
+constexpr u64 STREAM_ALIGNMENT = 16;
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+
+u64 AlignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool WritePadding(FILE *fp, u64 from, u64 to)
+{
+    static constexpr u8 ZEROS[STREAM_ALIGNMENT] = {};
+    return fwrite(ZEROS, 1, to - from, fp) == to - from;
+}
+
+template<typename T>
+std::span<const u8> StreamBytes(const std::vector<T> &values)
+{
+    return utils::AsBytes(std::span<const T>(values));
+}
+
+// Boundary of the dual cells, the cubes between 8 voxel centers, whose corners are all solid. Every corner of a
+// boundary face is also a corner of an outside cell and so within one voxel of empty space, which keeps it in any
+// shell. Faces are emitted from the row of their lowest corner, so concatenating the ranges keeps them in order.
+template<typename F>
+std::vector<glm::uvec3> BuildPressureTriangles(const VoxelGrid &solid, F &&particle_index)
+{
+    const glm::uvec3 dimensions = solid.Dimensions();
+    const Size row_count = (Size)dimensions.y * dimensions.z;
+    // Cell (x, y, z) has its lowest corner at voxel (x, y, z), the last layer along each axis stays empty
+    VoxelGrid cells(dimensions, solid.Origin(), solid.VoxelSize());
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            if (y + 1 >= dimensions.y || z + 1 >= dimensions.z) {
+                return;
+            }
+            const std::span<const u64> corner_rows[] = {
+                solid.Row(y, z), solid.Row(y + 1, z), solid.Row(y, z + 1), solid.Row(y + 1, z + 1)};
+            const auto out = cells.Row(y, z);
+            for (Size word = 0; word < out.size(); word++) {
+                u64 inside = ~0ull;
+                for (const auto &corners : corner_rows) {
+                    // The padding bits past dimensions.x are zero, which clears the last cell
+                    const u64 next = (corners[word] >> 1) | (word + 1 < out.size() ? corners[word + 1] << 63 : 0);
+                    inside &= corners[word] & next;
+                }
+                out[word] = inside;
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+
+    std::vector<std::vector<glm::uvec3>> range_triangles(WorkerCount());
+    const u32 range_count = ParallelForRanges(
+        row_count,
+        [&](Size begin, Size end, u32 range) {
+            auto &triangles = range_triangles[range];
+            // Quad at corner spanning the two other axes, facing +axis or -axis
+            const auto add_quad = [&](glm::uvec3 corner, u32 axis, bool positive) {
+                glm::uvec3 b(0), c(0);
+                b[(axis + 1) % 3] = 1;
+                c[(axis + 2) % 3] = 1;
+                const u32 quad[4] = {particle_index(corner), particle_index(corner + b), particle_index(corner + b + c),
+                    particle_index(corner + c)};
+                if (positive) {
+                    triangles.push_back({quad[0], quad[1], quad[2]});
+                    triangles.push_back({quad[0], quad[2], quad[3]});
+                } else {
+                    triangles.push_back({quad[0], quad[2], quad[1]});
+                    triangles.push_back({quad[0], quad[3], quad[2]});
+                }
+            };
+            for (Size row = begin; row < end; row++) {
+                const u32 y = (u32)(row % dimensions.y);
+                const u32 z = (u32)(row / dimensions.y);
+                const auto inside = cells.Row(y, z);
+                const auto below_y = y > 0 ? cells.Row(y - 1, z) : std::span<const u64>();
+                const auto below_z = z > 0 ? cells.Row(y, z - 1) : std::span<const u64>();
+                for (u32 word = 0; word < inside.size(); word++) {
+                    // Cells on the lower side of each face, the face is outward positive when they are the inside
+                    const u64 lower[3] = {
+                        (inside[word] << 1) | (word > 0 ? inside[word - 1] >> 63 : 0),
+                        below_y.empty() ? 0 : below_y[word],
+                        below_z.empty() ? 0 : below_z[word],
+                    };
+                    for (u32 axis = 0; axis < 3; axis++) {
+                        for (u64 bits = inside[word] ^ lower[axis]; bits != 0; bits &= bits - 1) {
+                            const u32 bit = (u32)std::countr_zero(bits);
+                            add_quad({word * 64 + bit, y, z}, axis, (lower[axis] >> bit) & 1);
+                        }
+                    }
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+
+    std::vector<glm::uvec3> triangles;
+    for (u32 range = 0; range < range_count; range++) {
+        triangles.insert(triangles.end(), range_triangles[range].begin(), range_triangles[range].end());
+    }
+    return triangles;
+}
+
+} // namespace
+
+GridPlacement BodyLatticePlacement(const VoxelGrid &grid)
+{
+    return {grid.Dimensions() - 1u, grid.Origin() + grid.VoxelSize() * 0.5f, grid.VoxelSize()};
+}
+
+void ScatterParticlesToNodes(
+    std::span<const u32> particle_voxels, std::span<const glm::vec3> particles, std::span<glm::vec3> nodes)
+{
+    ParallelFor(
+        FrameWorkers(), particles.size(),
+        [&](Size particle) { nodes[particle_voxels[particle]] = particles[particle]; }, 4096);
+}
+
+f32 EnclosedVolume(std::span<const glm::vec3> particles, std::span<const glm::uvec3> triangles)
+{
+    if (triangles.empty()) {
+        return 0.0f;
+    }
+    // Signed tetrahedra from any point to every triangle, one on the surface keeps the terms small
+    const glm::vec3 apex = particles[triangles[0].x];
+    f64 volume = 0.0;
+    for (const glm::uvec3 &triangle : triangles) {
+        const glm::vec3 a = particles[triangle.x] - apex;
+        const glm::vec3 b = particles[triangle.y] - apex;
+        const glm::vec3 c = particles[triangle.z] - apex;
+        volume += glm::dot(a, glm::cross(b, c));
+    }
+    return (f32)(volume / 6.0);
+}
+
+SimulationBody BuildSimulationBody(const Mesh &mesh, const BodyOptions &options, VoxelCleanupReport *cleanup_report)
+{
+    VoxelGrid occupancy = CreateGridForBounds(ComputeBounds(mesh.vertices), options.resolution);
+    VoxelizeSolid(mesh, occupancy, options.fill_mode);
+    return BuildSimulationBody(mesh, std::move(occupancy), options, cleanup_report);
+}
+
+SimulationBody BuildSimulationBody(
+    const Mesh &mesh, VoxelGrid occupancy, const BodyOptions &options, VoxelCleanupReport *cleanup_report)
+{
+    SimulationBody body;
+    body.occupancy = std::move(occupancy);
+    // Signs come from the solid as voxelized, before cleanup and hollowing change it
+    if (options.build_distance_field) {
+        body.distances =
+            BuildSignedDistanceField(mesh, body.occupancy, {.band_voxels = options.distance_band_voxels});
+    }
+    const VoxelCleanupReport report = CleanUpVoxels(body.occupancy, options.cleanup);
+    if (cleanup_report) {
+        *cleanup_report = report;
+    }
+    // The pressure triangles close around the solid from before hollowing and before the embedding nodes join it
+    VoxelGrid solid;
+    if (options.build_volume_term) {
+        solid = body.occupancy;
+    }
+    if (options.shell_voxels > 0) {
+        body.occupancy = ShellVoxels(body.occupancy, options.shell_voxels);
+    }
+    VoxelGrid &grid = body.occupancy;
+    const glm::uvec3 dimensions = grid.Dimensions();
+    body.embedding = EmbedInLattice(mesh.vertices, BodyLatticePlacement(grid));
+    // A node without a particle would stay at rest while the body moves, so the 8 nodes around every embedded vertex
+    // get one. Near the surface these are up to a voxel outside the solid, inside a shell they fill the gaps.
+    const u32 corner_offsets[8] = {0, 1, dimensions.x, dimensions.x + 1, dimensions.x * dimensions.y,
+        dimensions.x * dimensions.y + 1, dimensions.x * dimensions.y + dimensions.x,
+        dimensions.x * dimensions.y + dimensions.x + 1};
+    ParallelFor(
+        body.embedding.vertices.size(),
+        [&](Size vertex) {
+            for (const u32 offset : corner_offsets) {
+                const u32 node = body.embedding.vertices[vertex].base_node + offset;
+                grid.SetAtomic(node % dimensions.x, (node / dimensions.x) % dimensions.y,
+                    node / (dimensions.x * dimensions.y));
+            }
+        },
+        4096);
+
+    // Particle of a voxel is the number of solid voxels before it
+    const Size row_count = (Size)dimensions.y * dimensions.z;
+    std::vector<u32> row_first_particle(row_count + 1, 0);
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            u32 count = 0;
+            for (const u64 word : grid.Row((u32)(row % dimensions.y), (u32)(row / dimensions.y))) {
+                count += (u32)std::popcount(word);
+            }
+            row_first_particle[row + 1] = count;
+        },
+        MIN_ROWS_PER_RANGE);
+    std::inclusive_scan(row_first_particle.begin(), row_first_particle.end(), row_first_particle.begin());
+    const auto particle_index = [&](glm::uvec3 voxel) {
+        const auto row = grid.Row(voxel.y, voxel.z);
+        u32 index = row_first_particle[(Size)voxel.z * dimensions.y + voxel.y];
+        for (u32 word = 0; word < voxel.x / 64; word++) {
+            index += (u32)std::popcount(row[word]);
+        }
+        return index + (u32)std::popcount(row[voxel.x / 64] & ((1ull << (voxel.x % 64)) - 1));
+    };
+
+    body.rest_particles.resize(row_first_particle.back());
+    body.particle_voxels.resize(row_first_particle.back());
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            const auto words = grid.Row(y, z);
+            u32 particle = row_first_particle[row];
+            for (u32 word = 0; word < words.size(); word++) {
+                for (u64 bits = words[word]; bits != 0; bits &= bits - 1) {
+                    const u32 x = word * 64 + (u32)std::countr_zero(bits);
+                    body.rest_particles[particle] = grid.VoxelCenter(x, y, z);
+                    body.particle_voxels[particle] = (u32)(row * dimensions.x + x);
+                    particle++;
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+
+    // Concatenating the ranges in order keeps the constraints in voxel order no matter how many workers ran
+    std::vector<std::vector<RestConstraint>> range_constraints(WorkerCount());
+    const u32 range_count = ParallelForRanges(
+        row_count,
+        [&](Size begin, Size end, u32 range) {
+            ForEachNeighborPair(grid, options.constraint_connectivity, begin, end, [&](glm::uvec3 a, glm::uvec3 b) {
+                const f32 rest_length = glm::length(glm::vec3(b) - glm::vec3(a)) * grid.VoxelSize();
+                range_constraints[range].push_back({particle_index(a), particle_index(b), rest_length});
+            });
+        },
+        MIN_ROWS_PER_RANGE);
+    for (u32 range = 0; range < range_count; range++) {
+        body.constraints.insert(
+            body.constraints.end(), range_constraints[range].begin(), range_constraints[range].end());
+    }
+
+    if (options.build_volume_term) {
+        body.pressure_triangles = BuildPressureTriangles(solid, particle_index);
+        body.rest_volume = EnclosedVolume(body.rest_particles, body.pressure_triangles);
+    }
+    body.densities.assign(body.rest_particles.size(), options.material.density);
+    body.stiffnesses.assign(body.rest_particles.size(), options.material.stiffness);
+    return body;
+}
+
+std::optional<BodyCache> BodyCache::Open(const char *cache_path, u64 key)
+{
+    BodyCache cache;
+    cache.m_file = utils::MappedFile(cache_path, utils::FileAccessHint::WillNeed);
+    if (!cache.m_file.IsValid()) {
+        return std::nullopt;
+    }
+
+    const auto bytes = cache.m_file.Bytes();
+    if (bytes.size() < sizeof(BodyCacheHeader)) {
+        return std::nullopt;
+    }
+    const auto *header = (const BodyCacheHeader *)bytes.data();
+    if (header->magic != BodyCacheHeader::MAGIC || header->version != BodyCacheHeader::VERSION
+        || header->key != key) {
+        return std::nullopt;
+    }
+    const auto fits = [&](const BodyCacheStream &stream, u64 element_size) {
+        return stream.offset % STREAM_ALIGNMENT == 0 && stream.offset <= bytes.size()
+               && stream.count <= (bytes.size() - stream.offset) / element_size;
+    };
+    const glm::uvec3 dimensions = header->dimensions;
+    const u64 voxel_count = (u64)dimensions.x * dimensions.y * dimensions.z;
+    if (!fits(header->occupancy, 1) || !fits(header->distances, sizeof(f32))
+        || !fits(header->embedding, sizeof(EmbeddedVertex)) || !fits(header->rest_particles, sizeof(glm::vec3))
+        || !fits(header->particle_voxels, sizeof(u32)) || !fits(header->constraints, sizeof(RestConstraint))
+        || !fits(header->pressure_triangles, sizeof(glm::uvec3))
+        || !fits(header->voxelized, 1)
+        || (header->distances.count != 0 && header->distances.count != voxel_count)
+        || header->particle_voxels.count != header->rest_particles.count) {
+        printf("Ignoring malformed body cache %s\n", cache_path);
+        return std::nullopt;
+    }
+    auto occupancy = CompressedVoxels::Deserialize(bytes.subspan(header->occupancy.offset, header->occupancy.count));
+    auto voxelized = CompressedVoxels::Deserialize(bytes.subspan(header->voxelized.offset, header->voxelized.count));
+    if (!occupancy || !voxelized || occupancy->Dimensions() != dimensions || voxelized->Dimensions() != dimensions
+        || occupancy->SolidCount() != header->rest_particles.count) {
+        printf("Ignoring malformed body cache %s\n", cache_path);
+        return std::nullopt;
+    }
+    cache.m_header = header;
+    cache.m_occupancy = std::move(*occupancy);
+    cache.m_voxelized = std::move(*voxelized);
+    return cache;
+}
+
+GridPlacement BodyCache::Placement() const
+{
+    return {m_header->dimensions, m_header->origin, m_header->voxel_size};
+}
+
+SimulationBody BodyCache::ToBody() const
+{
+    SimulationBody body;
+    const GridPlacement placement = Placement();
+    body.occupancy = m_occupancy.DecodeOccupancy();
+    body.densities.resize(m_occupancy.SolidCount());
+    body.stiffnesses.resize(m_occupancy.SolidCount());
+    m_occupancy.DecodeSolidMaterials(body.densities, body.stiffnesses);
+    if (!Distances().empty()) {
+        body.distances = DistanceGrid(placement.dimensions, placement.origin, placement.voxel_size);
+        std::ranges::copy(Distances(), body.distances.Values().begin());
+    }
+    body.embedding.node_dimensions = NodeDimensions();
+    body.embedding.vertices.assign(Embedding().begin(), Embedding().end());
+    body.rest_particles.assign(RestParticles().begin(), RestParticles().end());
+    body.particle_voxels.assign(ParticleVoxels().begin(), ParticleVoxels().end());
+    body.constraints.assign(Constraints().begin(), Constraints().end());
+    body.pressure_triangles.assign(PressureTriangles().begin(), PressureTriangles().end());
+    body.rest_volume = RestVolume();
+    return body;
+}
+
+VoxelBody BodyCache::ToVoxelBody(u32 resolution, SolidFillMode mode) const
+{
+    return VoxelBody(m_voxelized.DecodeOccupancy(), resolution, mode);
+}
+
+std::string BodyCachePath(const std::string &source_path, u64 mesh_seed, const BodyOptions &options)
+{
+    char key_hex[17];
+    snprintf(key_hex, sizeof(key_hex), "%llx", (unsigned long long)BodyCacheKey(mesh_seed, options));
+    return source_path + "." + key_hex + ".bodycache";
+}
+
+u64 BodyCacheKey(u64 source_hash, const BodyOptions &options)
+{
+    // Field by field, struct padding would make the key depend on garbage
+    const u64 fields[] = {
+        BodyCacheHeader::VERSION,
+        options.resolution,
+        (u64)options.fill_mode,
+        (u64)options.cleanup.connectivity,
+        options.cleanup.keep_largest_only,
+        options.cleanup.min_component_voxels,
+        options.cleanup.fill_cavities,
+        (u64)options.constraint_connectivity,
+        options.build_distance_field,
+        options.distance_band_voxels,
+        options.shell_voxels,
+        options.build_volume_term,
+        std::bit_cast<u32>(options.material.density),
+        std::bit_cast<u32>(options.material.stiffness),
+    };
+    return utils::HashBytes(utils::AsBytes(std::span<const u64>(fields)), source_hash);
+}
+
+bool WriteBodyCache(const char *cache_path, const SimulationBody &body, const VoxelGrid &voxelized, u64 key)
+{
+    const VoxelGrid &grid = body.occupancy;
+    assert(voxelized.Dimensions() == grid.Dimensions());
+    assert(body.densities.size() == body.particle_voxels.size() && body.stiffnesses.size() == body.densities.size());
+    // Particle materials go in as the materials of their voxels, one for the whole grid while every particle has it
+    std::optional<CompressedVoxels> occupancy;
+    VoxelMaterial first;
+    if (!body.densities.empty()) {
+        first = {body.densities[0], body.stiffnesses[0]};
+    }
+    bool uniform = true;
+    for (Size particle = 0; particle < body.densities.size() && uniform; particle++) {
+        uniform = VoxelMaterial{body.densities[particle], body.stiffnesses[particle]} == first;
+    }
+    if (uniform) {
+        occupancy = CompressedVoxels::Compress(grid, first);
+    } else {
+        const glm::uvec3 dimensions = grid.Dimensions();
+        std::vector<VoxelMaterial> materials((Size)dimensions.x * dimensions.y * dimensions.z);
+        for (Size particle = 0; particle < body.particle_voxels.size(); particle++) {
+            materials[body.particle_voxels[particle]] = {body.densities[particle], body.stiffnesses[particle]};
+        }
+        occupancy = CompressedVoxels::Compress(grid, materials);
+    }
+    const auto compressed_voxelized = CompressedVoxels::Compress(voxelized, VoxelMaterial{});
+    if (!occupancy || !compressed_voxelized) {
+        printf("Failed to write body cache %s, too many materials\n", cache_path);
+        return false;
+    }
+    const std::vector<u8> occupancy_bytes = occupancy->Serialize();
+    const std::vector<u8> voxelized_bytes = compressed_voxelized->Serialize();
+
+    BodyCacheHeader header = {
+        .key = key,
+        .dimensions = grid.Dimensions(),
+        .voxel_size = grid.VoxelSize(),
+        .origin = grid.Origin(),
+        .node_dimensions = body.embedding.node_dimensions,
+        .rest_volume = body.rest_volume,
+        // Streams are laid out below
+        .occupancy = {},
+        .distances = {},
+        .embedding = {},
+        .rest_particles = {},
+        .particle_voxels = {},
+        .constraints = {},
+        .pressure_triangles = {},
+        .voxelized = {},
+    };
+    const std::span<const u8> streams[] = {
+        StreamBytes(occupancy_bytes),
+        utils::AsBytes(body.distances.Values()),
+        StreamBytes(body.embedding.vertices),
+        StreamBytes(body.rest_particles),
+        StreamBytes(body.particle_voxels),
+        StreamBytes(body.constraints),
+        StreamBytes(body.pressure_triangles),
+        StreamBytes(voxelized_bytes),
+    };
+    BodyCacheStream *descriptors[] = {&header.occupancy, &header.distances, &header.embedding, &header.rest_particles,
+        &header.particle_voxels, &header.constraints, &header.pressure_triangles, &header.voxelized};
+    const u64 element_sizes[] = {1, sizeof(f32), sizeof(EmbeddedVertex), sizeof(glm::vec3), sizeof(u32),
+        sizeof(RestConstraint), sizeof(glm::uvec3), 1};
+    u64 offset = sizeof(BodyCacheHeader);
+    for (u32 i = 0; i < std::size(streams); i++) {
+        offset = AlignUp(offset, STREAM_ALIGNMENT);
+        *descriptors[i] = {offset, streams[i].size() / element_sizes[i]};
+        offset += streams[i].size();
+    }
+
+    // Not fatal, the body just gets built again next time. Moved over the old cache once complete, same as the mesh
+    // cache.
+    const std::string temporary_path = utils::TemporaryPathFor(cache_path);
+    FILE *fp = fopen(temporary_path.c_str(), "wb");
+    if (!fp) {
+        printf("Failed to write body cache %s\n", cache_path);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    u64 written = sizeof(header);
+    for (u32 i = 0; i < std::size(streams); i++) {
+        ok = ok && WritePadding(fp, written, descriptors[i]->offset);
+        ok = ok && fwrite(streams[i].data(), 1, streams[i].size(), fp) == streams[i].size();
+        written = descriptors[i]->offset + streams[i].size();
+    }
+    ok = fclose(fp) == 0 && ok;
+    ok = ok && utils::MoveFileOver(temporary_path.c_str(), cache_path);
+    if (!ok) {
+        printf("Failed to write body cache %s\n", cache_path);
+        remove(temporary_path.c_str());
+    }
+    return ok;
+}
+
+void BenchmarkBodyCache(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto milliseconds = [](Clock::time_point start) {
+        return std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+    };
+
+    const BodyOptions options = {.resolution = resolution, .cleanup = {}, .material = {}};
+    printf("%-24s %10s %12s %12s %10s %10s %10s\n", "file", "particles", "constraints", "build ms", "write ms",
+        "open ms", "MB");
+    for (const auto &path : paths) {
+        // Cache files go to the temp directory rather than next to the test data
+        const std::string cache_path =
+            BodyCachePath((std::filesystem::temp_directory_path() / path.filename()).string(), 0, options);
+
+        auto start = Clock::now();
+        Mesh mesh = LoadObjParallel(path.string().c_str());
+        if (!HasNormals(mesh)) {
+            GenerateNormals(mesh);
+        }
+        const u64 key = BodyCacheKey(HashSourceFile(path.string().c_str()), options);
+        const VoxelBody voxels(mesh, options.resolution, options.fill_mode);
+        const SimulationBody body = BuildSimulationBody(mesh, voxels.Occupancy(), options);
+        const f64 build_ms = milliseconds(start);
+
+        start = Clock::now();
+        WriteBodyCache(cache_path.c_str(), body, voxels.Occupancy(), key);
+        const f64 write_ms = milliseconds(start);
+
+        // What a second run pays: hashing the source, mapping the cache and rebuilding the pyramid
+        f64 open_ms = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            start = Clock::now();
+            const std::optional<BodyCache> cache =
+                BodyCache::Open(cache_path.c_str(), BodyCacheKey(HashSourceFile(path.string().c_str()), options));
+            const VoxelBody cached_voxels =
+                cache ? cache->ToVoxelBody(options.resolution, options.fill_mode) : VoxelBody();
+            open_ms = std::min(open_ms, milliseconds(start));
+            if (!cache || cache->Constraints().size() != body.constraints.size()
+                || cached_voxels.Pyramid().LevelCount() != voxels.Pyramid().LevelCount()) {
+                printf("Body cache %s didn't round trip\n", cache_path.c_str());
+            }
+        }
+
+        printf("%-24s %10zu %12zu %12.3f %10.3f %10.3f %10.2f\n", path.filename().string().c_str(),
+            body.rest_particles.size(), body.constraints.size(), build_ms, write_ms, open_ms,
+            (f64)std::filesystem::file_size(cache_path) / (1024.0 * 1024.0));
+        std::filesystem::remove(cache_path);
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "lattice_embedding.hpp"
+#include "signed_distance.hpp"
+#include "utils.hpp"
+#include "voxel_components.hpp"
+#include "voxel_compression.hpp"
+#include "voxel_grid.hpp"
+#include "voxel_morphology.hpp"
+#include "voxel_neighbors.hpp"
+#include "voxel_pyramid.hpp"
+#include "voxelizer.hpp"
+
+#include <glm/vec3.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Everything that goes into a body. All of it is part of the cache key, so changing any field rebuilds the body.
+struct BodyOptions {
+    // Voxels across the longest axis of the mesh, one particle per solid voxel
+    u32 resolution = 32;
+    SolidFillMode fill_mode = SolidFillMode::Parity;
+    VoxelCleanupOptions cleanup;
+    // Neighbours that get a distance constraint between their particles
+    Connectivity constraint_connectivity = Connectivity::Edge18;
+    bool build_distance_field = true;
+    u32 distance_band_voxels = 2;
+    // Keep only the outer layers of the solid, see ShellVoxels, so particles grow with the surface rather than the
+    // volume. 0 keeps the body solid.
+    u32 shell_voxels = 0;
+    // Build the pressure triangles, mostly useful together with shell_voxels where nothing else holds the volume
+    bool build_volume_term = false;
+    // Meshes don't carry voxel materials yet, so every particle gets this one
+    VoxelMaterial material;
+};
+
+struct RestConstraint {
+    u32 a;
+    u32 b;
+    f32 rest_length;
+};
+
+// A voxelized mesh ready to simulate. The render mesh is embedded in the lattice whose nodes are the voxel centers,
+// node i being voxel i. Particles sit at the centers of the solid voxels plus every node the embedding reads, in
+// (z, y, x) order. A frame scatters the particles into the nodes with ScatterParticlesToNodes, then DeformEmbedded
+// moves the render mesh along.
+struct SimulationBody {
+    // Solid voxels and embedding nodes, one particle each
+    VoxelGrid occupancy;
+    // Empty unless BodyOptions::build_distance_field
+    DistanceGrid distances;
+    LatticeEmbedding embedding;
+    std::vector<glm::vec3> rest_particles;
+    std::vector<u32> particle_voxels;
+    std::vector<RestConstraint> constraints;
+    // Empty unless BodyOptions::build_volume_term. Outward facing triangles over particles that close around the
+    // solid before hollowing, EnclosedVolume of the deformed particles against rest_volume gives a pressure or volume
+    // constraint.
+    std::vector<glm::uvec3> pressure_triangles;
+    f32 rest_volume = 0.0f;
+    // One per particle, what a solver reads for the particle's mass and its constraints' compliance
+    std::vector<f32> densities;
+    std::vector<f32> stiffnesses;
+};
+
+// cleanup_report, when given, receives what CleanUpVoxels found before the particles were set up
+SimulationBody BuildSimulationBody(
+    const Mesh &mesh, const BodyOptions &options, VoxelCleanupReport *cleanup_report = nullptr);
+// Same from an occupancy that is already voxelized, usually a VoxelBody's, which takes the place of
+// options.resolution. After VoxelBody::SetResolution to something coarser this only redoes the steps after
+// voxelization.
+SimulationBody BuildSimulationBody(const Mesh &mesh, VoxelGrid occupancy, const BodyOptions &options,
+    VoxelCleanupReport *cleanup_report = nullptr);
+// Lattice the embedding of a body on grid refers to
+GridPlacement BodyLatticePlacement(const VoxelGrid &grid);
+// nodes[particle_voxels[i]] = particles[i]. Every node the embedding reads has a particle, so the other nodes only
+// need to exist, e.g. LatticeRestNodes(BodyLatticePlacement(occupancy)) once.
+void ScatterParticlesToNodes(
+    std::span<const u32> particle_voxels, std::span<const glm::vec3> particles, std::span<glm::vec3> nodes);
+// Volume inside closed, outward facing triangles
+f32 EnclosedVolume(std::span<const glm::vec3> particles, std::span<const glm::uvec3> triangles);
+
+// Binary body cache written next to the source file, same conventions as MeshCacheHeader: the header is followed by
+// one 16 byte aligned stream per array, so everything is used straight from the mapping.
+struct BodyCacheStream {
+    u64 offset = 0;
+    u64 count = 0;
+};
+
+struct BodyCacheHeader {
+    static constexpr u32 MAGIC = 0x42425356; // "VSBB"
+    static constexpr u32 VERSION = 4;
+
+    u32 magic = MAGIC;
+    u32 version = VERSION;
+    u64 key = 0;
+    glm::uvec3 dimensions = {};
+    f32 voxel_size = 0.0f;
+    glm::vec3 origin = {};
+    u32 padding = 0;
+    glm::uvec3 node_dimensions = {};
+    f32 rest_volume = 0.0f;
+    // Serialized CompressedVoxels with the particle materials, count is in bytes
+    BodyCacheStream occupancy;
+    BodyCacheStream distances;
+    BodyCacheStream embedding;
+    BodyCacheStream rest_particles;
+    BodyCacheStream particle_voxels;
+    BodyCacheStream constraints;
+    BodyCacheStream pressure_triangles;
+    // The occupancy as voxelized, before cleanup, hollowing and the embedding nodes. Level 0 of the VoxelBody. Also a
+    // serialized CompressedVoxels.
+    BodyCacheStream voxelized;
+};
+
+// A mapped body cache, used as a component in place of SimulationBody for entities loaded from the cache. The two
+// occupancy streams are decoded from the mapping when it's opened and stay compressed.
+class BodyCache
+{
+    utils::MappedFile m_file;
+    const BodyCacheHeader *m_header = nullptr;
+    CompressedVoxels m_occupancy;
+    CompressedVoxels m_voxelized;
+
+    template<typename T>
+    std::span<const T> Stream(const BodyCacheStream &stream) const
+    {
+        return {(const T *)(m_file.Bytes().data() + stream.offset), stream.count};
+    }
+
+  public:
+    // Returns nothing when the file doesn't exist, is from another version or has a different key
+    static std::optional<BodyCache> Open(const char *cache_path, u64 key);
+
+    GridPlacement Placement() const;
+    // Occupancy and particle materials, the particles being the solid voxels in order
+    const CompressedVoxels &Occupancy() const { return m_occupancy; }
+    std::span<const f32> Distances() const { return Stream<f32>(m_header->distances); }
+    glm::uvec3 NodeDimensions() const { return m_header->node_dimensions; }
+    std::span<const EmbeddedVertex> Embedding() const { return Stream<EmbeddedVertex>(m_header->embedding); }
+    std::span<const glm::vec3> RestParticles() const { return Stream<glm::vec3>(m_header->rest_particles); }
+    std::span<const u32> ParticleVoxels() const { return Stream<u32>(m_header->particle_voxels); }
+    std::span<const RestConstraint> Constraints() const { return Stream<RestConstraint>(m_header->constraints); }
+    std::span<const glm::uvec3> PressureTriangles() const { return Stream<glm::uvec3>(m_header->pressure_triangles); }
+    f32 RestVolume() const { return m_header->rest_volume; }
+    const CompressedVoxels &Voxelized() const { return m_voxelized; }
+
+    // Copies the cached data into a regular body for the code that needs to modify it
+    SimulationBody ToBody() const;
+    // Rebuilds the pyramid from the voxelized occupancy, resolution and mode being the ones of the BodyOptions
+    VoxelBody ToVoxelBody(u32 resolution, SolidFillMode mode) const;
+};
+
+// The name carries a hash of the options and the mesh cache seed, so each set of options keeps its own cache
+std::string BodyCachePath(const std::string &source_path, u64 mesh_seed, const BodyOptions &options);
+// source_hash is the mesh cache's HashSourceFile, whose seed already covers whatever shaped the render mesh
+u64 BodyCacheKey(u64 source_hash, const BodyOptions &options);
+// voxelized is what BuildSimulationBody was given, so a cached body can get its VoxelBody back without the mesh. Fails
+// like a failed write when the particles have more materials than CompressedVoxels can hold.
+bool WriteBodyCache(const char *cache_path, const SimulationBody &body, const VoxelGrid &voxelized, u64 key);
+
+// Build vs cached load times for every .obj in directory
+void BenchmarkBodyCache(const char *directory, u32 resolution);
@@ -0,0 +1,171 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+
+namespace
+{
+
+struct BuildTask {
+    u32 node;
+    u32 begin;
+    u32 end;
+};
+
+f32 BoxDistanceSquared(const glm::vec3 &point, const BvhNode &node)
+{
+    const glm::vec3 offset = glm::max(glm::max(node.min - point, point - node.max), glm::vec3(0.0f));
+    return glm::dot(offset, offset);
+}
+
+} // namespace
+
+glm::vec3 ClosestPointOnTriangle(const glm::vec3 &point, const BvhTriangle &triangle)
+{
+    const glm::vec3 &a = triangle.v[0];
+    const glm::vec3 &b = triangle.v[1];
+    const glm::vec3 &c = triangle.v[2];
+    const glm::vec3 ab = b - a;
+    const glm::vec3 ac = c - a;
+    const glm::vec3 ap = point - a;
+    const f32 d1 = glm::dot(ab, ap);
+    const f32 d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        return a;
+    }
+    const glm::vec3 bp = point - b;
+    const f32 d3 = glm::dot(ab, bp);
+    const f32 d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        return b;
+    }
+    const f32 vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return a + ab * (d1 / (d1 - d3));
+    }
+    const glm::vec3 cp = point - c;
+    const f32 d5 = glm::dot(ab, cp);
+    const f32 d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        return c;
+    }
+    const f32 vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return a + ac * (d2 / (d2 - d6));
+    }
+    const f32 va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+    // Inside the face, degenerate triangles end up here with a zero denominator and fall back to a corner
+    const f32 denominator = va + vb + vc;
+    if (denominator <= 0.0f) {
+        return a;
+    }
+    return a + ab * (vb / denominator) + ac * (vc / denominator);
+}
+
+TriangleBvh::TriangleBvh(const Mesh &mesh) : TriangleBvh(mesh.vertices, mesh.indices) {}
+
+TriangleBvh::TriangleBvh(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, u32 max_leaf_size)
+{
+    const u32 triangle_count = (u32)(indices.size() / 3);
+    if (triangle_count == 0) {
+        return;
+    }
+    std::vector<BvhTriangle> triangles(triangle_count);
+    std::vector<glm::vec3> centroids(triangle_count);
+    m_triangle_indices.resize(triangle_count);
+    for (u32 triangle = 0; triangle < triangle_count; triangle++) {
+        for (u32 corner = 0; corner < 3; corner++) {
+            triangles[triangle].v[corner] = vertices[indices[triangle * 3 + corner]].position;
+        }
+        centroids[triangle] = (triangles[triangle].v[0] + triangles[triangle].v[1] + triangles[triangle].v[2]) / 3.0f;
+        m_triangle_indices[triangle] = triangle;
+    }
+
+    m_nodes.reserve(2 * triangle_count / std::max(max_leaf_size, 1u) + 1);
+    m_nodes.push_back({});
+    std::vector<BuildTask> stack = {{0, 0, triangle_count}};
+    while (!stack.empty()) {
+        const BuildTask task = stack.back();
+        stack.pop_back();
+
+        glm::vec3 min(std::numeric_limits<f32>::max());
+        glm::vec3 max(std::numeric_limits<f32>::lowest());
+        glm::vec3 centroid_min = min;
+        glm::vec3 centroid_max = max;
+        for (u32 i = task.begin; i < task.end; i++) {
+            const BvhTriangle &triangle = triangles[m_triangle_indices[i]];
+            for (const glm::vec3 &corner : triangle.v) {
+                min = glm::min(min, corner);
+                max = glm::max(max, corner);
+            }
+            centroid_min = glm::min(centroid_min, centroids[m_triangle_indices[i]]);
+            centroid_max = glm::max(centroid_max, centroids[m_triangle_indices[i]]);
+        }
+        m_nodes[task.node].min = min;
+        m_nodes[task.node].max = max;
+
+        const glm::vec3 extent = centroid_max - centroid_min;
+        const u32 axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        if (task.end - task.begin <= max_leaf_size || extent[axis] <= 0.0f) {
+            m_nodes[task.node].first = task.begin;
+            m_nodes[task.node].count = task.end - task.begin;
+            continue;
+        }
+
+        const u32 middle = task.begin + (task.end - task.begin) / 2;
+        std::nth_element(m_triangle_indices.begin() + task.begin, m_triangle_indices.begin() + middle,
+            m_triangle_indices.begin() + task.end,
+            [&](u32 a, u32 b) { return centroids[a][axis] < centroids[b][axis]; });
+
+        const u32 left = (u32)m_nodes.size();
+        m_nodes[task.node].first = left;
+        m_nodes[task.node].count = 0;
+        m_nodes.push_back({});
+        m_nodes.push_back({});
+        stack.push_back({left + 1, middle, task.end});
+        stack.push_back({left, task.begin, middle});
+    }
+
+    m_triangles.resize(triangle_count);
+    for (u32 i = 0; i < triangle_count; i++) {
+        m_triangles[i] = triangles[m_triangle_indices[i]];
+    }
+}
+
+BvhClosestPoint TriangleBvh::ClosestPoint(const glm::vec3 &point, f32 max_distance_squared) const
+{
+    BvhClosestPoint closest = {point, max_distance_squared};
+    if (IsEmpty()) {
+        return closest;
+    }
+    // Nearer child is pushed last so it's searched first and prunes more of the other one
+    u32 stack[64];
+    u32 stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const BvhNode &node = m_nodes[stack[--stack_size]];
+        if (BoxDistanceSquared(point, node) >= closest.distance_squared) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (u32 t = node.first; t < node.first + node.count; t++) {
+                const glm::vec3 candidate = ClosestPointOnTriangle(point, m_triangles[t]);
+                const f32 distance_squared = glm::dot(candidate - point, candidate - point);
+                if (distance_squared < closest.distance_squared) {
+                    closest = {candidate, distance_squared, t};
+                }
+            }
+            continue;
+        }
+        const f32 left = BoxDistanceSquared(point, m_nodes[node.first]);
+        const f32 right = BoxDistanceSquared(point, m_nodes[node.first + 1]);
+        stack[stack_size++] = left < right ? node.first + 1 : node.first;
+        stack[stack_size++] = left < right ? node.first : node.first + 1;
+    }
+    return closest;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <glm/vec3.hpp>
+#include <limits>
+#include <span>
+#include <vector>
+
+struct BvhNode {
+    glm::vec3 min;
+    // First triangle for leaves, left child for inner nodes. The right child always follows the left one.
+    u32 first;
+    glm::vec3 max;
+    // Triangles in a leaf, 0 for inner nodes
+    u32 count;
+};
+
+struct BvhTriangle {
+    glm::vec3 v[3];
+};
+
+// Closest point on the triangle to point, Ericson's Real-Time Collision Detection 5.1.5
+glm::vec3 ClosestPointOnTriangle(const glm::vec3 &point, const BvhTriangle &triangle);
+
+struct BvhClosestPoint {
+    static constexpr u32 NO_TRIANGLE = 0xFFFFFFFF;
+
+    glm::vec3 point;
+    f32 distance_squared;
+    // In leaf order, see TriangleIndices()
+    u32 triangle = NO_TRIANGLE;
+};
+
+// Bounding volume hierarchy over the triangles of a mesh, split at the centroid median of the longest axis. Triangle
+// corners are copied into leaf order so queries walk memory linearly. Node 0 is the root, parents come before their
+// children.
+class TriangleBvh
+{
+  public:
+    TriangleBvh(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, u32 max_leaf_size = 4);
+    explicit TriangleBvh(const Mesh &mesh);
+
+    std::span<const BvhNode> Nodes() const { return m_nodes; }
+    std::span<const BvhTriangle> Triangles() const { return m_triangles; }
+    // Index into the original index buffer / 3 for every triangle in leaf order
+    std::span<const u32> TriangleIndices() const { return m_triangle_indices; }
+    bool IsEmpty() const { return m_triangles.empty(); }
+
+    // Nearest point on any triangle, ignoring triangles at max_distance_squared or further. triangle is NO_TRIANGLE
+    // when nothing is in range.
+    BvhClosestPoint ClosestPoint(
+        const glm::vec3 &point, f32 max_distance_squared = std::numeric_limits<f32>::max()) const;
+
+  private:
+    std::vector<BvhNode> m_nodes;
+    std::vector<BvhTriangle> m_triangles;
+    std::vector<u32> m_triangle_indices;
+};
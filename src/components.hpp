@@ -2,9 +2,18 @@
 
 #include <glm/vec3.hpp>
 #include "common.h"
+#include <memory>
 #include <string>
+#include <vector>
 #include <focus.hpp>
 
+// A range of the shared index buffer, one per OBJ shape/material run
+struct Submesh {
+    u32 index_offset = 0;
+    u32 index_count = 0;
+    s32 material_id = -1;
+};
+
 struct Mesh {
 #pragma pack(push, 1)
     struct Vertex {
@@ -14,12 +23,51 @@ struct Mesh {
 #pragma pack(pop)
     std::vector<Vertex> vertices; // xyz
     std::vector<u32> indices;
+    std::vector<Submesh> submeshes;
+};
+
+// Vertex layouts a mesh can be uploaded with, the compact ones are described in vertex_compression.hpp
+enum class VertexFormat {
+    // Mesh::Vertex, 24 bytes
+    Float32,
+    // CompactVertex12
+    Compact12,
+    // CompactVertex8
+    Compact8,
+};
+
+struct Bounds {
+    glm::vec3 min = {};
+    glm::vec3 max = {};
 };
 
 // Components
+// Simplified versions of the Mesh next to it, see BuildLodChain
+struct MeshLod {
+    // Fraction of the full resolution triangle count that was asked for
+    f32 target_ratio = 1.0f;
+    // Quadric error of the most expensive collapse so far, only comparable between levels of the same mesh
+    f32 max_error = 0.0f;
+    Mesh mesh;
+};
+
+struct MeshLods {
+    std::vector<MeshLod> levels;
+};
+
 struct MeshBuffers {
     focus::VertexBuffer vertex_buffer;
     focus::IndexBuffer index_buffer;
+    u32 index_count = 0;
+    std::vector<Submesh> submeshes;
+};
+
+// Meshes uploaded in a compact VertexFormat, maps the normalized positions back into mesh space with
+// position = position_offset + unorm * position_scale
+struct VertexQuantization {
+    VertexFormat format = VertexFormat::Float32;
+    glm::vec3 position_offset = {};
+    glm::vec3 position_scale = {1.0f, 1.0f, 1.0f};
 };
 
 // this is a little weird
@@ -28,14 +76,58 @@ struct Position {
 };
 
 // Deferred Actions
+using MeshLoadId = u32;
+
+enum class MeshLoadStatus {
+    Queued,
+    Loading,
+    Done,
+    Failed,
+};
+
+// Defined in body_cache.hpp, which needs the voxel headers that include this one
+struct BodyOptions;
+
+// Queue of OBJ files for the MeshManagementSystem. Parsing happens on background workers, poll Status() to find out
+// when the entity has been created.
+struct MeshLoadOptions {
+    // Vertex cache and vertex fetch reordering, safe for anything whose topology doesn't change after loading
+    bool optimize_for_rendering = true;
+    VertexFormat vertex_format = VertexFormat::Float32;
+    // Triangle ratios of the LOD chain stored in a MeshLods next to the mesh, none by default
+    std::vector<f32> lod_ratios;
+    // Voxelizes the mesh into a SimulationBody, or maps it from its BodyCache, when set
+    std::shared_ptr<const BodyOptions> body;
+};
+
 struct LoadMeshParams {
-    std::string filename;
+    struct QueuedLoad {
+        MeshLoadId id;
+        std::string filename;
+        MeshLoadOptions options;
+    };
+    std::vector<QueuedLoad> queued;
+    // indexed by MeshLoadId
+    std::vector<MeshLoadStatus> statuses;
+
+    MeshLoadId Enqueue(std::string filename, MeshLoadOptions options = {})
+    {
+        const auto id = (MeshLoadId)statuses.size();
+        statuses.push_back(MeshLoadStatus::Queued);
+        queued.push_back({id, std::move(filename), options});
+        return id;
+    }
+
+    MeshLoadStatus Status(MeshLoadId id) const { return statuses[id]; }
 };
 
 // Singleton Components
 struct BufferLayouts {
     focus::VertexBufferLayout phong_vertex_layout;
+    focus::VertexBufferLayout phong_compact12_vertex_layout;
+    focus::VertexBufferLayout phong_compact8_vertex_layout;
     focus::IndexBufferLayout phong_index_layout;
+    focus::IndexBufferLayout phong_u16_index_layout;
     focus::ConstantBufferLayout phong_vertex_constant_layout;
     focus::ConstantBufferLayout phong_frag_constant_layout;
 };
\ No newline at end of file
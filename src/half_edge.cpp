@@ -0,0 +1,191 @@
+#include "half_edge.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+
+constexpr Size MIN_HALF_EDGES_PER_RANGE = 16384;
+constexpr Size MIN_VERTICES_PER_RANGE = 4096;
+
+// Counting sort of the half-edges into one bucket per vertex, offsets ends up with vertex_count + 1 entries. Buckets
+// are filled from several threads at once so the order inside a bucket is arbitrary until it gets sorted.
+template<typename KeyFn>
+void BucketHalfEdges(
+    Size half_edge_count, Size vertex_count, KeyFn &&key, std::vector<u32> &offsets, std::vector<u32> &entries)
+{
+    offsets.assign(vertex_count + 1, 0);
+    ParallelFor(
+        half_edge_count,
+        [&](Size half_edge) {
+            std::atomic_ref<u32>(offsets[key((u32)half_edge) + 1]).fetch_add(1, std::memory_order_relaxed);
+        },
+        MIN_HALF_EDGES_PER_RANGE);
+    for (Size vertex = 0; vertex < vertex_count; vertex++) {
+        offsets[vertex + 1] += offsets[vertex];
+    }
+
+    std::vector<u32> cursors(offsets.begin(), offsets.end() - 1);
+    entries.resize(half_edge_count);
+    ParallelFor(
+        half_edge_count,
+        [&](Size half_edge) {
+            const u32 slot = std::atomic_ref<u32>(cursors[key((u32)half_edge)]).fetch_add(1, std::memory_order_relaxed);
+            entries[slot] = (u32)half_edge;
+        },
+        MIN_HALF_EDGES_PER_RANGE);
+}
+
+} // namespace
+
+HalfEdgeMesh::HalfEdgeMesh(const Mesh &mesh) : HalfEdgeMesh(mesh.indices, mesh.vertices.size()) {}
+
+HalfEdgeMesh::HalfEdgeMesh(std::span<const u32> indices, Size vertex_count)
+    : m_indices(indices.begin(), indices.begin() + indices.size() / 3 * 3)
+{
+    const Size half_edge_count = m_indices.size();
+    m_radial.resize(half_edge_count);
+
+    // Undirected edges are keyed by (smaller vertex, larger vertex). Bucketing by the smaller vertex and sorting each
+    // bucket by the larger one puts all half-edges of an edge next to each other.
+    std::vector<u32> edge_offsets;
+    std::vector<u32> edges;
+    BucketHalfEdges(
+        half_edge_count, vertex_count, [&](u32 half_edge) { return std::min(Origin(half_edge), Target(half_edge)); },
+        edge_offsets, edges);
+
+    std::vector<Size> boundary_counts(WorkerCount(), 0);
+    std::vector<Size> non_manifold_counts(WorkerCount(), 0);
+    const u32 range_count = ParallelForRanges(
+        vertex_count,
+        [&](Size begin, Size end, u32 range) {
+            for (Size vertex = begin; vertex < end; vertex++) {
+                const auto bucket_begin = edges.begin() + edge_offsets[vertex];
+                const auto bucket_end = edges.begin() + edge_offsets[vertex + 1];
+                const auto other = [&](u32 half_edge) { return std::max(Origin(half_edge), Target(half_edge)); };
+                // Sorting by half-edge index too keeps the cycles independent of thread timing
+                std::sort(bucket_begin, bucket_end, [&](u32 a, u32 b) {
+                    return other(a) != other(b) ? other(a) < other(b) : a < b;
+                });
+                for (auto first = bucket_begin; first != bucket_end;) {
+                    auto last = first + 1;
+                    while (last != bucket_end && other(*last) == other(*first)) {
+                        last++;
+                    }
+                    for (auto it = first; it != last; it++) {
+                        m_radial[*it] = it + 1 != last ? *(it + 1) : *first;
+                    }
+                    boundary_counts[range] += last - first == 1;
+                    non_manifold_counts[range] += last - first > 2;
+                    first = last;
+                }
+            }
+        },
+        MIN_VERTICES_PER_RANGE);
+    for (u32 range = 0; range < range_count; range++) {
+        m_boundary_edge_count += boundary_counts[range];
+        m_non_manifold_edge_count += non_manifold_counts[range];
+    }
+
+    BucketHalfEdges(
+        half_edge_count, vertex_count, [&](u32 half_edge) { return Origin(half_edge); }, m_outgoing_offsets,
+        m_outgoing);
+    ParallelFor(
+        vertex_count,
+        [&](Size vertex) {
+            const auto outgoing = m_outgoing.begin();
+            std::sort(outgoing + m_outgoing_offsets[vertex], outgoing + m_outgoing_offsets[vertex + 1]);
+        },
+        MIN_VERTICES_PER_RANGE);
+}
+
+u32 HalfEdgeMesh::Twin(u32 half_edge) const
+{
+    const u32 radial = m_radial[half_edge];
+    if (radial == half_edge || m_radial[radial] != half_edge || Origin(radial) != Target(half_edge)) {
+        return NO_HALF_EDGE;
+    }
+    return radial;
+}
+
+bool HalfEdgeMesh::IsNonManifold(u32 half_edge) const
+{
+    return m_radial[m_radial[half_edge]] != half_edge;
+}
+
+bool HalfEdgeMesh::IsBoundaryVertex(u32 vertex) const
+{
+    for (u32 half_edge : Outgoing(vertex)) {
+        if (IsBoundary(half_edge) || IsBoundary(Prev(half_edge))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::span<const u32> HalfEdgeMesh::Outgoing(u32 vertex) const
+{
+    const u32 begin = m_outgoing_offsets[vertex];
+    return {m_outgoing.data() + begin, m_outgoing_offsets[vertex + 1] - begin};
+}
+
+u32 HalfEdgeMesh::FindHalfEdge(u32 from, u32 to) const
+{
+    for (u32 half_edge : Outgoing(from)) {
+        if (Target(half_edge) == to) {
+            return half_edge;
+        }
+    }
+    return NO_HALF_EDGE;
+}
+
+HalfEdgeMesh::Range<HalfEdgeMesh::OneRingIterator> HalfEdgeMesh::OneRing(u32 vertex) const
+{
+    const auto outgoing = Outgoing(vertex);
+    return {OneRingIterator(this, outgoing, 0), OneRingIterator(this, outgoing, outgoing.size())};
+}
+
+HalfEdgeMesh::Range<HalfEdgeMesh::EdgeFaceIterator> HalfEdgeMesh::EdgeFaces(u32 half_edge) const
+{
+    return {EdgeFaceIterator(this, half_edge, half_edge), EdgeFaceIterator(this, half_edge, NO_HALF_EDGE)};
+}
+
+HalfEdgeMesh::OneRingIterator::OneRingIterator(const HalfEdgeMesh *mesh, std::span<const u32> outgoing, Size position)
+    : m_mesh(mesh), m_outgoing(outgoing), m_position(position)
+{
+}
+
+u32 HalfEdgeMesh::OneRingIterator::operator*() const
+{
+    const u32 half_edge = m_outgoing[m_position];
+    return m_incoming ? m_mesh->Origin(Prev(half_edge)) : m_mesh->Target(half_edge);
+}
+
+HalfEdgeMesh::OneRingIterator &HalfEdgeMesh::OneRingIterator::operator++()
+{
+    if (!m_incoming && NeedsIncoming()) {
+        m_incoming = true;
+    } else {
+        m_incoming = false;
+        m_position++;
+    }
+    return *this;
+}
+
+// Every neighbour is the target of some outgoing half-edge, except the one across an incoming edge nobody walks back
+bool HalfEdgeMesh::OneRingIterator::NeedsIncoming() const
+{
+    const u32 incoming = Prev(m_outgoing[m_position]);
+    const u32 vertex = m_mesh->Target(incoming);
+    u32 half_edge = incoming;
+    do {
+        if (m_mesh->Origin(half_edge) == vertex) {
+            return false;
+        }
+        half_edge = m_mesh->Radial(half_edge);
+    } while (half_edge != incoming);
+    return true;
+}
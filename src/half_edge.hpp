@@ -0,0 +1,122 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <limits>
+#include <span>
+#include <vector>
+
+constexpr u32 NO_HALF_EDGE = std::numeric_limits<u32>::max();
+
+// Index based half-edge view of a triangle list. Half-edge h is corner h of the index buffer going from indices[h] to
+// the next corner of the same triangle, so face, next and prev are arithmetic and only the edge pairing is stored.
+//
+// Every half-edge sits in a radial cycle with all other half-edges on the same undirected edge: a boundary half-edge
+// is alone in its cycle, a manifold one is paired with its twin and non-manifold edges have three or more. Vertices
+// are taken as-is, so build this from a welded Mesh; vertices that were kept apart because of different normals show
+// up as boundaries.
+class HalfEdgeMesh
+{
+  public:
+    class OneRingIterator;
+    class EdgeFaceIterator;
+
+    template<typename Iterator>
+    struct Range {
+        Iterator first;
+        Iterator last;
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+    };
+
+    explicit HalfEdgeMesh(const Mesh &mesh);
+    HalfEdgeMesh(std::span<const u32> indices, Size vertex_count);
+
+    Size VertexCount() const { return m_outgoing_offsets.size() - 1; }
+    Size FaceCount() const { return m_indices.size() / 3; }
+    Size HalfEdgeCount() const { return m_indices.size(); }
+
+    static u32 Face(u32 half_edge) { return half_edge / 3; }
+    static u32 Next(u32 half_edge) { return half_edge % 3 == 2 ? half_edge - 2 : half_edge + 1; }
+    static u32 Prev(u32 half_edge) { return half_edge % 3 == 0 ? half_edge + 2 : half_edge - 1; }
+
+    u32 Origin(u32 half_edge) const { return m_indices[half_edge]; }
+    u32 Target(u32 half_edge) const { return m_indices[Next(half_edge)]; }
+    // Next half-edge in the radial cycle, itself on boundaries
+    u32 Radial(u32 half_edge) const { return m_radial[half_edge]; }
+    // The oppositely oriented half-edge of a manifold edge, NO_HALF_EDGE on boundary and non-manifold edges
+    u32 Twin(u32 half_edge) const;
+
+    bool IsBoundary(u32 half_edge) const { return m_radial[half_edge] == half_edge; }
+    bool IsNonManifold(u32 half_edge) const;
+    bool IsBoundaryVertex(u32 vertex) const;
+
+    // Half-edges starting at vertex, in index buffer order
+    std::span<const u32> Outgoing(u32 vertex) const;
+    // NO_HALF_EDGE when no triangle has the directed edge from -> to
+    u32 FindHalfEdge(u32 from, u32 to) const;
+
+    // Neighbouring vertices, each once around manifold vertices. Non-manifold edges can report a neighbour twice.
+    Range<OneRingIterator> OneRing(u32 vertex) const;
+    // Faces sharing the undirected edge of half_edge, starting with its own
+    Range<EdgeFaceIterator> EdgeFaces(u32 half_edge) const;
+
+    // Counted per undirected edge
+    Size BoundaryEdgeCount() const { return m_boundary_edge_count; }
+    Size NonManifoldEdgeCount() const { return m_non_manifold_edge_count; }
+
+    class OneRingIterator
+    {
+      public:
+        OneRingIterator(const HalfEdgeMesh *mesh, std::span<const u32> outgoing, Size position);
+        u32 operator*() const;
+        OneRingIterator &operator++();
+        bool operator==(const OneRingIterator &other) const
+        {
+            return m_position == other.m_position && m_incoming == other.m_incoming;
+        }
+
+      private:
+        const HalfEdgeMesh *m_mesh;
+        std::span<const u32> m_outgoing;
+        Size m_position;
+        // Second visit of an outgoing half-edge, for the vertex behind an incoming boundary edge
+        bool m_incoming = false;
+
+        bool NeedsIncoming() const;
+    };
+
+    class EdgeFaceIterator
+    {
+      public:
+        EdgeFaceIterator(const HalfEdgeMesh *mesh, u32 start, u32 current)
+            : m_mesh(mesh), m_start(start), m_current(current)
+        {
+        }
+        u32 operator*() const { return Face(m_current); }
+        EdgeFaceIterator &operator++()
+        {
+            m_current = m_mesh->Radial(m_current);
+            if (m_current == m_start) {
+                m_current = NO_HALF_EDGE;
+            }
+            return *this;
+        }
+        bool operator==(const EdgeFaceIterator &other) const { return m_current == other.m_current; }
+
+      private:
+        const HalfEdgeMesh *m_mesh;
+        u32 m_start;
+        u32 m_current;
+    };
+
+  private:
+    std::vector<u32> m_indices;
+    std::vector<u32> m_radial;
+    // CSR list of outgoing half-edges per vertex
+    std::vector<u32> m_outgoing_offsets;
+    std::vector<u32> m_outgoing;
+    Size m_boundary_edge_count = 0;
+    Size m_non_manifold_edge_count = 0;
+};
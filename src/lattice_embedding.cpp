@@ -0,0 +1,336 @@
+#include "lattice_embedding.hpp"
+
+#include "mesh_normals.hpp"
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <glm/geometric.hpp>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LATTICE_EMBEDDING_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr Size MIN_RANGE_SIZE = 1024;
+
+// Offsets of the 8 cell corners from the base node, corner c at (c & 1, c >> 1 & 1, c >> 2 & 1)
+void CornerOffsets(glm::uvec3 node_dimensions, u32 offsets[8])
+{
+    for (u32 corner = 0; corner < 8; corner++) {
+        offsets[corner] = (corner & 1) + ((corner >> 1) & 1) * node_dimensions.x
+                          + (corner >> 2) * node_dimensions.x * node_dimensions.y;
+    }
+}
+
+EmbeddedVertex Embed(const Mesh::Vertex &vertex, const GridPlacement &placement, glm::uvec3 node_dimensions)
+{
+    const glm::vec3 grid_position = (vertex.position - placement.origin) / placement.voxel_size;
+    u32 cell[3];
+    f32 fraction[3];
+    for (u32 axis = 0; axis < 3; axis++) {
+        const f32 lowest = std::floor(grid_position[axis]);
+        cell[axis] = (u32)std::clamp(lowest, 0.0f, (f32)(placement.dimensions[axis] - 1));
+        fraction[axis] = grid_position[axis] - (f32)cell[axis];
+    }
+    return {
+        .base_node = (cell[2] * node_dimensions.y + cell[1]) * node_dimensions.x + cell[0],
+        .u = fraction[0],
+        .v = fraction[1],
+        .w = fraction[2],
+        .rest_normal = vertex.normal,
+    };
+}
+
+Mesh::Vertex DeformScalar(const EmbeddedVertex &vertex, const glm::vec3 *nodes, const u32 offsets[8])
+{
+    glm::vec3 corners[8];
+    for (u32 corner = 0; corner < 8; corner++) {
+        corners[corner] = nodes[vertex.base_node + offsets[corner]];
+    }
+    // Blend along x first, the edges along x also give the derivative along u
+    const glm::vec3 e00 = glm::mix(corners[0], corners[1], vertex.u);
+    const glm::vec3 e10 = glm::mix(corners[2], corners[3], vertex.u);
+    const glm::vec3 e01 = glm::mix(corners[4], corners[5], vertex.u);
+    const glm::vec3 e11 = glm::mix(corners[6], corners[7], vertex.u);
+    const glm::vec3 f0 = glm::mix(e00, e10, vertex.v);
+    const glm::vec3 f1 = glm::mix(e01, e11, vertex.v);
+
+    const glm::vec3 du = glm::mix(glm::mix(corners[1] - corners[0], corners[3] - corners[2], vertex.v),
+        glm::mix(corners[5] - corners[4], corners[7] - corners[6], vertex.v), vertex.w);
+    const glm::vec3 dv = glm::mix(e10 - e00, e11 - e01, vertex.w);
+    const glm::vec3 dw = f1 - f0;
+    // Cofactor matrix of [du dv dw] times the normal, the inverse transpose without the division by the determinant
+    const glm::vec3 normal = glm::cross(dv, dw) * vertex.rest_normal.x + glm::cross(dw, du) * vertex.rest_normal.y
+                             + glm::cross(du, dv) * vertex.rest_normal.z;
+    const f32 length = glm::length(normal);
+    return {glm::mix(f0, f1, vertex.w), length > 0.0f ? normal / length : vertex.rest_normal};
+}
+
+#ifdef LATTICE_EMBEDDING_SSE2
+// x, y and z of 4 vertices
+struct Vec3x4 {
+    __m128 x;
+    __m128 y;
+    __m128 z;
+};
+
+Vec3x4 Sub(const Vec3x4 &a, const Vec3x4 &b)
+{
+    return {_mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z)};
+}
+
+Vec3x4 Lerp(const Vec3x4 &a, const Vec3x4 &b, __m128 t)
+{
+    return {_mm_add_ps(a.x, _mm_mul_ps(_mm_sub_ps(b.x, a.x), t)), _mm_add_ps(a.y, _mm_mul_ps(_mm_sub_ps(b.y, a.y), t)),
+        _mm_add_ps(a.z, _mm_mul_ps(_mm_sub_ps(b.z, a.z), t))};
+}
+
+Vec3x4 Cross(const Vec3x4 &a, const Vec3x4 &b)
+{
+    return {_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+        _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+        _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x))};
+}
+
+// a * s + b * t + c * r
+Vec3x4 Combine(const Vec3x4 &a, __m128 s, const Vec3x4 &b, __m128 t, const Vec3x4 &c, __m128 r)
+{
+    return {_mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, s), _mm_mul_ps(b.x, t)), _mm_mul_ps(c.x, r)),
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.y, s), _mm_mul_ps(b.y, t)), _mm_mul_ps(c.y, r)),
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.z, s), _mm_mul_ps(b.z, t)), _mm_mul_ps(c.z, r))};
+}
+
+// Same math as DeformScalar for vertices[0..3]
+void DeformBlock4(const EmbeddedVertex *vertices, const glm::vec3 *nodes, const u32 offsets[8], Mesh::Vertex *out)
+{
+    Vec3x4 corners[8];
+    for (u32 corner = 0; corner < 8; corner++) {
+        const glm::vec3 &a = nodes[vertices[0].base_node + offsets[corner]];
+        const glm::vec3 &b = nodes[vertices[1].base_node + offsets[corner]];
+        const glm::vec3 &c = nodes[vertices[2].base_node + offsets[corner]];
+        const glm::vec3 &d = nodes[vertices[3].base_node + offsets[corner]];
+        corners[corner] = {_mm_setr_ps(a.x, b.x, c.x, d.x), _mm_setr_ps(a.y, b.y, c.y, d.y),
+            _mm_setr_ps(a.z, b.z, c.z, d.z)};
+    }
+    const __m128 u = _mm_setr_ps(vertices[0].u, vertices[1].u, vertices[2].u, vertices[3].u);
+    const __m128 v = _mm_setr_ps(vertices[0].v, vertices[1].v, vertices[2].v, vertices[3].v);
+    const __m128 w = _mm_setr_ps(vertices[0].w, vertices[1].w, vertices[2].w, vertices[3].w);
+
+    const Vec3x4 e00 = Lerp(corners[0], corners[1], u);
+    const Vec3x4 e10 = Lerp(corners[2], corners[3], u);
+    const Vec3x4 e01 = Lerp(corners[4], corners[5], u);
+    const Vec3x4 e11 = Lerp(corners[6], corners[7], u);
+    const Vec3x4 f0 = Lerp(e00, e10, v);
+    const Vec3x4 f1 = Lerp(e01, e11, v);
+    const Vec3x4 position = Lerp(f0, f1, w);
+
+    const Vec3x4 du = Lerp(Lerp(Sub(corners[1], corners[0]), Sub(corners[3], corners[2]), v),
+        Lerp(Sub(corners[5], corners[4]), Sub(corners[7], corners[6]), v), w);
+    const Vec3x4 dv = Lerp(Sub(e10, e00), Sub(e11, e01), w);
+    const Vec3x4 dw = Sub(f1, f0);
+    const Vec3x4 rest_normal = {
+        _mm_setr_ps(vertices[0].rest_normal.x, vertices[1].rest_normal.x, vertices[2].rest_normal.x,
+            vertices[3].rest_normal.x),
+        _mm_setr_ps(vertices[0].rest_normal.y, vertices[1].rest_normal.y, vertices[2].rest_normal.y,
+            vertices[3].rest_normal.y),
+        _mm_setr_ps(vertices[0].rest_normal.z, vertices[1].rest_normal.z, vertices[2].rest_normal.z,
+            vertices[3].rest_normal.z),
+    };
+    Vec3x4 normal =
+        Combine(Cross(dv, dw), rest_normal.x, Cross(dw, du), rest_normal.y, Cross(du, dv), rest_normal.z);
+    const __m128 length = _mm_sqrt_ps(_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(normal.x, normal.x), _mm_mul_ps(normal.y, normal.y)), _mm_mul_ps(normal.z, normal.z)));
+    // Collapsed cells keep the rest normal
+    const __m128 collapsed = _mm_cmple_ps(length, _mm_setzero_ps());
+    const __m128 divisor = _mm_or_ps(_mm_and_ps(collapsed, _mm_set1_ps(1.0f)), _mm_andnot_ps(collapsed, length));
+    normal = {_mm_div_ps(normal.x, divisor), _mm_div_ps(normal.y, divisor), _mm_div_ps(normal.z, divisor)};
+    normal.x = _mm_or_ps(_mm_and_ps(collapsed, rest_normal.x), _mm_andnot_ps(collapsed, normal.x));
+    normal.y = _mm_or_ps(_mm_and_ps(collapsed, rest_normal.y), _mm_andnot_ps(collapsed, normal.y));
+    normal.z = _mm_or_ps(_mm_and_ps(collapsed, rest_normal.z), _mm_andnot_ps(collapsed, normal.z));
+
+    f32 lanes[6][4];
+    _mm_storeu_ps(lanes[0], position.x);
+    _mm_storeu_ps(lanes[1], position.y);
+    _mm_storeu_ps(lanes[2], position.z);
+    _mm_storeu_ps(lanes[3], normal.x);
+    _mm_storeu_ps(lanes[4], normal.y);
+    _mm_storeu_ps(lanes[5], normal.z);
+    for (u32 lane = 0; lane < 4; lane++) {
+        out[lane].position = {lanes[0][lane], lanes[1][lane], lanes[2][lane]};
+        out[lane].normal = {lanes[3][lane], lanes[4][lane], lanes[5][lane]};
+    }
+}
+#endif
+
+} // namespace
+
+std::vector<glm::vec3> LatticeRestNodes(const GridPlacement &placement)
+{
+    const glm::uvec3 node_dimensions = placement.dimensions + 1u;
+    std::vector<glm::vec3> nodes((Size)node_dimensions.x * node_dimensions.y * node_dimensions.z);
+    Size i = 0;
+    for (u32 z = 0; z < node_dimensions.z; z++) {
+        for (u32 y = 0; y < node_dimensions.y; y++) {
+            for (u32 x = 0; x < node_dimensions.x; x++) {
+                nodes[i++] = placement.origin + glm::vec3(x, y, z) * placement.voxel_size;
+            }
+        }
+    }
+    return nodes;
+}
+
+LatticeEmbedding EmbedInLattice(std::span<const Mesh::Vertex> vertices, const GridPlacement &placement)
+{
+    LatticeEmbedding embedding;
+    embedding.node_dimensions = placement.dimensions + 1u;
+    embedding.vertices.resize(vertices.size());
+    ParallelFor(
+        vertices.size(),
+        [&](Size i) { embedding.vertices[i] = Embed(vertices[i], placement, embedding.node_dimensions); },
+        MIN_RANGE_SIZE);
+    return embedding;
+}
+
+void DeformEmbedded(const LatticeEmbedding &embedding, std::span<const glm::vec3> nodes, std::span<Mesh::Vertex> out)
+{
+    DeformEmbedded(embedding.node_dimensions, embedding.vertices, nodes, out);
+}
+
+void DeformEmbedded(glm::uvec3 node_dimensions, std::span<const EmbeddedVertex> embedded,
+    std::span<const glm::vec3> nodes, std::span<Mesh::Vertex> out)
+{
+    assert(out.size() == embedded.size());
+    assert(nodes.size() == (Size)node_dimensions.x * node_dimensions.y * node_dimensions.z);
+    u32 offsets[8];
+    CornerOffsets(node_dimensions, offsets);
+    const EmbeddedVertex *vertices = embedded.data();
+
+    // Ranges are whole blocks of 4 so the SIMD path never straddles two of them
+    const Size block_count = (out.size() + 3) / 4;
+    ParallelForRanges(
+        FrameWorkers(), block_count,
+        [&](Size begin, Size end, u32) {
+            Size i = begin * 4;
+            const Size last = std::min(end * 4, out.size());
+#ifdef LATTICE_EMBEDDING_SSE2
+            for (; i + 4 <= last; i += 4) {
+                DeformBlock4(&vertices[i], nodes.data(), offsets, &out[i]);
+            }
+#endif
+            for (; i < last; i++) {
+                out[i] = DeformScalar(vertices[i], nodes.data(), offsets);
+            }
+        },
+        MIN_RANGE_SIZE);
+}
+
+void DeformInLattice(
+    const GridPlacement &placement, std::span<const glm::vec3> nodes, std::span<Mesh::Vertex> vertices)
+{
+    const glm::uvec3 node_dimensions = placement.dimensions + 1u;
+    assert(nodes.size() == (Size)node_dimensions.x * node_dimensions.y * node_dimensions.z);
+    u32 offsets[8];
+    CornerOffsets(node_dimensions, offsets);
+
+    const Size block_count = (vertices.size() + 3) / 4;
+    ParallelForRanges(
+        FrameWorkers(), block_count,
+        [&](Size begin, Size end, u32) {
+            Size i = begin * 4;
+            const Size last = std::min(end * 4, vertices.size());
+#ifdef LATTICE_EMBEDDING_SSE2
+            for (; i + 4 <= last; i += 4) {
+                const EmbeddedVertex embedded[4] = {
+                    Embed(vertices[i], placement, node_dimensions),
+                    Embed(vertices[i + 1], placement, node_dimensions),
+                    Embed(vertices[i + 2], placement, node_dimensions),
+                    Embed(vertices[i + 3], placement, node_dimensions),
+                };
+                DeformBlock4(embedded, nodes.data(), offsets, &vertices[i]);
+            }
+#endif
+            for (; i < last; i++) {
+                vertices[i] = DeformScalar(Embed(vertices[i], placement, node_dimensions), nodes.data(), offsets);
+            }
+        },
+        MIN_RANGE_SIZE);
+}
+
+std::vector<glm::vec3> TwistedLatticeNodes(const GridPlacement &placement)
+{
+    std::vector<glm::vec3> nodes = LatticeRestNodes(placement);
+    const glm::vec3 center = placement.origin + glm::vec3(placement.dimensions) * placement.voxel_size * 0.5f;
+    const f32 height = (f32)placement.dimensions.y * placement.voxel_size;
+    for (glm::vec3 &node : nodes) {
+        const glm::vec3 offset = node - center;
+        const f32 angle = 1.5707964f * (node.y - placement.origin.y) / height;
+        const f32 c = std::cos(angle);
+        const f32 s = std::sin(angle);
+        node = center + glm::vec3(c * offset.x + s * offset.z, offset.y, -s * offset.x + c * offset.z);
+    }
+    return nodes;
+}
+
+void BenchmarkLatticeEmbedding(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto best_of = [&](auto &&fn) {
+        f64 best = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            const auto start = Clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    };
+
+    printf("%-24s %10s %10s %12s %10s %12s %14s\n", "file", "vertices", "nodes", "embed ms", "deform ms",
+        "ns/vertex", "rest error");
+    for (const auto &path : paths) {
+        Mesh mesh = LoadObjParallel(path.string().c_str());
+        if (!HasNormals(mesh)) {
+            GenerateNormals(mesh);
+        }
+        const GridPlacement placement = PlaceGrid(ComputeBounds(mesh.vertices), resolution);
+        const std::vector<glm::vec3> rest = LatticeRestNodes(placement);
+
+        LatticeEmbedding embedding;
+        const f64 embed_ms = best_of([&]() { embedding = EmbedInLattice(mesh.vertices, placement); });
+
+        // The undeformed lattice has to give back the mesh
+        std::vector<Mesh::Vertex> deformed(mesh.vertices.size());
+        DeformEmbedded(embedding, rest, deformed);
+        f32 rest_error = 0.0f;
+        for (Size i = 0; i < deformed.size(); i++) {
+            rest_error = std::max(rest_error, glm::length(deformed[i].position - mesh.vertices[i].position));
+        }
+
+        const std::vector<glm::vec3> twisted = TwistedLatticeNodes(placement);
+        const f64 deform_ms = best_of([&]() { DeformEmbedded(embedding, twisted, deformed); });
+
+        printf("%-24s %10zu %10zu %12.3f %10.3f %12.2f %14.3g\n", path.filename().string().c_str(),
+            mesh.vertices.size(), rest.size(), embed_ms, deform_ms,
+            deform_ms * 1e6 / (f64)std::max<Size>(1, mesh.vertices.size()), rest_error);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "voxel_grid.hpp"
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// Lets a coarse simulation lattice drive a detailed render mesh. The lattice nodes are the voxel corners of a
+// GridPlacement, (dimensions + 1) per axis and x fastest. Every vertex is bound once to the cell it sits in, after
+// that a frame only costs a trilinear blend of that cell's 8 nodes per vertex.
+struct EmbeddedVertex {
+    // Node at the cell's lowest corner
+    u32 base_node;
+    // Position inside the cell, 0 to 1 on each axis
+    f32 u;
+    f32 v;
+    f32 w;
+    glm::vec3 rest_normal;
+};
+
+struct LatticeEmbedding {
+    glm::uvec3 node_dimensions = {};
+    std::vector<EmbeddedVertex> vertices;
+};
+
+// Node positions of the undeformed lattice
+std::vector<glm::vec3> LatticeRestNodes(const GridPlacement &placement);
+
+// Vertices outside the lattice are bound to the nearest border cell and extrapolate from it
+LatticeEmbedding EmbedInLattice(std::span<const Mesh::Vertex> vertices, const GridPlacement &placement);
+
+// Writes the deformed vertices, out.size() has to match the embedding. Normals go through the cofactor matrix of the
+// cell's deformation at the vertex, so they stay perpendicular to the deformed surface. Runs in parallel on
+// FrameWorkers(), with SSE2 for 4 vertices at a time when available.
+void DeformEmbedded(const LatticeEmbedding &embedding, std::span<const glm::vec3> nodes, std::span<Mesh::Vertex> out);
+// The same for an embedding that lives somewhere else, e.g. a mapped BodyCache
+void DeformEmbedded(glm::uvec3 node_dimensions, std::span<const EmbeddedVertex> vertices,
+    std::span<const glm::vec3> nodes, std::span<Mesh::Vertex> out);
+
+// Embeds and deforms in one pass, in place, for geometry that is built again every frame such as the output of a
+// SurfaceExtractor. placement is the rest lattice that nodes deform, positions are read in rest space.
+void DeformInLattice(
+    const GridPlacement &placement, std::span<const glm::vec3> nodes, std::span<Mesh::Vertex> vertices);
+
+// Rest nodes twisted a quarter turn around the vertical axis from bottom to top, the deformation the benchmarks use
+std::vector<glm::vec3> TwistedLatticeNodes(const GridPlacement &placement);
+
+// Embedding and per frame deformation times for a twisted lattice, for every .obj in directory
+void BenchmarkLatticeEmbedding(const char *directory, u32 resolution);
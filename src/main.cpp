@@ -1,15 +1,18 @@
 #include "common.h"
 // #include "glad.h"
-#include "tiny_obj_loader.h"
 
 #include <cassert>
+#include <chrono>
+#include <cstdlib>
 #include <cstdio>
 #include <entt/entt.hpp>
 #include <filesystem>
 #include <focus.hpp>
+#include <future>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 #include <optional>
+#include <span>
 #include <sdl2/SDL.h>
 #include <string>
 #include <string_view>
@@ -17,6 +20,23 @@
 #include "system.hpp"
 #include "components.hpp"
 #include "render_system.hpp"
+#include "mesh_processing.hpp"
+#include "mesh_normals.hpp"
+#include "obj_loader.hpp"
+#include "mesh_cache.hpp"
+#include "body_cache.hpp"
+#include "thread_pool.hpp"
+#include "vertex_compression.hpp"
+#include "simplify.hpp"
+#include "lattice_embedding.hpp"
+#include "signed_distance.hpp"
+#include "surface_extraction.hpp"
+#include "voxel_components.hpp"
+#include "voxel_compression.hpp"
+#include "voxel_morphology.hpp"
+#include "voxelizer.hpp"
+#include "z_order.hpp"
+#include "utils.hpp"
 
 struct TestSystem final : public System {
     explicit constexpr TestSystem(entt::registry &registry) : System(registry, "Test-System") {}
@@ -28,7 +48,7 @@ struct TestSystem final : public System {
         if (already_ran) {
             return;
         }
-        m_registry.ctx().emplace<LoadMeshParams>("objects/block.obj");
+        m_registry.ctx().emplace<LoadMeshParams>().Enqueue("objects/block.obj");
         already_ran = true;
     }
 };
@@ -40,72 +60,200 @@ struct InputSystem final : public System {
 };
 
 struct MeshManagementSystem final : public System {
+    // Result of the background half of a load, everything except the registry and GPU work
+    struct PreparedMesh {
+        MeshLoadId id = 0;
+        bool failed = false;
+        std::optional<MeshCache> cache;
+        Mesh mesh;
+        // Only filled in for the compact vertex formats
+        VertexQuantization quantization;
+        std::vector<u8> compact_vertices;
+        MeshLods lods;
+        std::optional<BodyCache> body_cache;
+        std::optional<SimulationBody> body;
+        // What body was voxelized from, rebuilt from the body cache on a hit, so a coarser resolution later doesn't
+        // voxelize again
+        std::optional<VoxelBody> voxels;
+    };
+
+    std::vector<std::future<PreparedMesh>> m_in_flight;
+    // Parsing already fans out over every core, a couple of workers is enough to overlap loads
+    ThreadPool m_loader_pool{2};
+
     // TODO: I could capture references to the fields each system needs access to
-    explicit constexpr MeshManagementSystem(entt::registry &registry) : System(registry, "Mesh-Management-System") {}
+    explicit MeshManagementSystem(entt::registry &registry) : System(registry, "Mesh-Management-System")
+    {
+        m_registry.ctx().emplace<LoadMeshParams>();
+    }
 
     void Run() override
     {
-        std::string &filename = m_registry.ctx().at<LoadMeshParams>().filename;
-        if (filename.empty()) {
-            return;
+        auto &params = m_registry.ctx().at<LoadMeshParams>();
+        for (auto &load : params.queued) {
+            params.statuses[load.id] = MeshLoadStatus::Loading;
+            m_in_flight.push_back(m_loader_pool.Submit(
+                [id = load.id, filename = std::move(load.filename), options = load.options]() {
+                    return PrepareMesh(id, filename, options);
+                }));
         }
+        params.queued.clear();
 
+        for (auto it = m_in_flight.begin(); it != m_in_flight.end();) {
+            if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            PreparedMesh prepared = it->get();
+            it = m_in_flight.erase(it);
+            if (prepared.failed) {
+                params.statuses[prepared.id] = MeshLoadStatus::Failed;
+                continue;
+            }
+            CreateMeshEntity(prepared);
+            params.statuses[prepared.id] = MeshLoadStatus::Done;
+        }
+    }
+
+    // Runs on a loader thread, must not touch the registry
+    static PreparedMesh PrepareMesh(MeshLoadId id, const std::string &filename, const MeshLoadOptions &options)
+    {
+        PreparedMesh prepared;
+        prepared.id = id;
+        if (!std::filesystem::exists(filename)) {
+            printf("Not a valid path %s\n", filename.c_str());
+            prepared.failed = true;
+            return prepared;
+        }
+        const u64 mesh_seed = options.optimize_for_rendering ? 1 : 0;
+        const std::string cache_path = MeshCachePath(filename, mesh_seed);
+        const u64 source_hash = HashSourceFile(filename.c_str(), mesh_seed);
+        prepared.cache = MeshCache::Open(cache_path.c_str(), source_hash);
+        if (!prepared.cache) {
+            prepared.mesh = LoadMeshFromObjFile(filename, options);
+            WriteMeshCache(cache_path.c_str(), prepared.mesh, source_hash);
+        }
+        if (options.body) {
+            const std::string body_cache_path = BodyCachePath(filename, mesh_seed, *options.body);
+            const u64 body_key = BodyCacheKey(source_hash, *options.body);
+            prepared.body_cache = BodyCache::Open(body_cache_path.c_str(), body_key);
+            if (prepared.body_cache) {
+                prepared.voxels = prepared.body_cache->ToVoxelBody(options.body->resolution, options.body->fill_mode);
+            } else {
+                const Mesh source = prepared.cache ? prepared.cache->ToMesh() : Mesh{};
+                const Mesh &full = prepared.cache ? source : prepared.mesh;
+                prepared.voxels.emplace(full, options.body->resolution, options.body->fill_mode);
+                VoxelCleanupReport cleanup_report;
+                prepared.body = BuildSimulationBody(full, prepared.voxels->Occupancy(), *options.body, &cleanup_report);
+                PrintVoxelCleanupReport(filename.c_str(), cleanup_report);
+                WriteBodyCache(body_cache_path.c_str(), *prepared.body, prepared.voxels->Occupancy(), body_key);
+            }
+        }
+        if (!options.lod_ratios.empty()) {
+            const auto start = std::chrono::steady_clock::now();
+            const Mesh source = prepared.cache ? prepared.cache->ToMesh() : Mesh{};
+            const Mesh &full = prepared.cache ? source : prepared.mesh;
+            prepared.lods = BuildLodChain(full, options.lod_ratios);
+            if (options.optimize_for_rendering) {
+                for (MeshLod &level : prepared.lods.levels) {
+                    OptimizeMeshForRendering(level.mesh);
+                }
+            }
+            const std::chrono::duration<f64, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            PrintLodChain(filename.c_str(), full, prepared.lods, elapsed.count());
+        }
+        if (options.vertex_format != VertexFormat::Float32) {
+            const auto vertices = prepared.cache ? prepared.cache->Vertices() : std::span(prepared.mesh.vertices);
+            const Bounds bounds = prepared.cache ? prepared.cache->GetBounds() : ComputeBounds(vertices);
+            prepared.quantization = ComputeQuantization(bounds, options.vertex_format);
+            prepared.compact_vertices.resize(vertices.size() * VertexFormatSize(options.vertex_format));
+            EncodeVertices(vertices, prepared.quantization, prepared.compact_vertices);
+        }
+        return prepared;
+    }
+
+    void CreateMeshEntity(PreparedMesh &prepared)
+    {
         // TODO something more complex to actually manage the meshes
         const auto entity = m_registry.create();
-        Mesh mesh = LoadMeshFromObjFile(filename);
-        MeshBuffers mesh_buffers = CreateMeshBuffers(mesh);
+        const auto &layouts = m_registry.ctx().at<BufferLayouts>();
+        const auto format = prepared.quantization.format;
+        const auto &vertex_layout = format == VertexFormat::Compact12 ? layouts.phong_compact12_vertex_layout
+                                    : format == VertexFormat::Compact8 ? layouts.phong_compact8_vertex_layout
+                                                                       : layouts.phong_vertex_layout;
+        std::span<const u8> vertex_data = prepared.compact_vertices;
+        if (format == VertexFormat::Float32) {
+            vertex_data = prepared.cache ? utils::AsBytes(prepared.cache->Vertices())
+                                         : utils::AsBytes(std::span<const Mesh::Vertex>(prepared.mesh.vertices));
+        }
+        if (prepared.cache) {
+            auto &cache = *prepared.cache;
+            MeshBuffers mesh_buffers =
+                CreateMeshBuffers(vertex_layout, vertex_data, cache.IndexBytes(), cache.IndexSize(), cache.Submeshes());
+            m_registry.emplace<MeshBuffers>(entity, mesh_buffers);
+            m_registry.emplace<MeshCache>(entity, std::move(cache));
+        } else {
+            MeshBuffers mesh_buffers = CreateMeshBuffers(vertex_layout, vertex_data, prepared.mesh);
+            m_registry.emplace<MeshBuffers>(entity, mesh_buffers);
+            m_registry.emplace<Mesh>(entity, std::move(prepared.mesh));
+        }
+        if (prepared.body_cache) {
+            m_registry.emplace<BodyCache>(entity, std::move(*prepared.body_cache));
+        } else if (prepared.body) {
+            m_registry.emplace<SimulationBody>(entity, std::move(*prepared.body));
+        }
+        if (prepared.voxels) {
+            m_registry.emplace<VoxelBody>(entity, std::move(*prepared.voxels));
+        }
+        if (!prepared.lods.levels.empty()) {
+            m_registry.emplace<MeshLods>(entity, std::move(prepared.lods));
+        }
+        if (format != VertexFormat::Float32) {
+            m_registry.emplace<VertexQuantization>(entity, prepared.quantization);
+        }
         glm::vec3 position = {0.0, 0.0, 5.0};
-
-        m_registry.emplace<Mesh>(entity, mesh);
-        m_registry.emplace<MeshBuffers>(entity, mesh_buffers);
         m_registry.emplace<Position>(entity, position);
-
-        filename.clear();
     }
 
-    Mesh LoadMeshFromObjFile(const std::string &path)
+    static Mesh LoadMeshFromObjFile(const std::string &path, const MeshLoadOptions &options)
     {
-        if (!std::filesystem::exists(path)) {
-            printf("Not a valid path %s\n", path.c_str());
-            assert(0);
+        Mesh mesh = LoadObjParallel(path.c_str());
+        PrintWeldStats(path.c_str(), WeldMesh(mesh));
+        // Without normals the weld merged purely on position, which is what smooth normals need
+        if (!HasNormals(mesh)) {
+            GenerateNormals(mesh);
         }
-
-        Mesh mesh;
-        tinyobj::ObjReader reader;
-        reader.ParseFromFile(path);
-        const auto &attrib = reader.GetAttrib();
-        // assuming one shape for now
-        const auto &shape = reader.GetShapes()[0];
-        // TODO: calculate a better index buffer
-        u32 index = 0;
-        for (const auto &indices : shape.mesh.indices) {
-            Mesh::Vertex vertex;
-            vertex.position.x = attrib.vertices[indices.vertex_index * 3];
-            vertex.position.y = attrib.vertices[indices.vertex_index * 3 + 1];
-            vertex.position.z = attrib.vertices[indices.vertex_index * 3 + 2];
-
-            const u32 normal_index = indices.normal_index != -1 ? indices.normal_index : indices.vertex_index;
-            vertex.normal.x = attrib.normals[normal_index * 3];
-            vertex.normal.y = attrib.normals[normal_index * 3 + 1];
-            vertex.normal.z = attrib.normals[normal_index * 3 + 2];
-
-            mesh.vertices.push_back(vertex);
-            mesh.indices.push_back(index);
-            index++;
+        if (options.optimize_for_rendering) {
+            PrintVertexCacheStats(path.c_str(), OptimizeMeshForRendering(mesh));
         }
         return mesh;
     }
 
-    MeshBuffers CreateMeshBuffers(const Mesh &mesh)
+    MeshBuffers CreateMeshBuffers(
+        const focus::VertexBufferLayout &vertex_layout, std::span<const u8> vertex_data, const Mesh &mesh)
+    {
+        if (CanUseU16Indices(mesh.vertices.size())) {
+            std::vector<u16> narrow_indices(mesh.indices.begin(), mesh.indices.end());
+            return CreateMeshBuffers(vertex_layout, vertex_data, utils::AsBytes(std::span<const u16>(narrow_indices)),
+                sizeof(u16), mesh.submeshes);
+        }
+        const auto index_data = utils::AsBytes(std::span<const u32>(mesh.indices));
+        return CreateMeshBuffers(vertex_layout, vertex_data, index_data, sizeof(u32), mesh.submeshes);
+    }
+
+    MeshBuffers CreateMeshBuffers(const focus::VertexBufferLayout &vertex_layout, std::span<const u8> vertex_data,
+        std::span<const u8> index_data, u32 index_size, std::span<const Submesh> submeshes)
     {
         auto *device = m_registry.ctx().at<focus::Device *>();
         const auto &layouts = m_registry.ctx().at<BufferLayouts>();
+        const auto &index_layout = index_size == sizeof(u16) ? layouts.phong_u16_index_layout
+                                                             : layouts.phong_index_layout;
         // clang-format off
         return {
-            .vertex_buffer = device->CreateVertexBuffer(layouts.phong_vertex_layout, (void *)mesh.vertices.data(),
-                mesh.vertices.size() * sizeof(Mesh::Vertex)),
-            .index_buffer = device->CreateIndexBuffer(
-                layouts.phong_index_layout, (void *)mesh.indices.data(), mesh.indices.size() * sizeof(u32))
+            .vertex_buffer = device->CreateVertexBuffer(vertex_layout, (void *)vertex_data.data(), vertex_data.size()),
+            .index_buffer = device->CreateIndexBuffer(index_layout, (void *)index_data.data(), index_data.size()),
+            .index_count = (u32)(index_data.size() / index_size),
+            .submeshes = {submeshes.begin(), submeshes.end()},
         };
         // clang-format on
     }
@@ -152,6 +300,56 @@ class HeadSystem final : public System
 
 int main(int argc, char **argv)
 {
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-obj-loaders") {
+        BenchmarkObjLoaders(argc > 2 ? argv[2] : "data/objects");
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-voxelizer") {
+        BenchmarkVoxelizer(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 256);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-z-order") {
+        BenchmarkZOrder(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 256);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-sdf") {
+        BenchmarkSignedDistance(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 256);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-surface") {
+        BenchmarkSurfaceExtraction(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 128);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--test-marching-cubes") {
+        u32 failures = 0;
+        for (const u32 size : {4u, 6u}) {
+            const u32 bad_fields = CheckMarchingCubesEdges(size, 3000);
+            printf("%u^3: %u of 3000 random fields have a duplicated directed edge\n", size, bad_fields);
+            failures += bad_fields;
+        }
+        return failures == 0 ? 0 : 1;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-lattice") {
+        BenchmarkLatticeEmbedding(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 32);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-components") {
+        BenchmarkVoxelComponents(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 256);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-body-cache") {
+        BenchmarkBodyCache(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 64);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-voxel-compression") {
+        BenchmarkVoxelCompression(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 256);
+        return 0;
+    }
+    if (argc > 1 && std::string_view(argv[1]) == "--bench-morphology") {
+        BenchmarkVoxelMorphology(argc > 2 ? argv[2] : "data/objects", argc > 3 ? (u32)std::atoi(argv[3]) : 256);
+        return 0;
+    }
+
     entt::registry registry;
     HeadSystem head_system(registry);
     bool running = true;
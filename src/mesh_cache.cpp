@@ -0,0 +1,150 @@
+#include "mesh_cache.hpp"
+
+#include "mesh_processing.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+constexpr u64 STREAM_ALIGNMENT = 16;
+
+u64 AlignUp(u64 value, u64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool WritePadding(FILE *fp, u64 from, u64 to)
+{
+    static constexpr u8 ZEROS[STREAM_ALIGNMENT] = {};
+    return fwrite(ZEROS, 1, to - from, fp) == to - from;
+}
+
+} // namespace
+
+std::optional<MeshCache> MeshCache::Open(const char *cache_path, u64 source_hash)
+{
+    MeshCache cache;
+    cache.m_file = utils::MappedFile(cache_path, utils::FileAccessHint::WillNeed);
+    if (!cache.m_file.IsValid()) {
+        return std::nullopt;
+    }
+
+    const auto bytes = cache.m_file.Bytes();
+    if (bytes.size() < sizeof(MeshCacheHeader)) {
+        return std::nullopt;
+    }
+    const auto *header = (const MeshCacheHeader *)bytes.data();
+    if (header->magic != MeshCacheHeader::MAGIC || header->version != MeshCacheHeader::VERSION
+        || header->vertex_size != sizeof(Mesh::Vertex) || header->source_hash != source_hash) {
+        return std::nullopt;
+    }
+    const u64 vertex_bytes = (u64)header->vertex_count * sizeof(Mesh::Vertex);
+    const u64 index_bytes = (u64)header->index_count * header->index_size;
+    const u64 submesh_bytes = (u64)header->submesh_count * sizeof(Submesh);
+    if ((header->index_size != sizeof(u16) && header->index_size != sizeof(u32))
+        || header->vertex_offset + vertex_bytes > bytes.size() || header->index_offset + index_bytes > bytes.size()
+        || header->submesh_offset + submesh_bytes > bytes.size()) {
+        printf("Ignoring malformed mesh cache %s\n", cache_path);
+        return std::nullopt;
+    }
+    cache.m_header = header;
+    return cache;
+}
+
+std::span<const Mesh::Vertex> MeshCache::Vertices() const
+{
+    return {(const Mesh::Vertex *)(m_file.Bytes().data() + m_header->vertex_offset), m_header->vertex_count};
+}
+
+std::span<const u8> MeshCache::IndexBytes() const
+{
+    return m_file.Bytes().subspan(m_header->index_offset, (Size)m_header->index_count * m_header->index_size);
+}
+
+std::span<const Submesh> MeshCache::Submeshes() const
+{
+    return {(const Submesh *)(m_file.Bytes().data() + m_header->submesh_offset), m_header->submesh_count};
+}
+
+Mesh MeshCache::ToMesh() const
+{
+    Mesh mesh;
+    const auto vertices = Vertices();
+    mesh.vertices.assign(vertices.begin(), vertices.end());
+    const auto submeshes = Submeshes();
+    mesh.submeshes.assign(submeshes.begin(), submeshes.end());
+    mesh.indices.resize(m_header->index_count);
+    const u8 *index_data = IndexBytes().data();
+    for (u32 i = 0; i < m_header->index_count; i++) {
+        if (m_header->index_size == sizeof(u16)) {
+            u16 index;
+            memcpy(&index, index_data + i * sizeof(u16), sizeof(u16));
+            mesh.indices[i] = index;
+        } else {
+            memcpy(&mesh.indices[i], index_data + i * sizeof(u32), sizeof(u32));
+        }
+    }
+    return mesh;
+}
+
+std::string MeshCachePath(const std::string &source_path, u64 seed)
+{
+    char seed_hex[17];
+    snprintf(seed_hex, sizeof(seed_hex), "%llx", (unsigned long long)seed);
+    return source_path + "." + seed_hex + ".meshcache";
+}
+
+u64 HashSourceFile(const char *path, u64 seed)
+{
+    const utils::MappedFile file(path, utils::FileAccessHint::Sequential);
+    return utils::HashBytes(file.Bytes(), seed);
+}
+
+bool WriteMeshCache(const char *cache_path, const Mesh &mesh, u64 source_hash)
+{
+    const bool use_u16 = CanUseU16Indices(mesh.vertices.size());
+    MeshCacheHeader header = {
+        .source_hash = source_hash,
+        .vertex_count = (u32)mesh.vertices.size(),
+        .index_count = (u32)mesh.indices.size(),
+        .index_size = use_u16 ? (u32)sizeof(u16) : (u32)sizeof(u32),
+        .bounds = ComputeBounds(mesh.vertices),
+        .submesh_count = (u32)mesh.submeshes.size(),
+    };
+    const u64 vertex_bytes = mesh.vertices.size() * sizeof(Mesh::Vertex);
+    const u64 index_bytes = mesh.indices.size() * header.index_size;
+    header.vertex_offset = AlignUp(sizeof(MeshCacheHeader), STREAM_ALIGNMENT);
+    header.index_offset = AlignUp(header.vertex_offset + vertex_bytes, STREAM_ALIGNMENT);
+    header.submesh_offset = AlignUp(header.index_offset + index_bytes, STREAM_ALIGNMENT);
+
+    // Not fatal, the mesh just gets parsed again next time. Written aside and moved over the old cache, which another
+    // loader may have mapped.
+    const std::string temporary_path = utils::TemporaryPathFor(cache_path);
+    FILE *fp = fopen(temporary_path.c_str(), "wb");
+    if (!fp) {
+        printf("Failed to write mesh cache %s\n", cache_path);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && WritePadding(fp, sizeof(header), header.vertex_offset);
+    ok = ok && fwrite(mesh.vertices.data(), 1, vertex_bytes, fp) == vertex_bytes;
+    ok = ok && WritePadding(fp, header.vertex_offset + vertex_bytes, header.index_offset);
+    if (use_u16) {
+        std::vector<u16> narrow_indices(mesh.indices.begin(), mesh.indices.end());
+        ok = ok && fwrite(narrow_indices.data(), sizeof(u16), narrow_indices.size(), fp) == narrow_indices.size();
+    } else {
+        ok = ok && fwrite(mesh.indices.data(), sizeof(u32), mesh.indices.size(), fp) == mesh.indices.size();
+    }
+    ok = ok && WritePadding(fp, header.index_offset + index_bytes, header.submesh_offset);
+    ok = ok && fwrite(mesh.submeshes.data(), sizeof(Submesh), mesh.submeshes.size(), fp) == mesh.submeshes.size();
+    ok = fclose(fp) == 0 && ok;
+    ok = ok && utils::MoveFileOver(temporary_path.c_str(), cache_path);
+    if (!ok) {
+        printf("Failed to write mesh cache %s\n", cache_path);
+        remove(temporary_path.c_str());
+    }
+    return ok;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "utils.hpp"
+
+#include <optional>
+#include <span>
+#include <string>
+
+// Binary mesh cache written next to the source file. Layout is a MeshCacheHeader followed by the vertex, index and
+// submesh streams, each 16 byte aligned. Indices are stored in their upload format (u16 when they fit) so the streams
+// can go straight from the mapping into CreateMeshBuffers.
+struct MeshCacheHeader {
+    static constexpr u32 MAGIC = 0x4D425356; // "VSBM"
+    static constexpr u32 VERSION = 3;
+
+    u32 magic = MAGIC;
+    u32 version = VERSION;
+    u64 source_hash = 0;
+    u32 vertex_count = 0;
+    u32 index_count = 0;
+    u32 index_size = 0;
+    u32 vertex_size = sizeof(Mesh::Vertex);
+    Bounds bounds;
+    u64 vertex_offset = 0;
+    u64 index_offset = 0;
+    u32 submesh_count = 0;
+    u32 padding = 0;
+    u64 submesh_offset = 0;
+};
+
+// A mapped cache file, used as a component in place of Mesh for entities loaded from the cache
+class MeshCache
+{
+    utils::MappedFile m_file;
+    const MeshCacheHeader *m_header = nullptr;
+
+  public:
+    // Returns nothing when the file doesn't exist, is from another version or was built from a different source
+    static std::optional<MeshCache> Open(const char *cache_path, u64 source_hash);
+
+    std::span<const Mesh::Vertex> Vertices() const;
+    std::span<const u8> IndexBytes() const;
+    std::span<const Submesh> Submeshes() const;
+    u32 IndexSize() const { return m_header->index_size; }
+    u32 IndexCount() const { return m_header->index_count; }
+    const Bounds &GetBounds() const { return m_header->bounds; }
+
+    // Copies the cached data into a regular mesh for the code that needs to modify it
+    Mesh ToMesh() const;
+};
+
+// The seed should cover every option that changes the processed mesh. It's part of the cache path too, so loads with
+// different options each keep a cache instead of overwriting one another's.
+std::string MeshCachePath(const std::string &source_path, u64 seed = 0);
+u64 HashSourceFile(const char *path, u64 seed = 0);
+bool WriteMeshCache(const char *cache_path, const Mesh &mesh, u64 source_hash);
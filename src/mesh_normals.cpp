@@ -0,0 +1,112 @@
+#include "mesh_normals.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <glm/geometric.hpp>
+
+namespace
+{
+
+glm::vec3 LoadVec3(const u8 *base, Size stride, Size index)
+{
+    glm::vec3 value;
+    memcpy(&value, base + index * stride, sizeof(value));
+    return value;
+}
+
+void StoreVec3(u8 *base, Size stride, Size index, const glm::vec3 &value)
+{
+    memcpy(base + index * stride, &value, sizeof(value));
+}
+
+f32 CornerAngle(const glm::vec3 &from, const glm::vec3 &to_a, const glm::vec3 &to_b)
+{
+    const glm::vec3 a = to_a - from;
+    const glm::vec3 b = to_b - from;
+    const f32 length_product = glm::length(a) * glm::length(b);
+    if (length_product <= 0.0f) {
+        return 0.0f;
+    }
+    return std::acos(std::clamp(glm::dot(a, b) / length_product, -1.0f, 1.0f));
+}
+
+} // namespace
+
+void ComputeVertexNormals(const u8 *positions, Size position_stride, u8 *normals, Size normal_stride,
+    Size vertex_count, std::span<const u32> indices, NormalWeighting weighting, NormalScratch &scratch)
+{
+    constexpr Size MIN_TRIANGLES_PER_RANGE = 4096;
+    const Size triangle_count = indices.size() / 3;
+    // Enough buffers for the largest split ParallelForRanges can make
+    if (scratch.accumulators.size() < WorkerCount()) {
+        scratch.accumulators.resize(WorkerCount());
+    }
+
+    const u32 range_count = ParallelForRanges(
+        triangle_count,
+        [&](Size begin, Size end, u32 range) {
+            auto &accumulator = scratch.accumulators[range];
+            accumulator.assign(vertex_count, glm::vec3(0.0f));
+            for (Size triangle = begin; triangle < end; triangle++) {
+                const u32 i0 = indices[triangle * 3];
+                const u32 i1 = indices[triangle * 3 + 1];
+                const u32 i2 = indices[triangle * 3 + 2];
+                const glm::vec3 p0 = LoadVec3(positions, position_stride, i0);
+                const glm::vec3 p1 = LoadVec3(positions, position_stride, i1);
+                const glm::vec3 p2 = LoadVec3(positions, position_stride, i2);
+                const glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0);
+                if (weighting == NormalWeighting::Area) {
+                    accumulator[i0] += face_normal;
+                    accumulator[i1] += face_normal;
+                    accumulator[i2] += face_normal;
+                } else {
+                    const f32 length = glm::length(face_normal);
+                    if (length <= 0.0f) {
+                        continue;
+                    }
+                    const glm::vec3 unit_normal = face_normal / length;
+                    accumulator[i0] += unit_normal * CornerAngle(p0, p1, p2);
+                    accumulator[i1] += unit_normal * CornerAngle(p1, p2, p0);
+                    accumulator[i2] += unit_normal * CornerAngle(p2, p0, p1);
+                }
+            }
+        },
+        MIN_TRIANGLES_PER_RANGE);
+
+    ParallelFor(
+        vertex_count,
+        [&](Size vertex) {
+            glm::vec3 sum(0.0f);
+            for (u32 range = 0; range < range_count; range++) {
+                sum += scratch.accumulators[range][vertex];
+            }
+            const f32 length = glm::length(sum);
+            StoreVec3(normals, normal_stride, vertex, length > 0.0f ? sum / length : glm::vec3(0.0f));
+        },
+        MIN_TRIANGLES_PER_RANGE);
+}
+
+void GenerateNormals(Mesh &mesh, NormalWeighting weighting)
+{
+    NormalScratch scratch;
+    GenerateNormals(mesh, weighting, scratch);
+}
+
+void GenerateNormals(Mesh &mesh, NormalWeighting weighting, NormalScratch &scratch)
+{
+    auto *vertices = (u8 *)mesh.vertices.data();
+    ComputeVertexNormals(vertices + offsetof(Mesh::Vertex, position), sizeof(Mesh::Vertex),
+        vertices + offsetof(Mesh::Vertex, normal), sizeof(Mesh::Vertex), mesh.vertices.size(), mesh.indices,
+        weighting, scratch);
+}
+
+bool HasNormals(const Mesh &mesh)
+{
+    return std::all_of(mesh.vertices.begin(), mesh.vertices.end(), [](const Mesh::Vertex &vertex) {
+        return vertex.normal.x != 0.0f || vertex.normal.y != 0.0f || vertex.normal.z != 0.0f;
+    });
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+enum class NormalWeighting {
+    // Each face contributes its unnormalized cross product, so bigger faces count for more
+    Area,
+    // Each face contributes its unit normal scaled by the corner angle, independent of how the surface is triangulated
+    Angle,
+};
+
+// Per thread accumulation buffers, keep one around to recompute normals every frame without reallocating
+struct NormalScratch {
+    std::vector<std::vector<glm::vec3>> accumulators;
+};
+
+// Positions and normals are read/written `stride` bytes apart so this works on interleaved Mesh::Vertex arrays as
+// well as plain position arrays from the simulation. Triangles are split into one range per worker, each range
+// accumulates into its own buffer and the buffers are summed in range order, so the result doesn't depend on thread
+// timing.
+void ComputeVertexNormals(const u8 *positions, Size position_stride, u8 *normals, Size normal_stride,
+    Size vertex_count, std::span<const u32> indices, NormalWeighting weighting, NormalScratch &scratch);
+
+void GenerateNormals(Mesh &mesh, NormalWeighting weighting = NormalWeighting::Area);
+void GenerateNormals(Mesh &mesh, NormalWeighting weighting, NormalScratch &scratch);
+
+// False when any vertex is missing a normal, e.g. OBJ files without vn lines
+bool HasNormals(const Mesh &mesh);
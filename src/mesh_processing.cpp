@@ -0,0 +1,290 @@
+#include "mesh_processing.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <glm/common.hpp>
+#include <limits>
+#include <vector>
+
+namespace
+{
+
+constexpr u32 EMPTY_SLOT = std::numeric_limits<u32>::max();
+
+// -0.0 and 0.0 compare equal as floats but not as bits, so fold them together before hashing and comparing
+u32 CanonicalBits(f32 value)
+{
+    return value == 0.0f ? 0u : std::bit_cast<u32>(value);
+}
+
+struct VertexKey {
+    u32 bits[6];
+
+    explicit VertexKey(const Mesh::Vertex &vertex)
+    {
+        bits[0] = CanonicalBits(vertex.position.x);
+        bits[1] = CanonicalBits(vertex.position.y);
+        bits[2] = CanonicalBits(vertex.position.z);
+        bits[3] = CanonicalBits(vertex.normal.x);
+        bits[4] = CanonicalBits(vertex.normal.y);
+        bits[5] = CanonicalBits(vertex.normal.z);
+    }
+
+    bool operator==(const VertexKey &other) const { return memcmp(bits, other.bits, sizeof(bits)) == 0; }
+
+    u64 Hash() const
+    {
+        // murmur3 style finalizer applied over each word
+        u64 hash = 0x9E3779B97F4A7C15ull;
+        for (u32 word : bits) {
+            hash ^= word;
+            hash *= 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 33;
+        }
+        hash *= 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+};
+
+} // namespace
+
+WeldStats WeldMesh(Mesh &mesh)
+{
+    WeldStats stats = {
+        .input_vertex_count = mesh.vertices.size(),
+        .input_bytes = mesh.vertices.size() * sizeof(Mesh::Vertex) + mesh.indices.size() * sizeof(u32),
+    };
+
+    // Open addressing with linear probing, kept at most half full
+    const Size capacity = std::bit_ceil(std::max<Size>(mesh.vertices.size() * 2, 16));
+    const Size mask = capacity - 1;
+    std::vector<u32> slots(capacity, EMPTY_SLOT);
+
+    std::vector<Mesh::Vertex> welded_vertices;
+    welded_vertices.reserve(mesh.vertices.size());
+    std::vector<u32> remap(mesh.vertices.size());
+
+    for (Size i = 0; i < mesh.vertices.size(); i++) {
+        const VertexKey key(mesh.vertices[i]);
+        Size slot = key.Hash() & mask;
+        while (true) {
+            const u32 candidate = slots[slot];
+            if (candidate == EMPTY_SLOT) {
+                slots[slot] = (u32)welded_vertices.size();
+                remap[i] = (u32)welded_vertices.size();
+                welded_vertices.push_back(mesh.vertices[i]);
+                break;
+            }
+            if (VertexKey(welded_vertices[candidate]) == key) {
+                remap[i] = candidate;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    for (auto &index : mesh.indices) {
+        index = remap[index];
+    }
+    welded_vertices.shrink_to_fit();
+    mesh.vertices = std::move(welded_vertices);
+
+    stats.output_vertex_count = mesh.vertices.size();
+    stats.output_bytes = mesh.vertices.size() * sizeof(Mesh::Vertex)
+                         + mesh.indices.size() * (CanUseU16Indices(mesh.vertices.size()) ? sizeof(u16) : sizeof(u32));
+    return stats;
+}
+
+bool CanUseU16Indices(Size vertex_count)
+{
+    return vertex_count <= (Size)std::numeric_limits<u16>::max() + 1;
+}
+
+Bounds ComputeBounds(std::span<const Mesh::Vertex> vertices)
+{
+    if (vertices.empty()) {
+        return {};
+    }
+    Bounds bounds = {.min = vertices[0].position, .max = vertices[0].position};
+    for (const auto &vertex : vertices) {
+        bounds.min = glm::min(bounds.min, vertex.position);
+        bounds.max = glm::max(bounds.max, vertex.position);
+    }
+    return bounds;
+}
+
+void PrintWeldStats(const char *name, const WeldStats &stats)
+{
+    const f64 saved = stats.input_bytes > 0 ? 100.0 * (1.0 - (f64)stats.output_bytes / (f64)stats.input_bytes) : 0.0;
+    printf("Welded %s: %zu -> %zu vertices, %zu -> %zu bytes (%.1f%% saved)\n", name, stats.input_vertex_count,
+        stats.output_vertex_count, stats.input_bytes, stats.output_bytes, saved);
+}
+
+f32 ComputeACMR(std::span<const u32> indices, Size vertex_count, u32 cache_size)
+{
+    if (indices.size() < 3) {
+        return 0.0f;
+    }
+    // A vertex is in the FIFO when fewer than cache_size misses happened since it was loaded
+    std::vector<u64> load_time(vertex_count, 0);
+    u64 misses = 0;
+    for (u32 index : indices) {
+        if (load_time[index] == 0 || misses - load_time[index] >= cache_size) {
+            misses++;
+            load_time[index] = misses;
+        }
+    }
+    return (f32)misses / (f32)(indices.size() / 3);
+}
+
+namespace
+{
+
+// Tipsify over the triangles of one index range
+void TipsifyRange(std::span<u32> indices, Size vertex_count, u32 cache_size)
+{
+    const Size triangle_count = indices.size() / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // vertex -> triangle adjacency in CSR form, live_triangles doubles as the per vertex count
+    std::vector<u32> live_triangles(vertex_count, 0);
+    for (u32 index : indices) {
+        live_triangles[index]++;
+    }
+    std::vector<u32> adjacency_offsets(vertex_count + 1, 0);
+    for (Size v = 0; v < vertex_count; v++) {
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+    }
+    std::vector<u32> adjacency(adjacency_offsets[vertex_count]);
+    std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+    for (Size t = 0; t < triangle_count; t++) {
+        for (Size c = 0; c < 3; c++) {
+            adjacency[fill[indices[t * 3 + c]]++] = (u32)t;
+        }
+    }
+
+    std::vector<u64> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<u32> dead_end;
+    std::vector<u32> candidates;
+    std::vector<u32> output;
+    output.reserve(indices.size());
+    u64 time = cache_size + 1;
+    Size cursor = 0;
+
+    // Start from the first vertex that is actually used by this range
+    s64 fanning_vertex = indices[0];
+    while (fanning_vertex >= 0) {
+        candidates.clear();
+        for (u32 a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; a++) {
+            const u32 triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (Size c = 0; c < 3; c++) {
+                const u32 v = indices[triangle * 3 + c];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live_triangles[v]--;
+                if (time - cache_time[v] > cache_size) {
+                    cache_time[v] = time;
+                    time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer the candidate that is still in the cache and will stay there for its remaining triangles
+        s64 best = -1;
+        s64 best_priority = -1;
+        for (u32 v : candidates) {
+            if (live_triangles[v] == 0) {
+                continue;
+            }
+            s64 priority = 0;
+            if (time - cache_time[v] + 2 * live_triangles[v] <= cache_size) {
+                priority = (s64)(time - cache_time[v]);
+            }
+            if (priority > best_priority) {
+                best = v;
+                best_priority = priority;
+            }
+        }
+        if (best == -1) {
+            while (!dead_end.empty()) {
+                const u32 v = dead_end.back();
+                dead_end.pop_back();
+                if (live_triangles[v] > 0) {
+                    best = v;
+                    break;
+                }
+            }
+        }
+        if (best == -1) {
+            // Nothing local is left, resume from the next vertex in index order that still has triangles
+            while (cursor < indices.size() && live_triangles[indices[cursor]] == 0) {
+                cursor++;
+            }
+            if (cursor < indices.size()) {
+                best = indices[cursor];
+            }
+        }
+        fanning_vertex = best;
+    }
+    std::copy(output.begin(), output.end(), indices.begin());
+}
+
+} // namespace
+
+void OptimizeVertexCache(Mesh &mesh, u32 cache_size)
+{
+    if (mesh.submeshes.empty()) {
+        TipsifyRange(mesh.indices, mesh.vertices.size(), cache_size);
+        return;
+    }
+    for (const auto &submesh : mesh.submeshes) {
+        TipsifyRange(std::span(mesh.indices).subspan(submesh.index_offset, submesh.index_count), mesh.vertices.size(),
+            cache_size);
+    }
+}
+
+void OptimizeVertexFetch(Mesh &mesh)
+{
+    std::vector<u32> remap(mesh.vertices.size(), EMPTY_SLOT);
+    std::vector<Mesh::Vertex> ordered_vertices;
+    ordered_vertices.reserve(mesh.vertices.size());
+    for (auto &index : mesh.indices) {
+        if (remap[index] == EMPTY_SLOT) {
+            remap[index] = (u32)ordered_vertices.size();
+            ordered_vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices = std::move(ordered_vertices);
+}
+
+VertexCacheStats OptimizeMeshForRendering(Mesh &mesh)
+{
+    VertexCacheStats stats;
+    stats.acmr_before = ComputeACMR(mesh.indices, mesh.vertices.size());
+    // Tipsify can lose against an exporter that already wrote a good strip order (teapot.obj), keep the better one
+    std::vector<u32> original_indices = mesh.indices;
+    OptimizeVertexCache(mesh);
+    if (ComputeACMR(mesh.indices, mesh.vertices.size()) > stats.acmr_before) {
+        mesh.indices = std::move(original_indices);
+    }
+    OptimizeVertexFetch(mesh);
+    stats.acmr_after = ComputeACMR(mesh.indices, mesh.vertices.size());
+    return stats;
+}
+
+void PrintVertexCacheStats(const char *name, const VertexCacheStats &stats)
+{
+    printf("Vertex cache %s: ACMR %.3f -> %.3f\n", name, stats.acmr_before, stats.acmr_after);
+}
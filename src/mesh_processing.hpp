@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <span>
+
+struct WeldStats {
+    Size input_vertex_count = 0;
+    Size output_vertex_count = 0;
+    Size input_bytes = 0;
+    Size output_bytes = 0;
+};
+
+// Merges vertices with identical position/normal bit patterns and rewrites mesh.indices to point into the compacted
+// vertex array. Vertices keep the order in which they were first referenced.
+WeldStats WeldMesh(Mesh &mesh);
+
+// True when every index fits in a u16, so the mesh can be uploaded with a 16 bit index buffer.
+bool CanUseU16Indices(Size vertex_count);
+
+Bounds ComputeBounds(std::span<const Mesh::Vertex> vertices);
+
+void PrintWeldStats(const char *name, const WeldStats &stats);
+
+// Post-transform cache size assumed by the reordering and the ACMR numbers, roughly what current GPUs behave like
+constexpr u32 DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    f32 acmr_before = 0.0f;
+    f32 acmr_after = 0.0f;
+};
+
+// Average cache miss ratio, transformed vertices per triangle with a simulated FIFO cache. 0.5 is the ideal for large
+// regular meshes, 3 means no reuse at all.
+f32 ComputeACMR(std::span<const u32> indices, Size vertex_count, u32 cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Reorders triangles for the post-transform cache with Tipsify (Sander et al. 2007). Triangles stay inside their
+// submesh, so the submesh table remains valid.
+void OptimizeVertexCache(Mesh &mesh, u32 cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+// Stores vertices in the order the index buffer first uses them, unreferenced vertices are dropped
+void OptimizeVertexFetch(Mesh &mesh);
+
+// Both passes above, meant to run once on static meshes after welding
+VertexCacheStats OptimizeMeshForRendering(Mesh &mesh);
+void PrintVertexCacheStats(const char *name, const VertexCacheStats &stats);
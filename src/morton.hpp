@@ -0,0 +1,106 @@
+#pragma once
+
+#include "common.h"
+
+#include <glm/vec3.hpp>
+
+// pdep/pext are one instruction each on Intel since Haswell and AMD since Zen 3. They need -mbmi2 or -march=native
+// (/arch:AVX2 with MSVC, which has no separate BMI2 macro), otherwise the portable bit twiddling below is used. GCC and
+// Clang only define __BMI2__ when it is on, -mavx2 alone does not enable it.
+#if defined(__BMI2__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define MORTON_BMI2 1
+#include <immintrin.h>
+#endif
+
+// Bits that belong to each axis of a code, x ends up in the lowest bit
+constexpr u64 MORTON_X_MASK = 0x1249249249249249ull;
+constexpr u64 MORTON_Y_MASK = MORTON_X_MASK << 1;
+constexpr u64 MORTON_Z_MASK = MORTON_X_MASK << 2;
+constexpr u32 MORTON_BITS_PER_AXIS = 21;
+
+// Spreads the low 21 bits of value so there are two zero bits between each of them
+inline u64 MortonSpread(u32 value)
+{
+    u64 bits = value & 0x1FFFFF;
+    bits = (bits | bits << 32) & 0x1F00000000FFFFull;
+    bits = (bits | bits << 16) & 0x1F0000FF0000FFull;
+    bits = (bits | bits << 8) & 0x100F00F00F00F00Full;
+    bits = (bits | bits << 4) & 0x10C30C30C30C30C3ull;
+    bits = (bits | bits << 2) & 0x1249249249249249ull;
+    return bits;
+}
+
+inline u32 MortonCompact(u64 bits)
+{
+    bits &= 0x1249249249249249ull;
+    bits = (bits | bits >> 2) & 0x10C30C30C30C30C3ull;
+    bits = (bits | bits >> 4) & 0x100F00F00F00F00Full;
+    bits = (bits | bits >> 8) & 0x1F0000FF0000FFull;
+    bits = (bits | bits >> 16) & 0x1F00000000FFFFull;
+    bits = (bits | bits >> 32) & 0x1FFFFF;
+    return (u32)bits;
+}
+
+inline u64 MortonEncodePortable(u32 x, u32 y, u32 z)
+{
+    return MortonSpread(x) | MortonSpread(y) << 1 | MortonSpread(z) << 2;
+}
+
+inline glm::uvec3 MortonDecodePortable(u64 code)
+{
+    return {MortonCompact(code), MortonCompact(code >> 1), MortonCompact(code >> 2)};
+}
+
+// Z-order code of a coordinate with up to 21 bits per axis
+inline u64 MortonEncode(u32 x, u32 y, u32 z)
+{
+#ifdef MORTON_BMI2
+    return _pdep_u64(x, MORTON_X_MASK) | _pdep_u64(y, MORTON_Y_MASK) | _pdep_u64(z, MORTON_Z_MASK);
+#else
+    return MortonEncodePortable(x, y, z);
+#endif
+}
+
+inline glm::uvec3 MortonDecode(u64 code)
+{
+#ifdef MORTON_BMI2
+    return {(u32)_pext_u64(code, MORTON_X_MASK), (u32)_pext_u64(code, MORTON_Y_MASK),
+        (u32)_pext_u64(code, MORTON_Z_MASK)};
+#else
+    return MortonDecodePortable(code);
+#endif
+}
+
+constexpr u64 MortonAxisMask(u32 axis)
+{
+    return MORTON_X_MASK << axis;
+}
+
+// Neighbour stepping on the code itself. Filling the other axes' bits with ones makes the carry of an add skip over
+// them, so +1 along an axis is an or, an add and two masks. Coordinates wrap at 2^21.
+inline u64 MortonIncrement(u64 code, u32 axis)
+{
+    const u64 mask = MortonAxisMask(axis);
+    return (((code | ~mask) + 1) & mask) | (code & ~mask);
+}
+
+inline u64 MortonDecrement(u64 code, u32 axis)
+{
+    const u64 mask = MortonAxisMask(axis);
+    return (((code & mask) - 1) & mask) | (code & ~mask);
+}
+
+// Per axis sum of two codes, so adding the code of an offset moves by that offset. Negative offsets work through the
+// wrap around, encode them as (u32)offset.
+inline u64 MortonAdd(u64 a, u64 b)
+{
+    const u64 x = ((a | ~MORTON_X_MASK) + (b & MORTON_X_MASK)) & MORTON_X_MASK;
+    const u64 y = ((a | ~MORTON_Y_MASK) + (b & MORTON_Y_MASK)) & MORTON_Y_MASK;
+    const u64 z = ((a | ~MORTON_Z_MASK) + (b & MORTON_Z_MASK)) & MORTON_Z_MASK;
+    return x | y | z;
+}
+
+inline u64 MortonStep(u64 code, glm::ivec3 offset)
+{
+    return MortonAdd(code, MortonEncode((u32)offset.x & 0x1FFFFF, (u32)offset.y & 0x1FFFFF, (u32)offset.z & 0x1FFFFF));
+}
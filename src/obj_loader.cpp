@@ -0,0 +1,377 @@
+#include "obj_loader.hpp"
+
+#include "parallel.hpp"
+#include "tiny_obj_loader.h"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+constexpr s32 NO_INDEX = std::numeric_limits<s32>::min();
+
+// Negative OBJ indices are relative to the attributes defined so far, which a chunk only knows locally. Those are
+// stored as chunk local indices and offset by the chunk's base once every chunk has been counted.
+struct Corner {
+    s32 position = NO_INDEX;
+    s32 normal = NO_INDEX;
+    bool position_is_local = false;
+    bool normal_is_local = false;
+};
+
+// An "o", "g" or "usemtl" line, each one starts a new submesh at the chunk local corner offset
+struct SubmeshStart {
+    Size corner_offset = 0;
+    bool sets_material = false;
+    std::string material;
+};
+
+struct ObjChunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<Corner> corners;
+    std::vector<SubmeshStart> submesh_starts;
+};
+
+const char *SkipSpaces(const char *it, const char *end)
+{
+    while (it != end && (*it == ' ' || *it == '\t')) {
+        it++;
+    }
+    return it;
+}
+
+const char *ParseFloat(const char *it, const char *end, f32 &value)
+{
+    it = SkipSpaces(it, end);
+    // from_chars doesn't accept a leading plus
+    if (it != end && *it == '+') {
+        it++;
+    }
+    return std::from_chars(it, end, value).ptr;
+}
+
+const char *ParseVec3(const char *it, const char *end, glm::vec3 &value)
+{
+    it = ParseFloat(it, end, value.x);
+    it = ParseFloat(it, end, value.y);
+    return ParseFloat(it, end, value.z);
+}
+
+// Converts an OBJ index (1 based, or negative relative to the current count) into a 0 based index
+void ResolveObjIndex(s32 raw, Size local_count, s32 &index, bool &is_local)
+{
+    if (raw > 0) {
+        index = raw - 1;
+        is_local = false;
+    } else if (raw < 0) {
+        index = (s32)local_count + raw;
+        is_local = true;
+    }
+}
+
+// Parses one "v", "v/vt", "v//vn" or "v/vt/vn" face corner, returns nullptr when there isn't one
+const char *ParseCorner(const char *it, const char *end, const ObjChunk &chunk, Corner &corner)
+{
+    it = SkipSpaces(it, end);
+    s32 raw_position = 0;
+    auto result = std::from_chars(it, end, raw_position);
+    if (result.ec != std::errc() || raw_position == 0) {
+        return nullptr;
+    }
+    it = result.ptr;
+    ResolveObjIndex(raw_position, chunk.positions.size(), corner.position, corner.position_is_local);
+
+    if (it == end || *it != '/') {
+        return it;
+    }
+    it++;
+    if (it != end && *it != '/') {
+        s32 raw_texcoord = 0;
+        it = std::from_chars(it, end, raw_texcoord).ptr;
+    }
+    if (it == end || *it != '/') {
+        return it;
+    }
+    it++;
+    s32 raw_normal = 0;
+    result = std::from_chars(it, end, raw_normal);
+    if (result.ec == std::errc() && raw_normal != 0) {
+        ResolveObjIndex(raw_normal, chunk.normals.size(), corner.normal, corner.normal_is_local);
+    }
+    return result.ptr;
+}
+
+bool StartsWithKeyword(const char *it, const char *end, std::string_view keyword)
+{
+    return (Size)(end - it) > keyword.size() && std::string_view(it, keyword.size()) == keyword
+           && (it[keyword.size()] == ' ' || it[keyword.size()] == '\t');
+}
+
+void ParseLine(const char *it, const char *end, ObjChunk &chunk, std::vector<Corner> &polygon)
+{
+    it = SkipSpaces(it, end);
+    if (end - it < 2) {
+        return;
+    }
+    if (StartsWithKeyword(it, end, "o") || StartsWithKeyword(it, end, "g")) {
+        SubmeshStart start;
+        start.corner_offset = chunk.corners.size();
+        chunk.submesh_starts.push_back(start);
+    } else if (StartsWithKeyword(it, end, "usemtl")) {
+        const char *name_begin = SkipSpaces(it + 6, end);
+        const char *name_end = end;
+        while (name_end > name_begin && (name_end[-1] == ' ' || name_end[-1] == '\t')) {
+            name_end--;
+        }
+        chunk.submesh_starts.push_back({
+            .corner_offset = chunk.corners.size(),
+            .sets_material = true,
+            .material = std::string(name_begin, name_end),
+        });
+    } else if (it[0] == 'v' && (it[1] == ' ' || it[1] == '\t')) {
+        glm::vec3 position = {};
+        ParseVec3(it + 2, end, position);
+        chunk.positions.push_back(position);
+    } else if (it[0] == 'v' && it[1] == 'n') {
+        glm::vec3 normal = {};
+        ParseVec3(it + 2, end, normal);
+        chunk.normals.push_back(normal);
+    } else if (it[0] == 'f' && (it[1] == ' ' || it[1] == '\t')) {
+        polygon.clear();
+        it += 2;
+        Corner corner;
+        while ((it = ParseCorner(it, end, chunk, corner)) != nullptr) {
+            polygon.push_back(corner);
+            corner = {};
+        }
+        // Fan triangulation, fine for the convex polygons exporters write
+        for (Size i = 1; i + 1 < polygon.size(); i++) {
+            chunk.corners.push_back(polygon[0]);
+            chunk.corners.push_back(polygon[i]);
+            chunk.corners.push_back(polygon[i + 1]);
+        }
+    }
+}
+
+void ParseChunk(const char *begin, const char *end, ObjChunk &chunk)
+{
+    std::vector<Corner> polygon;
+    const char *line = begin;
+    while (line < end) {
+        const char *line_end = (const char *)memchr(line, '\n', end - line);
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+        const char *content_end = line_end;
+        if (content_end > line && content_end[-1] == '\r') {
+            content_end--;
+        }
+        ParseLine(line, content_end, chunk, polygon);
+        line = line_end + 1;
+    }
+}
+
+glm::vec3 FetchAttribute(const std::vector<glm::vec3> &attributes, s32 index, bool is_local, Size local_base)
+{
+    if (index == NO_INDEX) {
+        return {};
+    }
+    const s64 global_index = is_local ? (s64)local_base + index : index;
+    if (global_index < 0 || global_index >= (s64)attributes.size()) {
+        return {};
+    }
+    return attributes[global_index];
+}
+
+} // namespace
+
+Mesh LoadObjWithTinyObj(const char *path)
+{
+    Mesh mesh;
+    tinyobj::ObjReader reader;
+    reader.ParseFromFile(path);
+    const auto &attrib = reader.GetAttrib();
+    u32 index = 0;
+    for (const auto &shape : reader.GetShapes()) {
+        // the reader triangulates, so every face is 3 indices
+        for (Size face = 0; face < shape.mesh.num_face_vertices.size(); face++) {
+            const s32 material_id = shape.mesh.material_ids[face];
+            if (face == 0 || material_id != mesh.submeshes.back().material_id) {
+                mesh.submeshes.push_back({.index_offset = index, .material_id = material_id});
+            }
+            for (Size corner = 0; corner < 3; corner++) {
+                const auto &indices = shape.mesh.indices[face * 3 + corner];
+                Mesh::Vertex vertex;
+                vertex.position.x = attrib.vertices[indices.vertex_index * 3];
+                vertex.position.y = attrib.vertices[indices.vertex_index * 3 + 1];
+                vertex.position.z = attrib.vertices[indices.vertex_index * 3 + 2];
+
+                const u32 normal_index = indices.normal_index != -1 ? indices.normal_index : indices.vertex_index;
+                if (normal_index * 3 + 2 < attrib.normals.size()) {
+                    vertex.normal.x = attrib.normals[normal_index * 3];
+                    vertex.normal.y = attrib.normals[normal_index * 3 + 1];
+                    vertex.normal.z = attrib.normals[normal_index * 3 + 2];
+                }
+
+                mesh.vertices.push_back(vertex);
+                mesh.indices.push_back(index);
+                index++;
+            }
+            mesh.submeshes.back().index_count += 3;
+        }
+    }
+    return mesh;
+}
+
+Mesh LoadObjParallel(const char *path)
+{
+    const utils::MappedFile file(path, utils::FileAccessHint::Sequential);
+    if (!file.IsValid()) {
+        printf("Failed to open %s\n", path);
+        return {};
+    }
+    const std::string_view text = file.AsString();
+    const char *file_begin = text.data();
+    const char *file_end = text.data() + text.size();
+
+    // Line aligned chunk boundaries, small files end up as a single chunk
+    constexpr Size MIN_CHUNK_SIZE = 64 * 1024;
+    const Size chunk_count = std::clamp<Size>(text.size() / MIN_CHUNK_SIZE, 1, WorkerCount());
+    std::vector<const char *> boundaries(chunk_count + 1, file_end);
+    boundaries[0] = file_begin;
+    for (Size i = 1; i < chunk_count; i++) {
+        const char *split = std::max(boundaries[i - 1], file_begin + text.size() * i / chunk_count);
+        const char *newline = (const char *)memchr(split, '\n', file_end - split);
+        boundaries[i] = newline != nullptr ? newline + 1 : file_end;
+    }
+
+    std::vector<ObjChunk> chunks(chunk_count);
+    ParallelFor(chunk_count, [&](Size i) { ParseChunk(boundaries[i], boundaries[i + 1], chunks[i]); });
+
+    std::vector<Size> position_bases(chunk_count + 1, 0);
+    std::vector<Size> normal_bases(chunk_count + 1, 0);
+    std::vector<Size> corner_bases(chunk_count + 1, 0);
+    for (Size i = 0; i < chunk_count; i++) {
+        position_bases[i + 1] = position_bases[i] + chunks[i].positions.size();
+        normal_bases[i + 1] = normal_bases[i] + chunks[i].normals.size();
+        corner_bases[i + 1] = corner_bases[i] + chunks[i].corners.size();
+    }
+
+    std::vector<glm::vec3> positions(position_bases[chunk_count]);
+    std::vector<glm::vec3> normals(normal_bases[chunk_count]);
+    ParallelFor(chunk_count, [&](Size i) {
+        std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + position_bases[i]);
+        std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normals.begin() + normal_bases[i]);
+    });
+
+    Mesh mesh;
+    mesh.vertices.resize(corner_bases[chunk_count]);
+    mesh.indices.resize(corner_bases[chunk_count]);
+    ParallelFor(chunk_count, [&](Size i) {
+        const auto &corners = chunks[i].corners;
+        for (Size c = 0; c < corners.size(); c++) {
+            const Size out = corner_bases[i] + c;
+            mesh.vertices[out].position =
+                FetchAttribute(positions, corners[c].position, corners[c].position_is_local, position_bases[i]);
+            // Same fallback as the tinyobj path, files like teapot.obj write one normal per position without
+            // referencing it in the faces
+            if (corners[c].normal != NO_INDEX) {
+                mesh.vertices[out].normal =
+                    FetchAttribute(normals, corners[c].normal, corners[c].normal_is_local, normal_bases[i]);
+            } else {
+                const s64 position_index = corners[c].position_is_local
+                                               ? (s64)position_bases[i] + corners[c].position
+                                               : corners[c].position;
+                mesh.vertices[out].normal = FetchAttribute(normals, (s32)position_index, false, 0);
+            }
+            mesh.indices[out] = (u32)out;
+        }
+    });
+
+    // Material ids are assigned in order of first use since the .mtl files aren't loaded
+    struct Start {
+        Size offset;
+        s32 material_id;
+    };
+    std::vector<std::string> material_names;
+    std::vector<Start> starts = {{0, -1}};
+    s32 material_id = -1;
+    for (Size i = 0; i < chunk_count; i++) {
+        for (const auto &submesh_start : chunks[i].submesh_starts) {
+            if (submesh_start.sets_material) {
+                auto it = std::find(material_names.begin(), material_names.end(), submesh_start.material);
+                material_id = (s32)(it - material_names.begin());
+                if (it == material_names.end()) {
+                    material_names.push_back(submesh_start.material);
+                }
+            }
+            starts.push_back({corner_bases[i] + submesh_start.corner_offset, material_id});
+        }
+    }
+    for (Size i = 0; i < starts.size(); i++) {
+        const Size end = i + 1 < starts.size() ? starts[i + 1].offset : mesh.indices.size();
+        if (end > starts[i].offset) {
+            mesh.submeshes.push_back({
+                .index_offset = (u32)starts[i].offset,
+                .index_count = (u32)(end - starts[i].offset),
+                .material_id = starts[i].material_id,
+            });
+        }
+    }
+    return mesh;
+}
+
+void BenchmarkObjLoaders(const char *directory)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    printf("%-24s %12s %12s %8s\n", "file", "tinyobj ms", "parallel ms", "speedup");
+    for (const auto &path : paths) {
+        const std::string path_string = path.string();
+        f64 best_tinyobj = std::numeric_limits<f64>::max();
+        f64 best_parallel = std::numeric_limits<f64>::max();
+        Mesh tinyobj_mesh;
+        Mesh parallel_mesh;
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            auto start = Clock::now();
+            tinyobj_mesh = LoadObjWithTinyObj(path_string.c_str());
+            best_tinyobj =
+                std::min(best_tinyobj, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+
+            start = Clock::now();
+            parallel_mesh = LoadObjParallel(path_string.c_str());
+            best_parallel =
+                std::min(best_parallel, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        printf("%-24s %12.3f %12.3f %7.2fx\n", path.filename().string().c_str(), best_tinyobj, best_parallel,
+            best_tinyobj / best_parallel);
+        if (tinyobj_mesh.vertices.size() != parallel_mesh.vertices.size()) {
+            printf("    vertex count mismatch: tinyobj %zu, parallel %zu\n", tinyobj_mesh.vertices.size(),
+                parallel_mesh.vertices.size());
+        }
+        if (tinyobj_mesh.submeshes.size() != parallel_mesh.submeshes.size()) {
+            printf("    submesh count mismatch: tinyobj %zu, parallel %zu\n", tinyobj_mesh.submeshes.size(),
+                parallel_mesh.submeshes.size());
+        }
+    }
+}
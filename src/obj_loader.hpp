@@ -0,0 +1,16 @@
+#pragma once
+
+#include "components.hpp"
+
+// Both loaders produce an unwelded mesh with one vertex per face corner, run WeldMesh on the result to get a compact
+// vertex array. Every shape is packed into the same vertex/index arrays with one Submesh per shape/material run.
+
+// Reference path that goes through tinyobj::ObjReader.
+Mesh LoadObjWithTinyObj(const char *path);
+
+// Splits the file into line aligned chunks that are parsed on all cores and merged straight into the mesh. Faces with
+// more than 3 corners are fan triangulated, texture coordinates are skipped.
+Mesh LoadObjParallel(const char *path);
+
+// Times both loaders on every .obj file in directory and checks that they agree on the vertex and submesh counts.
+void BenchmarkObjLoaders(const char *directory);
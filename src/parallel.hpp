@@ -0,0 +1,104 @@
+#pragma once
+
+#include "common.h"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
+inline u32 WorkerCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// WorkerCount() - 1 workers that stay around for the loops that run every frame, where starting threads on every
+// call would cost as much as the work. The caller of a loop takes a range itself, so the loop must not be called from
+// one of these workers.
+ThreadPool &FrameWorkers();
+
+inline u32 RangeCount(Size count, Size min_range_size)
+{
+    const Size max_ranges = std::max<Size>(1, count / std::max<Size>(min_range_size, 1));
+    return (u32)std::min<Size>(WorkerCount(), max_ranges);
+}
+
+// Splits [0, count) into at most one contiguous range per worker and calls fn(begin, end, range_index) for each range.
+// The calling thread handles the last range. Returns the number of ranges used, which is what per range scratch data
+// needs to be sized to.
+template<typename F>
+u32 ParallelForRanges(Size count, F &&fn, Size min_range_size = 1)
+{
+    if (count == 0) {
+        return 0;
+    }
+    const u32 range_count = RangeCount(count, min_range_size);
+    const Size range_size = (count + range_count - 1) / range_count;
+
+    std::vector<std::thread> threads;
+    threads.reserve(range_count - 1);
+    for (u32 range = 0; range + 1 < range_count; range++) {
+        const Size begin = std::min(count, range * range_size);
+        const Size end = std::min(count, begin + range_size);
+        threads.emplace_back([&fn, begin, end, range]() { fn(begin, end, range); });
+    }
+    const Size last_begin = std::min(count, (range_count - 1) * range_size);
+    fn(last_begin, count, range_count - 1);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return range_count;
+}
+
+// Same as ParallelForRanges but calls fn(i) for each element.
+template<typename F>
+void ParallelFor(Size count, F &&fn, Size min_range_size = 1)
+{
+    ParallelForRanges(
+        count,
+        [&fn](Size begin, Size end, u32) {
+            for (Size i = begin; i < end; i++) {
+                fn(i);
+            }
+        },
+        min_range_size);
+}
+
+// Same as ParallelForRanges with the ranges handed to pool's workers instead of new threads
+template<typename F>
+u32 ParallelForRanges(ThreadPool &pool, Size count, F &&fn, Size min_range_size = 1)
+{
+    if (count == 0) {
+        return 0;
+    }
+    const u32 range_count = RangeCount(count, min_range_size);
+    const Size range_size = (count + range_count - 1) / range_count;
+
+    std::vector<std::future<void>> ranges;
+    ranges.reserve(range_count - 1);
+    for (u32 range = 0; range + 1 < range_count; range++) {
+        const Size begin = std::min(count, range * range_size);
+        const Size end = std::min(count, begin + range_size);
+        ranges.push_back(pool.Submit([&fn, begin, end, range]() { fn(begin, end, range); }));
+    }
+    const Size last_begin = std::min(count, (range_count - 1) * range_size);
+    fn(last_begin, count, range_count - 1);
+    for (auto &range : ranges) {
+        range.get();
+    }
+    return range_count;
+}
+
+template<typename F>
+void ParallelFor(ThreadPool &pool, Size count, F &&fn, Size min_range_size = 1)
+{
+    ParallelForRanges(
+        pool, count,
+        [&fn](Size begin, Size end, u32) {
+            for (Size i = begin; i < end; i++) {
+                fn(i);
+            }
+        },
+        min_range_size);
+}
@@ -5,11 +5,14 @@
 #include "sdl2/SDL.h"
 #include "system.hpp"
 #include "utils.hpp"
+#include "vertex_compression.hpp"
 #include "glad.h"
 
 #include <focus.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
+#include <utility>
+#include <vector>
 
 struct Window {
     s32 width;
@@ -25,6 +28,13 @@ struct RenderSystem final : public System {
         glm::vec4 light_position;
     };
 
+    // Only read by phong_compact.vert, see VertexQuantization. A block of its own so the per draw update leaves the
+    // camera constants alone.
+    struct QuantizationConstantLayout {
+        glm::vec4 position_offset{0.0, 0.0, 0.0, 0.0};
+        glm::vec4 position_scale{1.0, 1.0, 1.0, 0.0};
+    };
+
     struct PhongFragConstantLayout {
         glm::vec4 light_color{1.0, 1.0, 1.0, 1.0};
         glm::vec4 ambient_light{0.3, 0.3, 0.3, 1.0};
@@ -36,8 +46,11 @@ struct RenderSystem final : public System {
 
     focus::ConstantBuffer m_phong_vertex_constant_buffer;
     focus::ConstantBuffer m_phong_frag_constant_buffer;
+    focus::ConstantBuffer m_quantization_constant_buffer;
+    QuantizationConstantLayout m_quantization_constants{};
 
     focus::Pipeline m_phong_pipeline;
+    focus::Pipeline m_phong_compact_pipeline;
 
     GLuint m_vao;
 
@@ -89,26 +102,80 @@ struct RenderSystem final : public System {
         // Populate the Singleton Component for the buffer layouts
         focus::VertexBufferLayout phong_vertex_layout(0, focus::BufferUsage::Default, "INPUT");
         phong_vertex_layout.Add("vPosition", focus::VarType::Float3).Add("vNormal", focus::VarType::Float3);
+        // Normalized integer attributes for the compact VertexFormats, decoded in phong_compact.vert
+        focus::VertexBufferLayout phong_compact12_vertex_layout(0, focus::BufferUsage::Default, "INPUT");
+        phong_compact12_vertex_layout.Add("vPosition", focus::VarType::UShort4Norm)
+            .Add("vNormal", focus::VarType::Short2Norm);
+        focus::VertexBufferLayout phong_compact8_vertex_layout(0, focus::BufferUsage::Default, "INPUT");
+        phong_compact8_vertex_layout.Add("vPosition", focus::VarType::UShort3Norm)
+            .Add("vNormal", focus::VarType::Byte2Norm);
 
         focus::IndexBufferLayout phong_index_layout(focus::IndexBufferType::U32);
+        focus::IndexBufferLayout phong_u16_index_layout(focus::IndexBufferType::U16);
 
         focus::ConstantBufferLayout phong_vertex_constant_layout(0, focus::BufferUsage::Default, "vertexConstants");
         focus::ConstantBufferLayout phong_frag_constant_layout(1, focus::BufferUsage::Default, "fragConstants");
+        focus::ConstantBufferLayout quantization_constant_layout(
+            2, focus::BufferUsage::Default, "quantizationConstants");
 
         // TODO: Need to figure out if I'm just going to throw these into the registry or if I'll do some management
         // thing A mix of the two is probably a good approach
-        context.emplace<BufferLayouts>(
-            phong_vertex_layout, phong_index_layout, phong_vertex_constant_layout, phong_frag_constant_layout);
+        context.emplace<BufferLayouts>(phong_vertex_layout, phong_compact12_vertex_layout, phong_compact8_vertex_layout,
+            phong_index_layout, phong_u16_index_layout, phong_vertex_constant_layout, phong_frag_constant_layout);
         m_phong_vertex_constant_buffer =
             device->CreateConstantBuffer(phong_vertex_constant_layout, nullptr, sizeof(PhongVertexConstantLayout));
         m_phong_frag_constant_buffer =
             device->CreateConstantBuffer(phong_frag_constant_layout, nullptr, sizeof(PhongFragConstantLayout));
+        m_quantization_constant_buffer = device->CreateConstantBuffer(
+            quantization_constant_layout, &m_quantization_constants, sizeof(QuantizationConstantLayout));
 
         focus::PipelineState phong_pipeline_state = {
             .shader = device->CreateShaderFromSource("Phong", utils::ReadEntireFileAsString("shaders/phong.vert"),
                 utils::ReadEntireFileAsString("shaders/phong.frag")),
         };
         m_phong_pipeline = device->CreatePipeline(phong_pipeline_state);
+
+        focus::PipelineState phong_compact_pipeline_state = {
+            .shader = device->CreateShaderFromSource("Phong-Compact",
+                utils::ReadEntireFileAsString("shaders/phong_compact.vert"),
+                utils::ReadEntireFileAsString("shaders/phong.frag")),
+        };
+        m_phong_compact_pipeline = device->CreatePipeline(phong_compact_pipeline_state);
+    }
+
+    void DrawMeshBuffers(focus::Device *device, const MeshBuffers &buffers, bool compact)
+    {
+        // TODO (focus): Would be nice to use a single handle for multiple buffers, instead of constantly allocating
+        // a new vector each time or I could just save off the scene state
+        std::vector<focus::ConstantBuffer> constant_buffers = {
+            m_phong_vertex_constant_buffer, m_phong_frag_constant_buffer};
+        if (compact) {
+            constant_buffers.push_back(m_quantization_constant_buffer);
+        }
+        device->BindSceneState({
+            .vb_handles = {buffers.vertex_buffer},
+            .ib_handle = buffers.index_buffer,
+            .cb_handles = std::move(constant_buffers),
+        });
+        if (buffers.submeshes.empty()) {
+            device->Draw(focus::Primitive::Triangles, 0, buffers.index_count);
+            return;
+        }
+        // All the shapes of a file share one set of buffers, neighbouring submeshes that use the same material are
+        // drawn together
+        for (Size first = 0; first < buffers.submeshes.size();) {
+            Size last = first;
+            while (last + 1 < buffers.submeshes.size()
+                   && buffers.submeshes[last + 1].material_id == buffers.submeshes[first].material_id
+                   && buffers.submeshes[last + 1].index_offset
+                          == buffers.submeshes[last].index_offset + buffers.submeshes[last].index_count) {
+                last++;
+            }
+            const u32 offset = buffers.submeshes[first].index_offset;
+            const u32 count = buffers.submeshes[last].index_offset + buffers.submeshes[last].index_count - offset;
+            device->Draw(focus::Primitive::Triangles, offset, count);
+            first = last + 1;
+        }
     }
 
     void Run() override
@@ -119,11 +186,20 @@ struct RenderSystem final : public System {
         auto *device = m_registry.ctx().at<focus::Device *>();
         device->BeginPass("Phong pass");
         device->BindPipeline(m_phong_pipeline);
-        for (const auto &[entity, buffers, mesh] : m_registry.view<const MeshBuffers, const Mesh>().each()) {
-            // TODO (focus): Would be nice to use a single handle for multiple buffers, instead of constantly allocating
-            // a new vector each time or I could just save off the scene state
-            device->BindSceneState({.vb_handles = {buffers.vertex_buffer}, .ib_handle = buffers.index_buffer});
-            device->Draw(focus::Primitive::Triangles, 0, mesh.indices.size());
+        for (const auto &[entity, buffers] :
+            m_registry.view<const MeshBuffers>(entt::exclude<VertexQuantization>).each()) {
+            DrawMeshBuffers(device, buffers, false);
+        }
+
+        // Every compact mesh has its own bounds, so the quantization constants change per draw
+        device->BindPipeline(m_phong_compact_pipeline);
+        for (const auto &[entity, buffers, quantization] :
+            m_registry.view<const MeshBuffers, const VertexQuantization>().each()) {
+            m_quantization_constants.position_offset = glm::vec4(quantization.position_offset, 0.0f);
+            m_quantization_constants.position_scale = glm::vec4(quantization.position_scale, 0.0f);
+            device->UpdateConstantBuffer(
+                m_quantization_constant_buffer, &m_quantization_constants, sizeof(QuantizationConstantLayout));
+            DrawMeshBuffers(device, buffers, true);
         }
 
         device->EndPass();
@@ -0,0 +1,347 @@
+#include "signed_distance.hpp"
+
+#include "bvh.hpp"
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxel_morphology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace
+{
+
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+constexpr u32 SWEEP_BLOCK_SIZE = 16;
+
+// Squared distances and closest triangles while building, the field only gets square roots and signs at the end. A
+// squared distance of FLT_MAX marks voxels that don't have a closest triangle yet. Triangles are in the BVH's leaf
+// order, 4 bytes per voxel where a closest point would take 12.
+struct SweepState {
+    DistanceGrid &field;
+    std::span<const BvhTriangle> triangles;
+    std::vector<u32> &closest;
+    glm::ivec3 direction;
+    // Index offsets of the upwind neighbours voxel - direction * (step & 1, step >> 1 & 1, step >> 2)
+    s64 upwind_offsets[8];
+};
+
+void UpdateVoxel(SweepState &state, glm::uvec3 voxel)
+{
+    const glm::uvec3 dimensions = state.field.Dimensions();
+    const std::span<f32> distances = state.field.Values();
+    const Size index = state.field.Index(voxel.x, voxel.y, voxel.z);
+    const glm::vec3 center = state.field.VoxelCenter(voxel.x, voxel.y, voxel.z);
+    // Axes along which the upwind neighbour is inside the grid, as step bits
+    u32 inside = 0;
+    for (u32 axis = 0; axis < 3; axis++) {
+        const bool has_upwind = state.direction[axis] > 0 ? voxel[axis] > 0 : voxel[axis] + 1 < dimensions[axis];
+        inside |= (u32)has_upwind << axis;
+    }
+    f32 best = distances[index];
+    u32 best_triangle = state.closest[index];
+    // Neighbours mostly share a few triangles, each is only tried once
+    u32 tried[8] = {best_triangle};
+    u32 tried_count = 1;
+    for (u32 step = 1; step < 8; step++) {
+        if ((step & inside) != step) {
+            continue;
+        }
+        const Size neighbor = (Size)((s64)index - state.upwind_offsets[step]);
+        const u32 triangle = state.closest[neighbor];
+        if (distances[neighbor] == std::numeric_limits<f32>::max()
+            || std::find(tried, tried + tried_count, triangle) != tried + tried_count) {
+            continue;
+        }
+        tried[tried_count++] = triangle;
+        const glm::vec3 point = ClosestPointOnTriangle(center, state.triangles[triangle]);
+        const f32 distance_squared = glm::dot(point - center, point - center);
+        if (distance_squared < best) {
+            best = distance_squared;
+            best_triangle = triangle;
+        }
+    }
+    distances[index] = best;
+    state.closest[index] = best_triangle;
+}
+
+// Sweeps one block in direction with plain ordered loops
+void SweepBlock(SweepState &state, glm::uvec3 block)
+{
+    const glm::ivec3 direction = state.direction;
+    const glm::uvec3 begin = block * SWEEP_BLOCK_SIZE;
+    const glm::uvec3 end = glm::min(begin + SWEEP_BLOCK_SIZE, state.field.Dimensions());
+    const glm::uvec3 size = end - begin;
+    for (u32 i = 0; i < size.z; i++) {
+        const u32 z = direction.z > 0 ? begin.z + i : end.z - 1 - i;
+        for (u32 j = 0; j < size.y; j++) {
+            const u32 y = direction.y > 0 ? begin.y + j : end.y - 1 - j;
+            for (u32 k = 0; k < size.x; k++) {
+                UpdateVoxel(state, glm::uvec3(direction.x > 0 ? begin.x + k : end.x - 1 - k, y, z));
+            }
+        }
+    }
+}
+
+// One sweep in direction. Blocks are walked plane by plane, plane `level` holds the blocks whose distance along the
+// sweep, sx + sy + sz, equals level. Every upwind neighbour of a block lies in an earlier plane, so the blocks of a
+// plane are independent and the result matches a serial sweep.
+void Sweep(SweepState &state, glm::ivec3 direction)
+{
+    const glm::uvec3 dimensions = state.field.Dimensions();
+    state.direction = direction;
+    for (u32 step = 0; step < 8; step++) {
+        state.upwind_offsets[step] = (step & 1 ? direction.x : 0) + (step & 2 ? direction.y * (s64)dimensions.x : 0)
+                                     + (step & 4 ? direction.z * (s64)dimensions.x * dimensions.y : 0);
+    }
+    const glm::uvec3 last = (dimensions + SWEEP_BLOCK_SIZE - 1u) / SWEEP_BLOCK_SIZE - 1u;
+    const u32 level_count = last.x + last.y + last.z + 1;
+    const auto to_block = [&](u32 sx, u32 sy, u32 sz) {
+        return glm::uvec3(direction.x > 0 ? sx : last.x - sx, direction.y > 0 ? sy : last.y - sy,
+            direction.z > 0 ? sz : last.z - sz);
+    };
+    for (u32 level = 0; level < level_count; level++) {
+        const u32 z_begin = level > last.x + last.y ? level - last.x - last.y : 0;
+        const u32 z_end = std::min(last.z, level) + 1;
+        ParallelForRanges(z_end - z_begin, [&](Size begin, Size end, u32) {
+            for (u32 sz = z_begin + (u32)begin; sz < z_begin + (u32)end; sz++) {
+                const u32 rest = level - sz;
+                const u32 y_begin = rest > last.x ? rest - last.x : 0;
+                const u32 y_end = std::min(last.y, rest) + 1;
+                for (u32 sy = y_begin; sy < y_end; sy++) {
+                    SweepBlock(state, to_block(rest - sy, sy, sz));
+                }
+            }
+        });
+    }
+}
+
+} // namespace
+
+DistanceGrid::DistanceGrid(glm::uvec3 dimensions, glm::vec3 origin, f32 voxel_size, f32 value)
+    : m_dimensions(dimensions), m_origin(origin), m_voxel_size(voxel_size),
+      m_values((Size)dimensions.x * dimensions.y * dimensions.z, value)
+{
+}
+
+glm::vec3 DistanceGrid::VoxelCenter(u32 x, u32 y, u32 z) const
+{
+    return m_origin + (glm::vec3(x, y, z) + 0.5f) * m_voxel_size;
+}
+
+f32 DistanceGrid::Sample(const glm::vec3 &position) const
+{
+    if (m_values.empty()) {
+        return std::numeric_limits<f32>::max();
+    }
+    const glm::vec3 last = glm::vec3(m_dimensions - 1u);
+    const glm::vec3 p = glm::clamp(ToGridSpace(position) - 0.5f, glm::vec3(0.0f), last);
+    const glm::uvec3 base = glm::uvec3(p);
+    const glm::uvec3 next = glm::min(base + 1u, m_dimensions - 1u);
+    const glm::vec3 t = p - glm::vec3(base);
+    const auto lerp_x = [&](u32 y, u32 z) { return glm::mix(Get(base.x, y, z), Get(next.x, y, z), t.x); };
+    const f32 z0 = glm::mix(lerp_x(base.y, base.z), lerp_x(next.y, base.z), t.y);
+    const f32 z1 = glm::mix(lerp_x(base.y, next.z), lerp_x(next.y, next.z), t.y);
+    return glm::mix(z0, z1, t.z);
+}
+
+DistanceGrid BuildSignedDistanceField(
+    const Mesh &mesh, const GridPlacement &placement, const SignedDistanceOptions &options)
+{
+    VoxelGrid solid(placement.dimensions, placement.origin, placement.voxel_size);
+    if (!mesh.indices.empty()) {
+        VoxelizeSolid(mesh, solid, options.sign_mode);
+    }
+    return BuildSignedDistanceField(mesh, solid, options);
+}
+
+DistanceGrid BuildSignedDistanceField(const Mesh &mesh, const VoxelGrid &solid, const SignedDistanceOptions &options)
+{
+    const GridPlacement placement = {solid.Dimensions(), solid.Origin(), solid.VoxelSize()};
+    const glm::uvec3 dimensions = placement.dimensions;
+    DistanceGrid field(dimensions, placement.origin, placement.voxel_size, std::numeric_limits<f32>::max());
+    if (mesh.indices.empty()) {
+        return field;
+    }
+
+    VoxelGrid band(dimensions, placement.origin, placement.voxel_size);
+    VoxelizeSurface(mesh, band);
+    band = DilateVoxels(band, options.band_voxels);
+
+    const TriangleBvh bvh(mesh);
+    std::vector<u32> closest(field.VoxelCount(), BvhClosestPoint::NO_TRIANGLE);
+    // Surface voxels touch a triangle and every dilation moves at most one voxel diagonal further away
+    const f32 band_distance = (f32)(options.band_voxels + 1) * std::sqrt(3.0f) * placement.voxel_size;
+    ParallelFor(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            const auto words = band.Row(y, z);
+            // The previous voxel's closest point bounds the search for the next one, which is usually next to it
+            glm::vec3 previous_point;
+            bool has_previous = false;
+            for (u32 word = 0; word < words.size(); word++) {
+                for (u64 bits = words[word]; bits != 0; bits &= bits - 1) {
+                    const u32 x = word * 64 + (u32)std::countr_zero(bits);
+                    const glm::vec3 center = field.VoxelCenter(x, y, z);
+                    f32 bound = band_distance * band_distance;
+                    if (has_previous) {
+                        bound = std::min(bound, glm::dot(previous_point - center, previous_point - center) * 1.0001f);
+                    }
+                    const BvhClosestPoint hit = bvh.ClosestPoint(center, bound);
+                    has_previous = hit.triangle != BvhClosestPoint::NO_TRIANGLE;
+                    if (!has_previous) {
+                        // Left to the sweeps
+                        continue;
+                    }
+                    field.Values()[field.Index(x, y, z)] = hit.distance_squared;
+                    closest[field.Index(x, y, z)] = hit.triangle;
+                    previous_point = hit.point;
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+
+    SweepState state = {field, bvh.Triangles(), closest, {}, {}};
+    for (u32 round = 0; round < options.sweep_rounds; round++) {
+        for (u32 direction = 0; direction < 8; direction++) {
+            Sweep(state, glm::ivec3(direction & 1 ? -1 : 1, direction & 2 ? -1 : 1, direction & 4 ? -1 : 1));
+        }
+    }
+
+    ParallelFor(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            for (u32 x = 0; x < dimensions.x; x++) {
+                f32 &value = field.Values()[field.Index(x, y, z)];
+                value = solid.Get(x, y, z) ? -std::sqrt(value) : std::sqrt(value);
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    return field;
+}
+
+DistanceGrid BuildSignedDistanceField(const Mesh &mesh, u32 resolution, const SignedDistanceOptions &options)
+{
+    return BuildSignedDistanceField(mesh, PlaceGrid(ComputeBounds(mesh.vertices), resolution), options);
+}
+
+SparseDistanceGrid ToSparse(const DistanceGrid &grid, f32 max_distance)
+{
+    SparseDistanceGrid sparse(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    const glm::uvec3 dimensions = grid.Dimensions();
+    const glm::uvec3 bricks = sparse.BrickDimensions();
+    sparse.Reserve((Size)bricks.x * bricks.y * bricks.z);
+    // Only when the pool can't hold every brick of the grid, the dropped ones read as missing
+    std::atomic<u32> dropped_bricks = 0;
+    ParallelFor(
+        (Size)bricks.y * bricks.z,
+        [&](Size brick_row) {
+            const glm::uvec3 first_brick(0, brick_row % bricks.y, brick_row / bricks.y);
+            for (u32 bx = 0; bx < bricks.x; bx++) {
+                const glm::uvec3 begin = glm::uvec3(bx, first_brick.y, first_brick.z) * BRICK_SIZE;
+                const glm::uvec3 end = glm::min(begin + BRICK_SIZE, dimensions);
+                bool near_surface = false;
+                for (u32 z = begin.z; z < end.z && !near_surface; z++) {
+                    for (u32 y = begin.y; y < end.y && !near_surface; y++) {
+                        for (u32 x = begin.x; x < end.x && !near_surface; x++) {
+                            near_surface = std::abs(grid.Get(x, y, z)) <= max_distance;
+                        }
+                    }
+                }
+                if (!near_surface) {
+                    continue;
+                }
+                const u32 brick_index = sparse.FindOrInsertBrick(begin / BRICK_SIZE);
+                if (brick_index == SparseDistanceGrid::NO_BRICK) {
+                    dropped_bricks.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                DistanceBrick &brick = sparse.GetBrick(brick_index);
+                // Voxels past the end of the grid keep the distance of the last voxel, so samples near the border
+                // of a brick see no jump
+                for (u32 z = 0; z < BRICK_SIZE; z++) {
+                    for (u32 y = 0; y < BRICK_SIZE; y++) {
+                        for (u32 x = 0; x < BRICK_SIZE; x++) {
+                            const glm::uvec3 voxel = glm::min(begin + glm::uvec3(x, y, z), dimensions - 1u);
+                            brick.Set(x, y, z, grid.Get(voxel.x, voxel.y, voxel.z));
+                        }
+                    }
+                }
+            }
+        },
+        1);
+    if (dropped_bricks > 0) {
+        printf("Sparse distance grid is out of bricks, dropped %u\n", dropped_bricks.load());
+    }
+    sparse.ShrinkToFit();
+    return sparse;
+}
+
+f32 GetDistance(const SparseDistanceGrid &grid, u32 x, u32 y, u32 z, f32 missing)
+{
+    const u32 brick = grid.FindBrick(glm::uvec3(x, y, z) / BRICK_SIZE);
+    return brick == SparseDistanceGrid::NO_BRICK
+               ? missing
+               : grid.GetBrick(brick).Get(x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE);
+}
+
+void BenchmarkSignedDistance(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 SAMPLES = 20000;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    printf("%-24s %16s %12s %16s %16s %12s %12s\n", "file", "grid", "build ms", "mean error", "max error",
+        "dense KB", "sparse KB");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        const auto start = Clock::now();
+        const DistanceGrid field = BuildSignedDistanceField(mesh, resolution);
+        const f64 build_ms = std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+
+        // Errors in voxels against the exact distance, the sign is VoxelizeSolid's and isn't checked here
+        const TriangleBvh bvh(mesh);
+        const glm::uvec3 dimensions = field.Dimensions();
+        std::mt19937 random(1);
+        f64 total_error = 0.0;
+        f64 max_error = 0.0;
+        for (u32 i = 0; i < SAMPLES; i++) {
+            const u32 x = random() % dimensions.x;
+            const u32 y = random() % dimensions.y;
+            const u32 z = random() % dimensions.z;
+            const f32 exact = std::sqrt(bvh.ClosestPoint(field.VoxelCenter(x, y, z)).distance_squared);
+            const f64 error = std::abs(std::abs(field.Get(x, y, z)) - exact) / field.VoxelSize();
+            total_error += error;
+            max_error = std::max(max_error, error);
+        }
+
+        const SparseDistanceGrid sparse = ToSparse(field, 2.0f * field.VoxelSize());
+        const std::string grid_size = std::to_string(dimensions.x) + "x" + std::to_string(dimensions.y) + "x"
+                                      + std::to_string(dimensions.z);
+        printf("%-24s %16s %12.3f %16.6f %16.6f %12zu %12zu\n", path.filename().string().c_str(), grid_size.c_str(),
+            build_ms, total_error / SAMPLES, max_error, field.VoxelCount() * sizeof(f32) / 1024,
+            sparse.MemoryUsage() / 1024);
+    }
+}
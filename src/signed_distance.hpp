@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "sparse_voxel_grid.hpp"
+#include "voxel_grid.hpp"
+#include "voxelizer.hpp"
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// One distance per voxel, sampled at the voxel center and negative inside. Same placement conventions as VoxelGrid,
+// values are stored x fastest.
+class DistanceGrid
+{
+  public:
+    DistanceGrid() = default;
+    DistanceGrid(glm::uvec3 dimensions, glm::vec3 origin, f32 voxel_size, f32 value = 0.0f);
+
+    glm::uvec3 Dimensions() const { return m_dimensions; }
+    glm::vec3 Origin() const { return m_origin; }
+    f32 VoxelSize() const { return m_voxel_size; }
+    Size VoxelCount() const { return m_values.size(); }
+
+    Size Index(u32 x, u32 y, u32 z) const { return ((Size)z * m_dimensions.y + y) * m_dimensions.x + x; }
+    f32 Get(u32 x, u32 y, u32 z) const { return m_values[Index(x, y, z)]; }
+    void Set(u32 x, u32 y, u32 z, f32 value) { m_values[Index(x, y, z)] = value; }
+    std::span<f32> Values() { return m_values; }
+    std::span<const f32> Values() const { return m_values; }
+
+    glm::vec3 VoxelCenter(u32 x, u32 y, u32 z) const;
+    glm::vec3 ToGridSpace(const glm::vec3 &position) const { return (position - m_origin) / m_voxel_size; }
+    // Trilinear between voxel centers, positions outside the grid are clamped to the border
+    f32 Sample(const glm::vec3 &position) const;
+
+  private:
+    glm::uvec3 m_dimensions = {};
+    glm::vec3 m_origin = {};
+    f32 m_voxel_size = 1.0f;
+    std::vector<f32> m_values;
+};
+
+// 8^3 distances, x fastest
+struct DistanceBrick {
+    f32 values[BRICK_SIZE * BRICK_SIZE * BRICK_SIZE];
+
+    f32 Get(u32 x, u32 y, u32 z) const { return values[(z * BRICK_SIZE + y) * BRICK_SIZE + x]; }
+    void Set(u32 x, u32 y, u32 z, f32 value) { values[(z * BRICK_SIZE + y) * BRICK_SIZE + x] = value; }
+};
+
+using SparseDistanceGrid = BrickMap<DistanceBrick>;
+
+struct SignedDistanceOptions {
+    // Voxels up to this many voxels away from one touching a triangle get exact distances from the BVH, the rest
+    // inherit the closest point of a neighbour while sweeping
+    u32 band_voxels = 2;
+    // Rounds of all 8 sweep directions. One reaches every voxel, more only matter for shapes whose closest points
+    // change across a long way around
+    u32 sweep_rounds = 1;
+    SolidFillMode sign_mode = SolidFillMode::Parity;
+};
+
+// Exact distances in a narrow band from TriangleBvh::ClosestPoint, then fast sweeping (Zhao 2005) that propagates
+// closest triangles rather than solving the eikonal equation, like Bridson's makelevelset3. Sweeps run in parallel
+// over diagonal planes of blocks (Detrixhe et al. 2013, with the blocks of their 2016 hybrid method). Signs come from
+// VoxelizeSolid.
+DistanceGrid BuildSignedDistanceField(
+    const Mesh &mesh, const GridPlacement &placement, const SignedDistanceOptions &options = {});
+DistanceGrid BuildSignedDistanceField(const Mesh &mesh, u32 resolution, const SignedDistanceOptions &options = {});
+// Signs and placement from a solid the caller already voxelized, options.sign_mode is unused
+DistanceGrid BuildSignedDistanceField(
+    const Mesh &mesh, const VoxelGrid &solid, const SignedDistanceOptions &options = {});
+
+// Keeps the bricks with at least one voxel within max_distance of the surface
+SparseDistanceGrid ToSparse(const DistanceGrid &grid, f32 max_distance);
+// missing for voxels whose brick wasn't kept
+f32 GetDistance(const SparseDistanceGrid &grid, u32 x, u32 y, u32 z, f32 missing);
+
+// Build times plus the error of the swept distances against exact BVH queries, for every .obj in directory
+void BenchmarkSignedDistance(const char *directory, u32 resolution);
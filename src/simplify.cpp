@@ -0,0 +1,447 @@
+#include "simplify.hpp"
+
+#include "half_edge.hpp"
+#include "mesh_normals.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+constexpr u32 EMPTY_SLOT = std::numeric_limits<u32>::max();
+// How much more a boundary/material edge resists moving than the faces around it
+constexpr f64 CONSTRAINT_WEIGHT = 10.0;
+
+// Symmetric 4x4 matrix, sum of squared distances to a set of planes
+struct Quadric {
+    f64 a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    static Quadric FromPlane(const glm::dvec3 &normal, f64 d, f64 weight)
+    {
+        const f64 a = normal.x, b = normal.y, c = normal.z;
+        return {a * a * weight, a * b * weight, a * c * weight, a * d * weight, b * b * weight, b * c * weight,
+            b * d * weight, c * c * weight, c * d * weight, d * d * weight};
+    }
+
+    Quadric &operator+=(const Quadric &q)
+    {
+        a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad, b2 += q.b2;
+        bc += q.bc, bd += q.bd, c2 += q.c2, cd += q.cd, d2 += q.d2;
+        return *this;
+    }
+
+    f64 Evaluate(const glm::dvec3 &p) const
+    {
+        return a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x + b2 * p.y * p.y
+               + 2 * bc * p.y * p.z + 2 * bd * p.y + c2 * p.z * p.z + 2 * cd * p.z + d2;
+    }
+
+    // Position with the smallest error, false when the 3x3 part is close to singular (flat or linear neighbourhood)
+    bool Minimize(glm::dvec3 &out) const
+    {
+        const f64 det = a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) + ac * (ab * bc - b2 * ac);
+        const f64 scale = std::max({std::abs(a2), std::abs(b2), std::abs(c2)});
+        if (std::abs(det) <= 1e-12 * scale * scale * scale) {
+            return false;
+        }
+        const f64 inv = 1.0 / det;
+        // Cramer's rule on A x = -b
+        const f64 x = -(ad * (b2 * c2 - bc * bc) - ab * (bd * c2 - bc * cd) + ac * (bd * bc - b2 * cd)) * inv;
+        const f64 y = -(a2 * (bd * c2 - cd * bc) - ad * (ab * c2 - bc * ac) + ac * (ab * cd - bd * ac)) * inv;
+        const f64 z = -(a2 * (b2 * cd - bc * bd) - ab * (ab * cd - bd * ac) + ad * (ab * bc - b2 * ac)) * inv;
+        out = {x, y, z};
+        return true;
+    }
+};
+
+struct Collapse {
+    f64 cost;
+    u32 v0;
+    u32 v1;
+    u32 version0;
+    u32 version1;
+    glm::dvec3 position;
+
+    // std heap functions build a max heap
+    bool operator<(const Collapse &other) const { return cost > other.cost; }
+};
+
+class Simplifier
+{
+  public:
+    Simplifier(const Mesh &mesh)
+    {
+        WeldTriangles(mesh);
+        const HalfEdgeMesh topology(m_triangles, m_positions.size());
+        BuildAdjacency(topology);
+        BuildQuadrics(topology);
+    }
+
+    u32 TriangleCount() const { return m_alive_triangles; }
+    f64 MaxError() const { return m_max_error; }
+
+    // False once nothing can be collapsed anymore
+    bool CollapseUntil(u32 target_triangles)
+    {
+        while (m_alive_triangles > target_triangles) {
+            if (m_heap.empty()) {
+                return false;
+            }
+            std::pop_heap(m_heap.begin(), m_heap.end());
+            const Collapse collapse = m_heap.back();
+            m_heap.pop_back();
+            if (m_removed[collapse.v0] || m_removed[collapse.v1] || m_version[collapse.v0] != collapse.version0
+                || m_version[collapse.v1] != collapse.version1) {
+                continue;
+            }
+            if (!IsCollapseValid(collapse.v0, collapse.v1, collapse.position)) {
+                continue;
+            }
+            m_max_error = std::max(m_max_error, collapse.cost);
+            Apply(collapse);
+        }
+        return true;
+    }
+
+    Mesh Snapshot() const
+    {
+        Mesh out;
+        std::vector<u32> remap(m_positions.size(), EMPTY_SLOT);
+        s32 current_submesh = -2;
+        for (u32 triangle = 0; triangle < m_triangle_submesh.size(); triangle++) {
+            if (m_dead[triangle]) {
+                continue;
+            }
+            if (m_triangle_submesh[triangle] != current_submesh) {
+                current_submesh = m_triangle_submesh[triangle];
+                out.submeshes.push_back({
+                    .index_offset = (u32)out.indices.size(),
+                    .material_id = current_submesh >= 0 ? m_submesh_materials[current_submesh] : -1,
+                });
+            }
+            for (u32 corner = 0; corner < 3; corner++) {
+                const u32 vertex = m_triangles[triangle * 3 + corner];
+                if (remap[vertex] == EMPTY_SLOT) {
+                    remap[vertex] = (u32)out.vertices.size();
+                    out.vertices.push_back({.position = glm::vec3(m_positions[vertex])});
+                }
+                out.indices.push_back(remap[vertex]);
+            }
+            out.submeshes.back().index_count += 3;
+        }
+        if (m_submesh_materials.empty()) {
+            out.submeshes.clear();
+        }
+        GenerateNormals(out);
+        return out;
+    }
+
+  private:
+    std::vector<glm::dvec3> m_positions;
+    std::vector<Quadric> m_quadrics;
+    std::vector<u32> m_version;
+    std::vector<bool> m_removed;
+    // Marks visited vertices during neighbourhood walks, compared against m_stamp
+    mutable std::vector<u32> m_marks;
+    mutable u32 m_stamp = 0;
+
+    std::vector<u32> m_triangles;
+    std::vector<s32> m_triangle_submesh;
+    std::vector<s32> m_submesh_materials;
+    std::vector<bool> m_dead;
+    u32 m_alive_triangles = 0;
+
+    std::vector<std::vector<u32>> m_vertex_triangles;
+    std::vector<Collapse> m_heap;
+    f64 m_max_error = 0.0;
+
+    void WeldTriangles(const Mesh &mesh)
+    {
+        std::vector<u32> order(mesh.vertices.size());
+        for (u32 i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        const auto key = [&](u32 i) {
+            const glm::vec3 &p = mesh.vertices[i].position;
+            return std::tuple(std::bit_cast<u32>(p.x), std::bit_cast<u32>(p.y), std::bit_cast<u32>(p.z));
+        };
+        std::sort(order.begin(), order.end(), [&](u32 a, u32 b) { return key(a) < key(b); });
+
+        std::vector<u32> remap(mesh.vertices.size());
+        for (Size i = 0; i < order.size(); i++) {
+            if (i == 0 || key(order[i]) != key(order[i - 1])) {
+                m_positions.push_back(glm::dvec3(mesh.vertices[order[i]].position));
+            }
+            remap[order[i]] = (u32)m_positions.size() - 1;
+        }
+
+        std::vector<s32> input_submesh(mesh.indices.size() / 3, -1);
+        for (Size submesh = 0; submesh < mesh.submeshes.size(); submesh++) {
+            const Submesh &range = mesh.submeshes[submesh];
+            std::fill_n(input_submesh.begin() + range.index_offset / 3, range.index_count / 3, (s32)submesh);
+            m_submesh_materials.push_back(range.material_id);
+        }
+        // Collapsed positions can make a triangle degenerate, but starting out with one would only confuse the flip
+        // test and the topology
+        for (u32 triangle = 0; triangle < mesh.indices.size() / 3; triangle++) {
+            const u32 v0 = remap[mesh.indices[triangle * 3]];
+            const u32 v1 = remap[mesh.indices[triangle * 3 + 1]];
+            const u32 v2 = remap[mesh.indices[triangle * 3 + 2]];
+            if (v0 == v1 || v1 == v2 || v2 == v0) {
+                continue;
+            }
+            m_triangles.insert(m_triangles.end(), {v0, v1, v2});
+            m_triangle_submesh.push_back(input_submesh[triangle]);
+        }
+        m_alive_triangles = (u32)m_triangle_submesh.size();
+        m_dead.assign(m_alive_triangles, false);
+        m_version.assign(m_positions.size(), 0);
+        m_removed.assign(m_positions.size(), false);
+        m_marks.assign(m_positions.size(), 0);
+    }
+
+    void BuildAdjacency(const HalfEdgeMesh &topology)
+    {
+        m_vertex_triangles.resize(m_positions.size());
+        for (u32 vertex = 0; vertex < m_positions.size(); vertex++) {
+            for (u32 half_edge : topology.Outgoing(vertex)) {
+                m_vertex_triangles[vertex].push_back(HalfEdgeMesh::Face(half_edge));
+            }
+        }
+    }
+
+    glm::dvec3 FaceNormal(u32 triangle) const
+    {
+        const glm::dvec3 &p0 = m_positions[m_triangles[triangle * 3]];
+        const glm::dvec3 &p1 = m_positions[m_triangles[triangle * 3 + 1]];
+        const glm::dvec3 &p2 = m_positions[m_triangles[triangle * 3 + 2]];
+        return glm::cross(p1 - p0, p2 - p0);
+    }
+
+    void BuildQuadrics(const HalfEdgeMesh &topology)
+    {
+        m_quadrics.assign(m_positions.size(), {});
+        for (u32 triangle = 0; triangle < m_dead.size(); triangle++) {
+            // The cross product is twice the area, so the plane ends up weighted by area
+            const glm::dvec3 normal = FaceNormal(triangle);
+            const f64 length = glm::length(normal);
+            if (length <= 0.0) {
+                continue;
+            }
+            const glm::dvec3 unit = normal / length;
+            const Quadric q =
+                Quadric::FromPlane(unit, -glm::dot(unit, m_positions[m_triangles[triangle * 3]]), length * 0.5);
+            for (u32 corner = 0; corner < 3; corner++) {
+                m_quadrics[m_triangles[triangle * 3 + corner]] += q;
+            }
+        }
+
+        // Each undirected edge is handled by the lowest half-edge of its radial cycle
+        std::vector<u32> edges;
+        for (u32 half_edge = 0; half_edge < topology.HalfEdgeCount(); half_edge++) {
+            bool lowest = true;
+            bool mixed_submeshes = false;
+            for (u32 face : topology.EdgeFaces(half_edge)) {
+                lowest &= face >= HalfEdgeMesh::Face(half_edge);
+                mixed_submeshes |= m_triangle_submesh[face] != m_triangle_submesh[HalfEdgeMesh::Face(half_edge)];
+            }
+            if (!lowest) {
+                continue;
+            }
+            edges.push_back(half_edge);
+            // Boundary, non-manifold and material edges get a plane perpendicular to each adjacent face
+            if (topology.Twin(half_edge) == NO_HALF_EDGE || mixed_submeshes) {
+                u32 member = half_edge;
+                do {
+                    AddConstraint(topology.Origin(member), topology.Target(member), HalfEdgeMesh::Face(member));
+                    member = topology.Radial(member);
+                } while (member != half_edge);
+            }
+        }
+        for (u32 half_edge : edges) {
+            PushCollapse(topology.Origin(half_edge), topology.Target(half_edge));
+        }
+    }
+
+    void AddConstraint(u32 a, u32 b, u32 triangle)
+    {
+        const glm::dvec3 direction = m_positions[b] - m_positions[a];
+        const glm::dvec3 plane_normal = glm::cross(direction, FaceNormal(triangle));
+        const f64 length = glm::length(plane_normal);
+        if (length <= 0.0) {
+            return;
+        }
+        const glm::dvec3 unit = plane_normal / length;
+        const Quadric q = Quadric::FromPlane(
+            unit, -glm::dot(unit, m_positions[a]), glm::dot(direction, direction) * CONSTRAINT_WEIGHT);
+        m_quadrics[a] += q;
+        m_quadrics[b] += q;
+    }
+
+    void PushCollapse(u32 v0, u32 v1)
+    {
+        Quadric q = m_quadrics[v0];
+        q += m_quadrics[v1];
+        // Stays the midpoint when every candidate cost is NaN
+        glm::dvec3 position = (m_positions[v0] + m_positions[v1]) * 0.5;
+        f64 cost;
+        if (q.Minimize(position)) {
+            cost = q.Evaluate(position);
+        } else {
+            // Pick the best of the endpoints and the midpoint
+            const glm::dvec3 candidates[3] = {
+                m_positions[v0], m_positions[v1], (m_positions[v0] + m_positions[v1]) * 0.5};
+            cost = std::numeric_limits<f64>::max();
+            for (const auto &candidate : candidates) {
+                const f64 candidate_cost = q.Evaluate(candidate);
+                if (candidate_cost < cost) {
+                    cost = candidate_cost;
+                    position = candidate;
+                }
+            }
+        }
+        m_heap.push_back({std::max(cost, 0.0), v0, v1, m_version[v0], m_version[v1], position});
+        std::push_heap(m_heap.begin(), m_heap.end());
+    }
+
+    bool Contains(u32 triangle, u32 vertex) const
+    {
+        const u32 *v = &m_triangles[triangle * 3];
+        return v[0] == vertex || v[1] == vertex || v[2] == vertex;
+    }
+
+    bool IsCollapseValid(u32 v0, u32 v1, const glm::dvec3 &position) const
+    {
+        // Link condition: the only vertices both endpoints see must be the ones opposite the shared triangles,
+        // otherwise the collapse pinches the surface into a non-manifold edge
+        m_stamp++;
+        u32 shared_triangles = 0;
+        // Triangles die without being removed from the lists of their other vertices, skip them everywhere
+        for (u32 triangle : m_vertex_triangles[v0]) {
+            if (m_dead[triangle]) {
+                continue;
+            }
+            for (u32 corner = 0; corner < 3; corner++) {
+                m_marks[m_triangles[triangle * 3 + corner]] = m_stamp;
+            }
+            shared_triangles += Contains(triangle, v1);
+        }
+        const u32 first_stamp = m_stamp++;
+        u32 shared_neighbours = 0;
+        for (u32 triangle : m_vertex_triangles[v1]) {
+            if (m_dead[triangle]) {
+                continue;
+            }
+            for (u32 corner = 0; corner < 3; corner++) {
+                const u32 vertex = m_triangles[triangle * 3 + corner];
+                if (vertex != v0 && vertex != v1 && m_marks[vertex] == first_stamp) {
+                    m_marks[vertex] = m_stamp;
+                    shared_neighbours++;
+                }
+            }
+        }
+        if (shared_neighbours != shared_triangles) {
+            return false;
+        }
+
+        // Reject collapses that turn a surviving triangle over
+        for (u32 vertex : {v0, v1}) {
+            for (u32 triangle : m_vertex_triangles[vertex]) {
+                if (m_dead[triangle] || (Contains(triangle, v0) && Contains(triangle, v1))) {
+                    continue;
+                }
+                glm::dvec3 p[3];
+                for (u32 corner = 0; corner < 3; corner++) {
+                    const u32 corner_vertex = m_triangles[triangle * 3 + corner];
+                    p[corner] = corner_vertex == vertex ? position : m_positions[corner_vertex];
+                }
+                const glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                if (glm::dot(after, FaceNormal(triangle)) <= 0.0) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void Apply(const Collapse &collapse)
+    {
+        const u32 v0 = collapse.v0;
+        const u32 v1 = collapse.v1;
+        m_positions[v0] = collapse.position;
+        m_quadrics[v0] += m_quadrics[v1];
+
+        auto &triangles = m_vertex_triangles[v0];
+        for (u32 triangle : m_vertex_triangles[v1]) {
+            if (m_dead[triangle]) {
+                continue;
+            }
+            if (Contains(triangle, v0)) {
+                m_dead[triangle] = true;
+                m_alive_triangles--;
+                continue;
+            }
+            for (u32 corner = 0; corner < 3; corner++) {
+                if (m_triangles[triangle * 3 + corner] == v1) {
+                    m_triangles[triangle * 3 + corner] = v0;
+                }
+            }
+            triangles.push_back(triangle);
+        }
+        std::erase_if(triangles, [&](u32 triangle) { return m_dead[triangle]; });
+        m_vertex_triangles[v1].clear();
+        m_vertex_triangles[v1].shrink_to_fit();
+        m_removed[v1] = true;
+        m_version[v0]++;
+
+        // Every edge around v0 changed cost, the old heap entries are stale through the version check
+        m_stamp++;
+        for (u32 triangle : triangles) {
+            for (u32 corner = 0; corner < 3; corner++) {
+                const u32 vertex = m_triangles[triangle * 3 + corner];
+                if (vertex != v0 && m_marks[vertex] != m_stamp) {
+                    m_marks[vertex] = m_stamp;
+                    PushCollapse(v0, vertex);
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+MeshLods BuildLodChain(const Mesh &mesh, std::span<const f32> target_ratios)
+{
+    MeshLods lods;
+    if (mesh.indices.size() < 3 || target_ratios.empty()) {
+        return lods;
+    }
+    Simplifier simplifier(mesh);
+    const u32 input_triangles = (u32)(mesh.indices.size() / 3);
+    for (f32 ratio : target_ratios) {
+        const u32 target = (u32)std::max(1.0f, std::round(ratio * (f32)input_triangles));
+        simplifier.CollapseUntil(target);
+        lods.levels.push_back({
+            .target_ratio = ratio,
+            .max_error = (f32)simplifier.MaxError(),
+            .mesh = simplifier.Snapshot(),
+        });
+    }
+    return lods;
+}
+
+void PrintLodChain(const char *name, const Mesh &mesh, const MeshLods &lods, f64 milliseconds)
+{
+    printf("LODs for %s (%.2f ms): %zu triangles", name, milliseconds, mesh.indices.size() / 3);
+    for (const MeshLod &level : lods.levels) {
+        printf(" -> %zu", level.mesh.indices.size() / 3);
+    }
+    printf("\n");
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <span>
+
+// Garland-Heckbert quadric edge collapse. Vertices are merged by position first so seams between vertices that only
+// differ in their normal don't tear, the normals of each level are regenerated afterwards. Edges on the mesh boundary
+// and between submeshes are kept in place by extra constraint planes.
+//
+// target_ratios are fractions of the input triangle count in decreasing order, e.g. {0.5, 0.25, 0.125}. The whole chain
+// comes out of a single collapse sequence, each level is a snapshot taken once the triangle count drops to its target.
+// A level can end up with more triangles than asked for when no more collapses are allowed without folding triangles
+// over.
+MeshLods BuildLodChain(const Mesh &mesh, std::span<const f32> target_ratios);
+
+void PrintLodChain(const char *name, const Mesh &mesh, const MeshLods &lods, f64 milliseconds);
@@ -0,0 +1,36 @@
+#include "sparse_voxel_grid.hpp"
+
+SparseVoxelGrid CreateSparseGridForBounds(const Bounds &bounds, u32 resolution, u32 padding)
+{
+    const GridPlacement placement = PlaceGrid(bounds, resolution, padding);
+    return SparseVoxelGrid(placement.dimensions, placement.origin, placement.voxel_size);
+}
+
+Size CountSolid(const SparseVoxelGrid &grid)
+{
+    Size count = 0;
+    for (u32 brick = 0; brick < grid.BrickCount(); brick++) {
+        for (u64 word : grid.GetBrick(brick).words) {
+            count += std::popcount(word);
+        }
+    }
+    return count;
+}
+
+VoxelGrid ToDense(const SparseVoxelGrid &grid)
+{
+    VoxelGrid dense(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    const glm::uvec3 dimensions = grid.Dimensions();
+    for (const auto &brick : grid.SortedBricks()) {
+        const OccupancyBrick &bits = grid.GetBrick(brick.index);
+        const glm::uvec3 base = brick.coordinate * BRICK_SIZE;
+        for (u32 z = 0; z < BRICK_SIZE && base.z + z < dimensions.z; z++) {
+            for (u32 y = 0; y < BRICK_SIZE && base.y + y < dimensions.y; y++) {
+                // The 8 bits of a brick row land on an 8 aligned offset, so they never straddle two words
+                const u64 row_bits = (bits.words[z] >> (y * BRICK_SIZE)) & 0xFF;
+                dense.Row(base.y + y, base.z + z)[base.x / 64] |= row_bits << (base.x % 64);
+            }
+        }
+    }
+    return dense;
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include "common.h"
+#include "morton.hpp"
+#include "voxel_grid.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <glm/vec3.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
+
+constexpr u32 BRICK_SIZE = 8;
+
+// 8^3 occupancy bits, word z holds the 8x8 slice at that z with bit y * 8 + x
+struct OccupancyBrick {
+    u64 words[BRICK_SIZE];
+
+    bool Get(u32 x, u32 y, u32 z) const { return (words[z] >> (y * BRICK_SIZE + x)) & 1; }
+    void Set(u32 x, u32 y, u32 z) { words[z] |= 1ull << (y * BRICK_SIZE + x); }
+    void SetAtomic(u32 x, u32 y, u32 z)
+    {
+        std::atomic_ref<u64>(words[z]).fetch_or(1ull << (y * BRICK_SIZE + x), std::memory_order_relaxed);
+    }
+};
+
+// Append only storage for bricks. Bricks live in fixed size blocks that are never moved, so references stay valid
+// while other threads allocate. Allocation is a fetch_add plus, for the first brick of a block, a CAS to publish the
+// block.
+template<typename Brick>
+class BrickPool
+{
+  public:
+    static constexpr u32 BLOCK_SHIFT = 10;
+    static constexpr u32 BLOCK_SIZE = 1u << BLOCK_SHIFT;
+    static constexpr u32 MAX_BLOCKS = 1u << 14;
+    static constexpr u32 OUT_OF_BRICKS = 0xFFFFFFFF;
+
+    BrickPool() : m_blocks(new std::atomic<Brick *>[MAX_BLOCKS]()) {}
+    ~BrickPool() { Release(); }
+    BrickPool(const BrickPool &) = delete;
+    BrickPool &operator=(const BrickPool &) = delete;
+    BrickPool(BrickPool &&other) noexcept
+        : m_blocks(std::move(other.m_blocks)), m_count(other.m_count.load(std::memory_order_relaxed))
+    {
+    }
+    BrickPool &operator=(BrickPool &&other) noexcept
+    {
+        Release();
+        m_blocks = std::move(other.m_blocks);
+        m_count.store(other.m_count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+
+    // Returns a zeroed brick, or OUT_OF_BRICKS once all MAX_BLOCKS blocks are used up
+    u32 Allocate()
+    {
+        const u32 index = m_count.fetch_add(1, std::memory_order_relaxed);
+        const u32 block = index >> BLOCK_SHIFT;
+        if (block >= MAX_BLOCKS) {
+            m_count.fetch_sub(1, std::memory_order_relaxed);
+            return OUT_OF_BRICKS;
+        }
+        if (m_blocks[block].load(std::memory_order_acquire) == nullptr) {
+            Brick *fresh = new Brick[BLOCK_SIZE]();
+            Brick *expected = nullptr;
+            if (!m_blocks[block].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) {
+                delete[] fresh;
+            }
+        }
+        return index;
+    }
+
+    Brick &operator[](u32 index)
+    {
+        return m_blocks[index >> BLOCK_SHIFT].load(std::memory_order_acquire)[index & (BLOCK_SIZE - 1)];
+    }
+    const Brick &operator[](u32 index) const
+    {
+        return m_blocks[index >> BLOCK_SHIFT].load(std::memory_order_acquire)[index & (BLOCK_SIZE - 1)];
+    }
+
+    u32 Count() const { return m_count.load(std::memory_order_relaxed); }
+    Size AllocatedBytes() const
+    {
+        return (Size)((Count() + BLOCK_SIZE - 1) >> BLOCK_SHIFT) * BLOCK_SIZE * sizeof(Brick);
+    }
+
+  private:
+    std::unique_ptr<std::atomic<Brick *>[]> m_blocks;
+    std::atomic<u32> m_count{0};
+
+    void Release()
+    {
+        if (!m_blocks) {
+            return;
+        }
+        for (u32 block = 0; block < MAX_BLOCKS; block++) {
+            delete[] m_blocks[block].load(std::memory_order_relaxed);
+        }
+        m_blocks.reset();
+    }
+};
+
+// Two level sparse grid: an open addressing hash from brick coordinate to an index in a BrickPool. Keys are the Morton
+// codes of the brick coordinates, so sorting them gives Z-order iteration for free.
+//
+// Set grows the table as needed. FindOrInsertBrick and SetAtomic may run on many threads at once without a lock but
+// never grow it, so Reserve() room for every brick that gets inserted that way first. Reserve itself and everything that
+// reads the whole table must not overlap with insertion.
+template<typename Brick>
+class BrickMap
+{
+  public:
+    static constexpr u32 NO_BRICK = BrickPool<Brick>::OUT_OF_BRICKS;
+
+    struct BrickRef {
+        glm::uvec3 coordinate;
+        u32 index;
+    };
+
+    BrickMap() = default;
+    BrickMap(glm::uvec3 dimensions, glm::vec3 origin, f32 voxel_size)
+        : m_dimensions(dimensions), m_origin(origin), m_voxel_size(voxel_size)
+    {
+        Reserve(64);
+    }
+
+    glm::uvec3 Dimensions() const { return m_dimensions; }
+    glm::vec3 Origin() const { return m_origin; }
+    f32 VoxelSize() const { return m_voxel_size; }
+    glm::uvec3 BrickDimensions() const { return (m_dimensions + BRICK_SIZE - 1u) / BRICK_SIZE; }
+    glm::vec3 ToGridSpace(const glm::vec3 &position) const { return (position - m_origin) / m_voxel_size; }
+
+    u32 BrickCount() const { return m_pool.Count(); }
+    Brick &GetBrick(u32 index) { return m_pool[index]; }
+    const Brick &GetBrick(u32 index) const { return m_pool[index]; }
+    // Table and pool, the bricks themselves are most of it
+    Size MemoryUsage() const { return m_pool.AllocatedBytes() + (m_mask + 1) * sizeof(Slot); }
+
+    // Room for brick_count bricks at a load factor of at most one half. Not thread safe.
+    void Reserve(Size brick_count)
+    {
+        const Size capacity = TableCapacity(brick_count);
+        if (!m_slots || capacity > m_mask + 1) {
+            Rehash(capacity);
+        }
+    }
+
+    // Drops the table slack left by a generous Reserve before a parallel insertion. Not thread safe.
+    void ShrinkToFit()
+    {
+        const Size capacity = TableCapacity(BrickCount());
+        if (m_slots && capacity < m_mask + 1) {
+            Rehash(capacity);
+        }
+    }
+
+    u32 FindBrick(glm::uvec3 brick) const
+    {
+        const u64 key = MortonEncode(brick.x, brick.y, brick.z);
+        const Size slot = Probe(key);
+        return slot != NO_SLOT && m_slots[slot].key.load(std::memory_order_acquire) == key
+                   ? WaitForBrick(m_slots[slot])
+                   : NO_BRICK;
+    }
+
+    // NO_BRICK when the brick is new and the table or the pool is full
+    u32 FindOrInsertBrick(glm::uvec3 brick)
+    {
+        const u64 key = MortonEncode(brick.x, brick.y, brick.z);
+        Size index = Hash(key) & m_mask;
+        for (Size probes = 0; probes <= m_mask; probes++, index = (index + 1) & m_mask) {
+            Slot &slot = m_slots[index];
+            u64 current = slot.key.load(std::memory_order_acquire);
+            if (current == EMPTY_KEY) {
+                if (slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                    // Out of bricks leaves the key behind with NO_BRICK, which every reader treats as absent
+                    const u32 brick_index = m_pool.Allocate();
+                    slot.brick.store(brick_index, std::memory_order_release);
+                    return brick_index;
+                }
+                // Lost the race, current now holds the winner's key
+            }
+            if (current == key) {
+                return WaitForBrick(slot);
+            }
+        }
+        return NO_BRICK;
+    }
+
+    bool Get(u32 x, u32 y, u32 z) const
+    {
+        const u32 brick = FindBrick(glm::uvec3(x, y, z) / BRICK_SIZE);
+        return brick != NO_BRICK && m_pool[brick].Get(x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE);
+    }
+    // Not thread safe, grows the table. False only when the pool is out of bricks.
+    bool Set(u32 x, u32 y, u32 z)
+    {
+        if (2 * ((Size)BrickCount() + 1) > m_mask + 1) {
+            Rehash(2 * (m_mask + 1));
+        }
+        const u32 brick = FindOrInsertBrick(glm::uvec3(x, y, z) / BRICK_SIZE);
+        if (brick == NO_BRICK) {
+            return false;
+        }
+        m_pool[brick].Set(x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE);
+        return true;
+    }
+    // Thread safe, false when a new brick doesn't fit in the reserved table or the pool
+    bool SetAtomic(u32 x, u32 y, u32 z)
+    {
+        const u32 brick = FindOrInsertBrick(glm::uvec3(x, y, z) / BRICK_SIZE);
+        if (brick == NO_BRICK) {
+            return false;
+        }
+        m_pool[brick].SetAtomic(x % BRICK_SIZE, y % BRICK_SIZE, z % BRICK_SIZE);
+        return true;
+    }
+
+    // Active bricks sorted by Morton code of their coordinate. Not thread safe with insertion.
+    std::vector<BrickRef> SortedBricks() const
+    {
+        std::vector<std::pair<u64, u32>> keys;
+        keys.reserve(BrickCount());
+        for (Size slot = 0; slot <= m_mask; slot++) {
+            const u64 key = m_slots[slot].key.load(std::memory_order_relaxed);
+            const u32 brick = m_slots[slot].brick.load(std::memory_order_relaxed);
+            if (key != EMPTY_KEY && brick != NO_BRICK) {
+                keys.push_back({key, brick});
+            }
+        }
+        std::sort(keys.begin(), keys.end());
+        std::vector<BrickRef> bricks(keys.size());
+        for (Size i = 0; i < keys.size(); i++) {
+            bricks[i] = {MortonDecode(keys[i].first), keys[i].second};
+        }
+        return bricks;
+    }
+
+  private:
+    static constexpr u64 EMPTY_KEY = ~0ull;
+    static constexpr Size NO_SLOT = ~(Size)0;
+    // Key published, brick index still being allocated
+    static constexpr u32 PENDING_BRICK = NO_BRICK - 1;
+
+    struct Slot {
+        std::atomic<u64> key{EMPTY_KEY};
+        std::atomic<u32> brick{PENDING_BRICK};
+    };
+
+    glm::uvec3 m_dimensions = {};
+    glm::vec3 m_origin = {};
+    f32 m_voxel_size = 1.0f;
+    std::unique_ptr<Slot[]> m_slots;
+    Size m_mask = 0;
+    BrickPool<Brick> m_pool;
+
+    static Size TableCapacity(Size brick_count) { return std::bit_ceil(std::max<Size>(2 * brick_count, 16)); }
+
+    void Rehash(Size capacity)
+    {
+        std::unique_ptr<Slot[]> old_slots = std::move(m_slots);
+        const Size old_capacity = old_slots ? m_mask + 1 : 0;
+        m_slots.reset(new Slot[capacity]);
+        m_mask = capacity - 1;
+        for (Size slot = 0; slot < old_capacity; slot++) {
+            const u64 key = old_slots[slot].key.load(std::memory_order_relaxed);
+            if (key != EMPTY_KEY) {
+                Slot &target = m_slots[Probe(key)];
+                target.key.store(key, std::memory_order_relaxed);
+                target.brick.store(old_slots[slot].brick.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    static u64 Hash(u64 key)
+    {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDull;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // Slot holding key, or the empty slot where it would go, NO_SLOT when the table is full without it
+    Size Probe(u64 key) const
+    {
+        Size index = Hash(key) & m_mask;
+        for (Size probes = 0; probes <= m_mask; probes++, index = (index + 1) & m_mask) {
+            const u64 current = m_slots[index].key.load(std::memory_order_acquire);
+            if (current == key || current == EMPTY_KEY) {
+                return index;
+            }
+        }
+        return NO_SLOT;
+    }
+
+    // The inserting thread publishes the key before it has a brick index
+    static u32 WaitForBrick(const Slot &slot)
+    {
+        u32 brick = slot.brick.load(std::memory_order_acquire);
+        while (brick == PENDING_BRICK) {
+            brick = slot.brick.load(std::memory_order_acquire);
+        }
+        return brick;
+    }
+};
+
+using SparseVoxelGrid = BrickMap<OccupancyBrick>;
+
+SparseVoxelGrid CreateSparseGridForBounds(const Bounds &bounds, u32 resolution, u32 padding = 1);
+Size CountSolid(const SparseVoxelGrid &grid);
+// Same geometry as grid, with every brick copied in
+VoxelGrid ToDense(const SparseVoxelGrid &grid);
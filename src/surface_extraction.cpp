@@ -0,0 +1,563 @@
+#include "surface_extraction.hpp"
+
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxelizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+#include <span>
+#include <string>
+
+namespace
+{
+
+// 12 crossed edges at most, every loop has at least 3 of them
+constexpr u32 MAX_CASE_TRIANGLES = 10;
+
+// Cube corner c sits at (c & 1, c >> 1 & 1, c >> 2 & 1). Edge axis * 4 + i runs along axis from the corner whose bits
+// on axes (axis + 1, axis + 2) are (i & 1, i >> 1).
+constexpr u32 EdgeCorner(u32 edge, u32 end)
+{
+    const u32 axis = edge / 4;
+    return ((edge & 1) << ((axis + 1) % 3)) | (((edge >> 1) & 1) << ((axis + 2) % 3)) | (end << axis);
+}
+
+constexpr u32 EdgeBetween(u32 a, u32 b)
+{
+    const u32 axis = (u32)std::countr_zero(a ^ b);
+    const u32 low = std::min(a, b);
+    return axis * 4 + ((low >> ((axis + 1) % 3)) & 1) + 2 * ((low >> ((axis + 2) % 3)) & 1);
+}
+
+// Bit axis * 2 + side for each of the two cube faces the edge lies on
+constexpr u32 EdgeFaces(u32 edge)
+{
+    const u32 axis = edge / 4;
+    return (1u << (((axis + 1) % 3) * 2 + (edge & 1))) | (1u << (((axis + 2) % 3) * 2 + ((edge >> 1) & 1)));
+}
+
+constexpr bool OnOneFace(u32 a, u32 b, u32 c)
+{
+    return (EdgeFaces(a) & EdgeFaces(b) & EdgeFaces(c)) != 0;
+}
+
+struct MarchingCubesTables {
+    u8 triangle_counts[256];
+    // Crossed edges, three per triangle
+    u8 triangles[256][MAX_CASE_TRIANGLES * 3];
+};
+
+// Traced from the iso lines on the six faces of every case rather than typed in. On a face with two diagonal inside
+// corners the inside corners stay connected. That only depends on the face, so neighbouring cubes always agree and
+// the surface has no cracks.
+constexpr MarchingCubesTables BuildMarchingCubesTables()
+{
+    MarchingCubesTables tables = {};
+    for (u32 cube = 0; cube < 256; cube++) {
+        const auto inside = [cube](u32 corner) { return ((cube >> corner) & 1) != 0; };
+        // Walking each face counter clockwise as seen from outside the cube, an iso line that enters through an
+        // inside to outside edge e leaves through next[e]. Every crossed edge is entered on exactly one of its faces.
+        s32 next[12] = {};
+        for (s32 &edge : next) {
+            edge = -1;
+        }
+        for (u32 axis = 0; axis < 3; axis++) {
+            const u32 u = 1u << ((axis + 1) % 3);
+            const u32 v = 1u << ((axis + 2) % 3);
+            for (u32 side = 0; side < 2; side++) {
+                const u32 base = side << axis;
+                const u32 corners[4] = {base, base | (side ? u : v), base | u | v, base | (side ? v : u)};
+                for (u32 i = 0; i < 4; i++) {
+                    if (!inside(corners[i]) || inside(corners[(i + 1) % 4])) {
+                        continue;
+                    }
+                    for (u32 j = 1; j < 4; j++) {
+                        const u32 a = corners[(i + j) % 4];
+                        const u32 b = corners[(i + j + 1) % 4];
+                        if (inside(a) != inside(b)) {
+                            next[EdgeBetween(corners[i], corners[(i + 1) % 4])] = (s32)EdgeBetween(a, b);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        bool visited[12] = {};
+        u32 count = 0;
+        for (u32 start = 0; start < 12; start++) {
+            if (next[start] < 0 || visited[start]) {
+                continue;
+            }
+            u32 loop[12] = {};
+            u32 length = 0;
+            for (u32 edge = start; !visited[edge]; edge = (u32)next[edge]) {
+                visited[edge] = true;
+                loop[length++] = edge;
+            }
+            // A loop that crosses an ambiguous face twice has vertices on four edges of it. A triangle between three
+            // of them would lie in the face, on top of the neighbouring cube's, so the fan starts at a vertex that
+            // keeps every triangle off the faces. Such a vertex exists for every loop, see the static_assert below.
+            u32 apex = 0;
+            for (u32 candidate = 0; candidate < length; candidate++) {
+                bool flat = false;
+                for (u32 i = 1; i + 1 < length; i++) {
+                    flat = flat
+                           || OnOneFace(loop[candidate], loop[(candidate + i) % length],
+                               loop[(candidate + i + 1) % length]);
+                }
+                if (!flat) {
+                    apex = candidate;
+                    break;
+                }
+            }
+            // The loops wind clockwise seen from outside the surface, so the fan goes the other way round
+            for (u32 i = 1; i + 1 < length; i++) {
+                tables.triangles[cube][count * 3 + 0] = (u8)loop[apex];
+                tables.triangles[cube][count * 3 + 1] = (u8)loop[(apex + i + 1) % length];
+                tables.triangles[cube][count * 3 + 2] = (u8)loop[(apex + i) % length];
+                count++;
+            }
+        }
+        tables.triangle_counts[cube] = (u8)count;
+    }
+    return tables;
+}
+
+constexpr MarchingCubesTables MARCHING_CUBES = BuildMarchingCubesTables();
+
+static_assert(MARCHING_CUBES.triangle_counts[0] == 0 && MARCHING_CUBES.triangle_counts[255] == 0);
+static_assert(MARCHING_CUBES.triangle_counts[1] == 1 && MARCHING_CUBES.triangle_counts[3] == 2);
+
+constexpr bool NoTriangleOnAFace(const MarchingCubesTables &tables)
+{
+    for (u32 cube = 0; cube < 256; cube++) {
+        for (u32 i = 0; i < tables.triangle_counts[cube]; i++) {
+            const u8 *triangle = &tables.triangles[cube][i * 3];
+            if (OnOneFace(triangle[0], triangle[1], triangle[2])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(NoTriangleOnAFace(MARCHING_CUBES));
+
+glm::vec3 Gradient(const DistanceGrid &field, glm::uvec3 voxel)
+{
+    const glm::uvec3 dimensions = field.Dimensions();
+    glm::vec3 gradient(0.0f);
+    for (u32 axis = 0; axis < 3; axis++) {
+        glm::uvec3 low = voxel;
+        glm::uvec3 high = voxel;
+        low[axis] = low[axis] > 0 ? low[axis] - 1 : 0;
+        high[axis] = std::min(high[axis] + 1, dimensions[axis] - 1);
+        if (high[axis] > low[axis]) {
+            gradient[axis] = (field.Get(high.x, high.y, high.z) - field.Get(low.x, low.y, low.z))
+                             / (f32)(high[axis] - low[axis]);
+        }
+    }
+    return gradient;
+}
+
+// Bits [begin, end) of word
+u64 RangeMask(u32 word, u32 begin, u32 end)
+{
+    const u32 low = std::max(begin, word * 64) - word * 64;
+    const u32 high = std::min(end, word * 64 + 64) - word * 64;
+    return (high == 64 ? ~0ull : (1ull << high) - 1) & ~((1ull << low) - 1);
+}
+
+// First clear bit at or after begin
+u32 RunEnd(const u64 *bits, u32 words, u32 begin)
+{
+    u32 word = begin / 64;
+    u64 clear = ~bits[word] & (~0ull << (begin % 64));
+    while (clear == 0) {
+        if (++word == words) {
+            return words * 64;
+        }
+        clear = ~bits[word];
+    }
+    return word * 64 + (u32)std::countr_zero(clear);
+}
+
+bool AllSet(const u64 *bits, u32 begin, u32 end)
+{
+    for (u32 word = begin / 64; word * 64 < end; word++) {
+        const u64 mask = RangeMask(word, begin, end);
+        if ((bits[word] & mask) != mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ClearRange(u64 *bits, u32 begin, u32 end)
+{
+    for (u32 word = begin / 64; word * 64 < end; word++) {
+        bits[word] &= ~RangeMask(word, begin, end);
+    }
+}
+
+// Faces of one slice are laid out in a plane with one axis along the bits and one along the rows. x is the bit axis
+// whenever it lies in the plane, so those masks are whole word operations on grid rows.
+struct SlabAxes {
+    u32 axis;
+    u32 bit_axis;
+    u32 row_axis;
+};
+
+constexpr SlabAxes SLAB_AXES[3] = {{0, 1, 2}, {1, 0, 2}, {2, 0, 1}};
+
+// Faces of the voxels at slice along axis whose neighbour on the positive or negative side is empty
+void BuildFaceMask(const VoxelGrid &grid, const SlabAxes &axes, bool positive, u32 slice, std::vector<u64> &plane)
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    const u32 words = (dimensions[axes.bit_axis] + 63) / 64;
+    const u32 rows = dimensions[axes.row_axis];
+    plane.assign((Size)words * rows, 0);
+    const s64 neighbor_slice = (s64)slice + (positive ? 1 : -1);
+    const bool has_neighbor = neighbor_slice >= 0 && neighbor_slice < dimensions[axes.axis];
+    for (u32 row = 0; row < rows; row++) {
+        u64 *out = &plane[(Size)row * words];
+        if (axes.axis == 0) {
+            for (u32 bit = 0; bit < dimensions.y; bit++) {
+                const bool face =
+                    grid.Get(slice, bit, row) && !(has_neighbor && grid.Get((u32)neighbor_slice, bit, row));
+                out[bit / 64] |= (u64)face << (bit % 64);
+            }
+            continue;
+        }
+        const auto solid = axes.axis == 1 ? grid.Row(slice, row) : grid.Row(row, slice);
+        for (u32 word = 0; word < words; word++) {
+            u64 empty_neighbor = ~0ull;
+            if (has_neighbor) {
+                empty_neighbor = ~(axes.axis == 1 ? grid.Row((u32)neighbor_slice, row)[word]
+                                                  : grid.Row(row, (u32)neighbor_slice)[word]);
+            }
+            out[word] = solid[word] & empty_neighbor;
+        }
+    }
+}
+
+// Takes the longest run of faces in a row, grows it over the following rows while they contain the whole run, clears
+// what it covered and repeats
+template<typename Quad>
+void MergeFaces(std::vector<u64> &plane, u32 words, u32 rows, std::vector<Quad> &quads)
+{
+    for (u32 row = 0; row < rows; row++) {
+        u64 *bits = &plane[(Size)row * words];
+        for (u32 word = 0; word < words;) {
+            if (bits[word] == 0) {
+                word++;
+                continue;
+            }
+            const u32 begin = word * 64 + (u32)std::countr_zero(bits[word]);
+            const u32 end = RunEnd(bits, words, begin);
+            u32 row_end = row + 1;
+            while (row_end < rows && AllSet(&plane[(Size)row_end * words], begin, end)) {
+                row_end++;
+            }
+            for (u32 covered = row; covered < row_end; covered++) {
+                ClearRange(&plane[(Size)covered * words], begin, end);
+            }
+            quads.push_back({begin, end, row, row_end});
+        }
+    }
+}
+
+} // namespace
+
+void SurfaceExtractor::ExtractQuads(const VoxelGrid &grid, Mesh &out, const DeformedLattice *lattice)
+{
+    out.submeshes.clear();
+    const glm::uvec3 dimensions = grid.Dimensions();
+    // Slab order is direction major, direction = axis * 2 + positive
+    Size direction_offsets[7] = {};
+    for (u32 direction = 0; direction < 6; direction++) {
+        direction_offsets[direction + 1] = direction_offsets[direction] + dimensions[direction / 2];
+    }
+    const Size slab_count = direction_offsets[6];
+    const auto slab_direction = [&](Size slab) {
+        u32 direction = 0;
+        while (slab >= direction_offsets[direction + 1]) {
+            direction++;
+        }
+        return direction;
+    };
+
+    m_slab_quads.resize(slab_count);
+    m_planes.resize(WorkerCount());
+    ParallelForRanges(FrameWorkers(), slab_count, [&](Size begin, Size end, u32 range) {
+        std::vector<u64> &plane = m_planes[range];
+        for (Size slab = begin; slab < end; slab++) {
+            const u32 direction = slab_direction(slab);
+            const SlabAxes &axes = SLAB_AXES[direction / 2];
+            const u32 slice = (u32)(slab - direction_offsets[direction]);
+            BuildFaceMask(grid, axes, direction % 2 == 1, slice, plane);
+            m_slab_quads[slab].clear();
+            MergeFaces(plane, (dimensions[axes.bit_axis] + 63) / 64, dimensions[axes.row_axis], m_slab_quads[slab]);
+        }
+    });
+
+    m_slab_offsets.resize(slab_count + 1);
+    m_slab_offsets[0] = 0;
+    for (Size slab = 0; slab < slab_count; slab++) {
+        m_slab_offsets[slab + 1] = m_slab_offsets[slab] + m_slab_quads[slab].size();
+    }
+    out.vertices.resize(m_slab_offsets.back() * 4);
+    out.indices.resize(m_slab_offsets.back() * 6);
+
+    ParallelFor(FrameWorkers(), slab_count, [&](Size slab) {
+        const u32 direction = slab_direction(slab);
+        const SlabAxes &axes = SLAB_AXES[direction / 2];
+        const bool positive = direction % 2 == 1;
+        const u32 slice = (u32)(slab - direction_offsets[direction]);
+        glm::vec3 normal(0.0f);
+        normal[axes.axis] = positive ? 1.0f : -1.0f;
+        // Corners go (begin, begin), (end, begin), (end, end), (begin, end) in (bit, row). That's counter clockwise
+        // seen from the side bit axis x row axis points to, which is +x and +z but -y.
+        const bool counter_clockwise = positive != (axes.axis == 1);
+        Size quad_index = m_slab_offsets[slab];
+        for (const Quad &quad : m_slab_quads[slab]) {
+            const u32 bits[4] = {quad.bit_begin, quad.bit_end, quad.bit_end, quad.bit_begin};
+            const u32 rows[4] = {quad.row_begin, quad.row_begin, quad.row_end, quad.row_end};
+            const u32 first_vertex = (u32)(quad_index * 4);
+            for (u32 corner = 0; corner < 4; corner++) {
+                glm::vec3 position;
+                position[axes.axis] = (f32)(slice + (positive ? 1 : 0));
+                position[axes.bit_axis] = (f32)bits[corner];
+                position[axes.row_axis] = (f32)rows[corner];
+                out.vertices[first_vertex + corner] = {grid.Origin() + position * grid.VoxelSize(), normal};
+            }
+            u32 *indices = &out.indices[quad_index * 6];
+            const u32 order[6] = {0, 1, 2, 0, 2, 3};
+            for (u32 i = 0; i < 6; i++) {
+                // Swapping the second and third corner of each triangle flips it
+                const u32 corner = counter_clockwise || i % 3 == 0 ? order[i] : order[i % 3 == 1 ? i + 1 : i - 1];
+                indices[i] = first_vertex + corner;
+            }
+            quad_index++;
+        }
+    });
+    if (lattice) {
+        DeformInLattice(lattice->placement, lattice->nodes, out.vertices);
+    }
+}
+
+void SurfaceExtractor::ExtractMarchingCubes(
+    const DistanceGrid &field, Mesh &out, f32 iso, const DeformedLattice *lattice)
+{
+    out.submeshes.clear();
+    const glm::uvec3 dimensions = field.Dimensions();
+    if (glm::any(glm::lessThan(dimensions, glm::uvec3(2)))) {
+        out.vertices.clear();
+        out.indices.clear();
+        return;
+    }
+    // Cell (x, y, z) has the voxel centers (x, y, z) to (x + 1, y + 1, z + 1) as corners, a slab is one z layer
+    const glm::uvec3 cells = dimensions - 1u;
+    const Size cells_per_slab = (Size)cells.x * cells.y;
+    m_cases.resize(cells_per_slab * cells.z);
+    m_slab_offsets.resize(cells.z + 1);
+    m_slab_offsets[0] = 0;
+    ParallelFor(FrameWorkers(), cells.z, [&](Size z) {
+        u8 *cases = &m_cases[z * cells_per_slab];
+        Size triangle_count = 0;
+        for (u32 y = 0; y < cells.y; y++) {
+            for (u32 x = 0; x < cells.x; x++) {
+                u32 cube = 0;
+                for (u32 corner = 0; corner < 8; corner++) {
+                    const f32 value = field.Get(x + (corner & 1), y + ((corner >> 1) & 1), (u32)z + (corner >> 2));
+                    cube |= (u32)(value < iso) << corner;
+                }
+                cases[(Size)y * cells.x + x] = (u8)cube;
+                triangle_count += MARCHING_CUBES.triangle_counts[cube];
+            }
+        }
+        m_slab_offsets[z + 1] = triangle_count;
+    });
+    std::inclusive_scan(m_slab_offsets.begin(), m_slab_offsets.end(), m_slab_offsets.begin());
+    out.vertices.resize(m_slab_offsets.back() * 3);
+    out.indices.resize(m_slab_offsets.back() * 3);
+
+    ParallelFor(FrameWorkers(), cells.z, [&](Size z) {
+        const u8 *cases = &m_cases[z * cells_per_slab];
+        Size vertex = m_slab_offsets[z] * 3;
+        for (u32 y = 0; y < cells.y; y++) {
+            for (u32 x = 0; x < cells.x; x++) {
+                const u32 cube = cases[(Size)y * cells.x + x];
+                const u32 triangle_count = MARCHING_CUBES.triangle_counts[cube];
+                if (triangle_count == 0) {
+                    continue;
+                }
+                const glm::uvec3 cell(x, y, (u32)z);
+                Mesh::Vertex edge_vertices[12];
+                u32 computed = 0;
+                for (u32 i = 0; i < triangle_count * 3; i++) {
+                    const u32 edge = MARCHING_CUBES.triangles[cube][i];
+                    if (!(computed & (1u << edge))) {
+                        const u32 a = EdgeCorner(edge, 0);
+                        const u32 b = EdgeCorner(edge, 1);
+                        const glm::uvec3 corner_a = cell + glm::uvec3(a & 1, (a >> 1) & 1, a >> 2);
+                        const glm::uvec3 corner_b = cell + glm::uvec3(b & 1, (b >> 1) & 1, b >> 2);
+                        const f32 value_a = field.Get(corner_a.x, corner_a.y, corner_a.z);
+                        const f32 value_b = field.Get(corner_b.x, corner_b.y, corner_b.z);
+                        const f32 t = value_a != value_b ? (iso - value_a) / (value_b - value_a) : 0.5f;
+                        const glm::vec3 gradient =
+                            glm::mix(Gradient(field, corner_a), Gradient(field, corner_b), t);
+                        const f32 length = glm::length(gradient);
+                        glm::vec3 normal = length > 0.0f ? gradient / length : glm::vec3(0.0f);
+                        if (length <= 0.0f) {
+                            // Flat field, point from the inside corner to the outside one
+                            normal[edge / 4] = value_a < iso ? 1.0f : -1.0f;
+                        }
+                        edge_vertices[edge] = {glm::mix(field.VoxelCenter(corner_a.x, corner_a.y, corner_a.z),
+                                                   field.VoxelCenter(corner_b.x, corner_b.y, corner_b.z), t),
+                            normal};
+                        computed |= 1u << edge;
+                    }
+                    out.vertices[vertex] = edge_vertices[edge];
+                    out.indices[vertex] = (u32)vertex;
+                    vertex++;
+                }
+            }
+        }
+    });
+    if (lattice) {
+        DeformInLattice(lattice->placement, lattice->nodes, out.vertices);
+    }
+}
+
+u32 CheckMarchingCubesEdges(u32 size, u32 field_count)
+{
+    std::mt19937 random(size);
+    std::uniform_real_distribution<f32> value(-1.0f, 1.0f);
+    SurfaceExtractor extractor;
+    Mesh mesh;
+    u32 bad_fields = 0;
+    for (u32 i = 0; i < field_count; i++) {
+        DistanceGrid field(glm::uvec3(size), glm::vec3(0.0f), 1.0f);
+        for (f32 &v : field.Values()) {
+            v = value(random);
+        }
+        extractor.ExtractMarchingCubes(field, mesh);
+
+        // Vertices aren't shared, but neighbouring cubes compute a crossing from the same corners in the same order,
+        // so equal positions are equal bits
+        std::map<std::array<u32, 3>, u32> ids;
+        std::vector<u32> vertex_ids(mesh.vertices.size());
+        for (Size v = 0; v < mesh.vertices.size(); v++) {
+            const glm::vec3 &position = mesh.vertices[v].position;
+            const std::array<u32, 3> key = {std::bit_cast<u32>(position.x), std::bit_cast<u32>(position.y),
+                std::bit_cast<u32>(position.z)};
+            vertex_ids[v] = ids.emplace(key, (u32)ids.size()).first->second;
+        }
+        std::set<std::pair<u32, u32>> edges;
+        bool duplicated = false;
+        for (Size t = 0; t + 2 < mesh.indices.size() && !duplicated; t += 3) {
+            const u32 triangle[3] = {
+                vertex_ids[mesh.indices[t]], vertex_ids[mesh.indices[t + 1]], vertex_ids[mesh.indices[t + 2]]};
+            // A corner right at iso collapses crossings onto it, the zero area triangles that leaves aren't faults
+            if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0]) {
+                continue;
+            }
+            for (u32 corner = 0; corner < 3; corner++) {
+                duplicated = duplicated || !edges.insert({triangle[corner], triangle[(corner + 1) % 3]}).second;
+            }
+        }
+        bad_fields += duplicated;
+    }
+    return bad_fields;
+}
+
+void BenchmarkSurfaceExtraction(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    // The first run grows the buffers, the rest is what a frame costs once they're big enough
+    const auto cold_and_warm = [&](auto &&extract) {
+        auto start = Clock::now();
+        extract();
+        const f64 cold = std::chrono::duration<f64, std::milli>(Clock::now() - start).count();
+        f64 warm = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            start = Clock::now();
+            extract();
+            warm = std::min(warm, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return std::pair(cold, warm);
+    };
+
+    for (const u32 size : {4u, 6u}) {
+        printf("Marching cubes on 3000 random %u^3 fields: %u with a duplicated directed edge\n", size,
+            CheckMarchingCubesEdges(size, 3000));
+    }
+    printf("%-24s %16s %12s %12s %12s %14s %12s %12s %14s %14s %12s\n", "file", "grid", "quads", "cold ms", "warm ms",
+        "mc triangles", "cold ms", "warm ms", "twisted q ms", "twisted mc ms", "max error");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+        VoxelizeSolid(mesh, grid);
+        const DistanceGrid field = BuildSignedDistanceField(mesh, resolution);
+
+        SurfaceExtractor extractor;
+        Mesh quads;
+        Mesh triangles;
+        const auto [quads_cold, quads_warm] = cold_and_warm([&]() { extractor.ExtractQuads(grid, quads); });
+        const auto [cubes_cold, cubes_warm] =
+            cold_and_warm([&]() { extractor.ExtractMarchingCubes(field, triangles); });
+
+        // The twist of --bench-lattice over the voxel corners, extracting into it has to match embedding the rest
+        // output and deforming that
+        const GridPlacement placement = {grid.Dimensions(), grid.Origin(), grid.VoxelSize()};
+        const std::vector<glm::vec3> twisted = TwistedLatticeNodes(placement);
+        const DeformedLattice lattice = {placement, twisted};
+        Mesh twisted_quads;
+        Mesh twisted_triangles;
+        const f64 twisted_quads_ms =
+            cold_and_warm([&]() { extractor.ExtractQuads(grid, twisted_quads, &lattice); }).second;
+        const f64 twisted_cubes_ms =
+            cold_and_warm([&]() { extractor.ExtractMarchingCubes(field, twisted_triangles, 0.0f, &lattice); }).second;
+        f32 max_error = 0.0f;
+        const std::pair<const Mesh *, const Mesh *> outputs[] = {
+            {&quads, &twisted_quads}, {&triangles, &twisted_triangles}};
+        for (const auto &[rest, deformed] : outputs) {
+            std::vector<Mesh::Vertex> expected(rest->vertices.size());
+            DeformEmbedded(EmbedInLattice(rest->vertices, placement), twisted, expected);
+            for (Size i = 0; i < expected.size(); i++) {
+                max_error = std::max(max_error, glm::length(expected[i].position - deformed->vertices[i].position));
+            }
+        }
+
+        const glm::uvec3 dimensions = grid.Dimensions();
+        const std::string grid_size = std::to_string(dimensions.x) + "x" + std::to_string(dimensions.y) + "x"
+                                      + std::to_string(dimensions.z);
+        printf("%-24s %16s %12zu %12.3f %12.3f %14zu %12.3f %12.3f %14.3f %14.3f %12.3g\n",
+            path.filename().string().c_str(), grid_size.c_str(), quads.indices.size() / 6, quads_cold, quads_warm,
+            triangles.indices.size() / 3, cubes_cold, cubes_warm, twisted_quads_ms, twisted_cubes_ms, max_error);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "lattice_embedding.hpp"
+#include "signed_distance.hpp"
+#include "voxel_grid.hpp"
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// Deformed nodes of a lattice over the rest placement, laid out as in lattice_embedding.hpp. For a SimulationBody
+// that's BodyLatticePlacement(occupancy) and the nodes ScatterParticlesToNodes writes.
+struct DeformedLattice {
+    GridPlacement placement;
+    std::span<const glm::vec3> nodes;
+};
+
+// Regenerates render geometry from voxel data, meant to run every frame. Output goes into the vertices and indices of
+// a Mesh that the caller keeps around: the vectors are resized, which only allocates when a frame needs more than any
+// frame before it. Scratch memory is kept in the extractor for the same reason.
+//
+// Both modes work in slabs that run in parallel on FrameWorkers(). Each slab counts its output first, a prefix sum
+// over the counts gives every slab its range of the output, then the slabs write their geometry in parallel.
+//
+// The voxel data is in rest space. Given a lattice, the output is carried into it with DeformInLattice once extracted,
+// so the surface follows whatever deformed the nodes. Nodes the surface sits next to have to move with the rest.
+class SurfaceExtractor
+{
+  public:
+    // One quad per greedily merged rectangle of faces between solid and empty voxels, with flat normals
+    void ExtractQuads(const VoxelGrid &grid, Mesh &out, const DeformedLattice *lattice = nullptr);
+    // Marching cubes over the iso level of field, with the cube corners at voxel centers. Triangles face the side
+    // above iso and get normals from the field's gradient. Vertices aren't shared between triangles.
+    void ExtractMarchingCubes(
+        const DistanceGrid &field, Mesh &out, f32 iso = 0.0f, const DeformedLattice *lattice = nullptr);
+
+  private:
+    struct Quad {
+        u32 bit_begin;
+        u32 bit_end;
+        u32 row_begin;
+        u32 row_end;
+    };
+
+    // Quads of every (direction, slice) slab
+    std::vector<std::vector<Quad>> m_slab_quads;
+    // A face mask per worker, one bit per face with rows padded to whole words
+    std::vector<std::vector<u64>> m_planes;
+    // Marching cubes case of every cell
+    std::vector<u8> m_cases;
+    std::vector<Size> m_slab_offsets;
+};
+
+// Extracts field_count random size^3 fields and returns how many have a directed edge on two triangles, which a
+// closed, consistently oriented surface never has. 0 is a pass.
+u32 CheckMarchingCubesEdges(u32 size, u32 field_count);
+
+// Extraction times for both modes, cold and with the buffers already grown, at rest and in a twisted lattice, for every
+// .obj in directory. The twisted output is compared against embedding and deforming the rest output.
+void BenchmarkSurfaceExtraction(const char *directory, u32 resolution);
@@ -0,0 +1,50 @@
+#include "thread_pool.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(u32 worker_count)
+{
+    worker_count = std::max(worker_count, 1u);
+    m_workers.reserve(worker_count);
+    for (u32 i = 0; i < worker_count; i++) {
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_job_available.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_job_available.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            // finish whatever is already queued before shutting down, futures would be left broken otherwise
+            if (m_jobs.empty()) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
+
+ThreadPool &FrameWorkers()
+{
+    static ThreadPool workers(WorkerCount() - 1);
+    return workers;
+}
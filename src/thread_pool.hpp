@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of background workers for long running jobs (mesh loading, preprocessing) that shouldn't stall a frame.
+// Short data parallel loops should use ParallelFor instead, on FrameWorkers() when they run every frame.
+class ThreadPool
+{
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_job_available;
+    bool m_stopping = false;
+
+  public:
+    explicit ThreadPool(u32 worker_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    template<typename F>
+    auto Submit(F &&job) -> std::future<decltype(job())>
+    {
+        // packaged_task is move only and std::function needs to be copyable
+        auto task = std::make_shared<std::packaged_task<decltype(job())()>>(std::forward<F>(job));
+        auto future = task->get_future();
+        {
+            std::lock_guard lock(m_mutex);
+            m_jobs.emplace_back([task]() { (*task)(); });
+        }
+        m_job_available.notify_one();
+        return future;
+    }
+
+  private:
+    void WorkerLoop();
+};
@@ -1,13 +1,160 @@
 #include "utils.hpp"
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace utils
 {
 
+MappedFile::MappedFile(const char *file, FileAccessHint hint)
+{
+#ifdef _WIN32
+    const DWORD flags = hint == FileAccessHint::Random       ? FILE_FLAG_RANDOM_ACCESS
+                        : hint == FileAccessHint::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                                                             : FILE_ATTRIBUTE_NORMAL;
+    HANDLE file_handle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    m_is_open = true;
+    LARGE_INTEGER size;
+    HANDLE mapping_handle = nullptr;
+    if (GetFileSizeEx(file_handle, &size) && size.QuadPart > 0) {
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    const void *view = mapping_handle ? MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mapping_handle) {
+            CloseHandle(mapping_handle);
+        }
+        u8 buffer[64 * 1024];
+        DWORD bytes_read = 0;
+        while (ReadFile(file_handle, buffer, sizeof(buffer), &bytes_read, nullptr) && bytes_read > 0) {
+            m_fallback.insert(m_fallback.end(), buffer, buffer + bytes_read);
+        }
+        CloseHandle(file_handle);
+        m_data = m_fallback.data();
+        m_size = m_fallback.size();
+        return;
+    }
+    m_data = (const u8 *)view;
+    m_size = (Size)size.QuadPart;
+    m_is_mapped = true;
+    m_file_handle = file_handle;
+    m_mapping_handle = mapping_handle;
+#if _WIN32_WINNT >= 0x0602
+    if (hint != FileAccessHint::Random) {
+        WIN32_MEMORY_RANGE_ENTRY range = {(void *)m_data, m_size};
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#endif
+#else
+    const int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    m_is_open = true;
+    struct stat file_stat;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+        data = mmap(nullptr, (Size)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if (data == MAP_FAILED) {
+        // Pipes, procfs and friends can't be mapped and don't report a size, read until EOF instead
+        u8 buffer[64 * 1024];
+        ssize_t bytes_read = 0;
+        while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0) {
+            m_fallback.insert(m_fallback.end(), buffer, buffer + bytes_read);
+        }
+        close(fd);
+        m_data = m_fallback.data();
+        m_size = m_fallback.size();
+        return;
+    }
+    // the mapping keeps its own reference to the file
+    close(fd);
+    m_data = (const u8 *)data;
+    m_size = (Size)file_stat.st_size;
+    m_is_mapped = true;
+    switch (hint) {
+    case FileAccessHint::Sequential:
+        madvise(data, m_size, MADV_SEQUENTIAL);
+        madvise(data, m_size, MADV_WILLNEED);
+        break;
+    case FileAccessHint::WillNeed:
+        madvise(data, m_size, MADV_WILLNEED);
+        break;
+    case FileAccessHint::Random:
+        madvise(data, m_size, MADV_RANDOM);
+        break;
+    }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Release();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        Release();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_is_open = std::exchange(other.m_is_open, false);
+        m_is_mapped = std::exchange(other.m_is_mapped, false);
+        // moving a vector keeps its buffer, so m_data stays valid for the read fallback
+        m_fallback = std::move(other.m_fallback);
+#ifdef _WIN32
+        m_file_handle = std::exchange(other.m_file_handle, nullptr);
+        m_mapping_handle = std::exchange(other.m_mapping_handle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::Release()
+{
+    if (m_is_mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping_handle);
+        CloseHandle(m_file_handle);
+        m_file_handle = nullptr;
+        m_mapping_handle = nullptr;
+#else
+        munmap((void *)m_data, m_size);
+#endif
+    }
+    m_fallback = {};
+    m_data = nullptr;
+    m_size = 0;
+    m_is_open = false;
+    m_is_mapped = false;
+}
+
 FILE *OpenFile(const char *file, FilePermissions permissions)
 {
     const char *cPermissions[] = {"r", "w", "w+", "rb", "wb", "wb+"};
@@ -21,33 +168,73 @@ FILE *OpenFile(const char *file, FilePermissions permissions)
     return ret;
 }
 
-std::string ReadEntireFileAsString(const char *file)
+MappedFile MapFileOrExit(const char *file)
 {
-    auto *fp = OpenFile(file, FilePermissions::Read);
-    fseek(fp, 0, SEEK_END);
-    uint64_t length = ftell(fp);
-    rewind(fp);
-    if (length == 0) {
+    MappedFile mapped(file, FileAccessHint::Sequential);
+    if (!mapped.IsValid()) {
+        // TODO: better error handling
+        printf("FAILED TO OPEN FILE: %s\n", file);
+        exit(EXIT_FAILURE);
+    }
+    if (mapped.Bytes().empty()) {
         printf("Failed to read file size\n");
     }
-    std::string data(length, 0);
-    fread(data.data(), sizeof(uint8_t), length, fp);
-    fclose(fp);
-    return data;
+    return mapped;
+}
+
+std::string ReadEntireFileAsString(const char *file)
+{
+    const auto mapped = MapFileOrExit(file);
+    return std::string(mapped.AsString());
 }
 
 std::vector<uint8_t> ReadEntireFileAsVector(const char *file)
 {
-    auto *fp = OpenFile(file, FilePermissions::BinaryRead);
-    fseek(fp, 0, SEEK_END);
-    uint64_t length = ftell(fp);
-    rewind(fp);
-    if (length == 0) {
-        printf("Failed to read file size\n");
+    const auto mapped = MapFileOrExit(file);
+    return std::vector<uint8_t>(mapped.Bytes().begin(), mapped.Bytes().end());
+}
+
+std::string TemporaryPathFor(const std::string &path)
+{
+    static std::atomic<u32> counter = 0;
+#ifdef _WIN32
+    const u64 process = GetCurrentProcessId();
+#else
+    const u64 process = (u64)getpid();
+#endif
+    return path + ".tmp" + std::to_string(process) + "." + std::to_string(counter.fetch_add(1));
+}
+
+bool MoveFileOver(const char *from, const char *to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+u64 HashBytes(std::span<const u8> bytes, u64 seed)
+{
+    // 8 bytes at a time with a multiply/xor-shift mix per word, same constants as the murmur3 finalizer
+    constexpr u64 M = 0xFF51AFD7ED558CCDull;
+    u64 hash = seed ^ (bytes.size() * 0x9E3779B97F4A7C15ull);
+    Size i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        u64 word;
+        memcpy(&word, bytes.data() + i, sizeof(word));
+        word *= M;
+        word ^= word >> 47;
+        hash = (hash ^ word) * M;
+    }
+    if (i < bytes.size()) {
+        u64 word = 0;
+        memcpy(&word, bytes.data() + i, bytes.size() - i);
+        hash = (hash ^ word) * M;
     }
-    std::vector<uint8_t> data(length, 0);
-    fread(data.data(), sizeof(uint8_t), data.size(), fp);
-    fclose(fp);
-    return data;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
 }
 } // namespace utils
@@ -1,5 +1,9 @@
 #pragma once
+#include "common.h"
+
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class FilePermissions {
@@ -14,7 +18,67 @@ enum class FilePermissions {
 namespace utils
 {
 
+enum class FileAccessHint {
+    // Read front to back once, e.g. parsing
+    Sequential,
+    // Read soon, possibly out of order, e.g. caches handed to the GPU
+    WillNeed,
+    Random,
+};
+
+// Read only view of a whole file. Regular files are mapped into memory and the OS is told how they'll be accessed,
+// anything that can't be mapped is read into an owned buffer instead. The view is released when the object is
+// destroyed, so any span handed out must not outlive it.
+class MappedFile
+{
+    const u8 *m_data = nullptr;
+    Size m_size = 0;
+    bool m_is_open = false;
+    bool m_is_mapped = false;
+    std::vector<u8> m_fallback;
+#ifdef _WIN32
+    void *m_file_handle = nullptr;
+    void *m_mapping_handle = nullptr;
+#endif
+
+  public:
+    MappedFile() = default;
+    explicit MappedFile(const char *file, FileAccessHint hint = FileAccessHint::Sequential);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // Empty files are valid, only failing to open the file isn't
+    bool IsValid() const { return m_is_open; }
+    bool IsMapped() const { return m_is_mapped; }
+    std::span<const u8> Bytes() const { return {m_data, m_size}; }
+    std::string_view AsString() const { return {(const char *)m_data, m_size}; }
+
+  private:
+    void Release();
+};
+
 FILE *OpenFile(const char *file, FilePermissions permissions);
+// Exits when the file can't be opened, same as OpenFile
+MappedFile MapFileOrExit(const char *file);
 std::string ReadEntireFileAsString(const char *file);
 std::vector<uint8_t> ReadEntireFileAsVector(const char *file);
-}
\ No newline at end of file
+
+// Unique path next to `path` for writing a file that MoveFileOver then puts in place, so nobody maps a half written
+// file and writers racing on the same path don't interleave
+std::string TemporaryPathFor(const std::string &path);
+// Replaces `to` with `from`. On POSIX mappings of the old file stay valid, Windows refuses while `to` is mapped.
+bool MoveFileOver(const char *from, const char *to);
+
+template<typename T>
+std::span<const u8> AsBytes(std::span<const T> values)
+{
+    return {(const u8 *)values.data(), values.size_bytes()};
+}
+
+// Fast non-cryptographic 64 bit hash, used to key caches on file contents
+u64 HashBytes(std::span<const u8> bytes, u64 seed = 0);
+}
@@ -0,0 +1,299 @@
+#include "vertex_compression.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <glm/geometric.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_COMPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+
+constexpr f32 UNORM16_MAX = 65535.0f;
+
+f32 SnormMax(VertexFormat format)
+{
+    return format == VertexFormat::Compact8 ? 127.0f : 32767.0f;
+}
+
+f32 SignNotZero(f32 value)
+{
+    return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Integer components of one encoded vertex, shared by the scalar and SIMD paths
+struct EncodedVertex {
+    s32 position[3];
+    s32 normal[2];
+};
+
+void StoreEncoded(u8 *out, VertexFormat format, const EncodedVertex &encoded)
+{
+    if (format == VertexFormat::Compact12) {
+        CompactVertex12 vertex = {
+            .position = {(u16)encoded.position[0], (u16)encoded.position[1], (u16)encoded.position[2], 0},
+            .normal = {(s16)encoded.normal[0], (s16)encoded.normal[1]},
+        };
+        memcpy(out, &vertex, sizeof(vertex));
+    } else {
+        CompactVertex8 vertex = {
+            .position = {(u16)encoded.position[0], (u16)encoded.position[1], (u16)encoded.position[2]},
+            .normal = {(s8)encoded.normal[0], (s8)encoded.normal[1]},
+        };
+        memcpy(out, &vertex, sizeof(vertex));
+    }
+}
+
+EncodedVertex LoadEncoded(const u8 *data, VertexFormat format)
+{
+    if (format == VertexFormat::Compact12) {
+        CompactVertex12 vertex;
+        memcpy(&vertex, data, sizeof(vertex));
+        return {{vertex.position[0], vertex.position[1], vertex.position[2]}, {vertex.normal[0], vertex.normal[1]}};
+    }
+    CompactVertex8 vertex;
+    memcpy(&vertex, data, sizeof(vertex));
+    return {{vertex.position[0], vertex.position[1], vertex.position[2]}, {vertex.normal[0], vertex.normal[1]}};
+}
+
+EncodedVertex EncodeScalar(const Mesh::Vertex &vertex, const glm::vec3 &inverse_scale, const glm::vec3 &offset,
+    f32 snorm_max)
+{
+    EncodedVertex encoded;
+    const glm::vec3 normalized = glm::clamp((vertex.position - offset) * inverse_scale, 0.0f, 1.0f);
+    for (u32 i = 0; i < 3; i++) {
+        encoded.position[i] = (s32)(normalized[i] * UNORM16_MAX + 0.5f);
+    }
+    const glm::vec2 octahedral = OctahedralEncode(vertex.normal);
+    // nearbyint rounds halfway cases to even like cvtps does, so both paths produce the same bits
+    encoded.normal[0] = (s32)std::nearbyint(std::clamp(octahedral.x, -1.0f, 1.0f) * snorm_max);
+    encoded.normal[1] = (s32)std::nearbyint(std::clamp(octahedral.y, -1.0f, 1.0f) * snorm_max);
+    return encoded;
+}
+
+Mesh::Vertex DecodeScalar(const EncodedVertex &encoded, const VertexQuantization &quantization, f32 snorm_max)
+{
+    Mesh::Vertex vertex;
+    for (u32 i = 0; i < 3; i++) {
+        vertex.position[i] = quantization.position_offset[i]
+                             + ((f32)encoded.position[i] / UNORM16_MAX) * quantization.position_scale[i];
+    }
+    const glm::vec2 octahedral = {std::max((f32)encoded.normal[0] / snorm_max, -1.0f),
+        std::max((f32)encoded.normal[1] / snorm_max, -1.0f)};
+    vertex.normal = OctahedralDecode(octahedral);
+    return vertex;
+}
+
+#ifdef VERTEX_COMPRESSION_SSE2
+__m128 Abs(__m128 value)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+}
+
+__m128 SignNotZero(__m128 value)
+{
+    return _mm_or_ps(_mm_and_ps(value, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f));
+}
+
+__m128 Select(__m128 mask, __m128 if_true, __m128 if_false)
+{
+    return _mm_or_ps(_mm_and_ps(mask, if_true), _mm_andnot_ps(mask, if_false));
+}
+
+// Encodes vertices[0..3] with the same math as EncodeScalar/OctahedralEncode
+void EncodeBlock4(const Mesh::Vertex *vertices, const glm::vec3 &inverse_scale, const glm::vec3 &offset,
+    f32 snorm_max, EncodedVertex *out)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    s32 position_lanes[3][4];
+    for (u32 axis = 0; axis < 3; axis++) {
+        const __m128 position = _mm_setr_ps(vertices[0].position[axis], vertices[1].position[axis],
+            vertices[2].position[axis], vertices[3].position[axis]);
+        __m128 normalized =
+            _mm_mul_ps(_mm_sub_ps(position, _mm_set1_ps(offset[axis])), _mm_set1_ps(inverse_scale[axis]));
+        normalized = _mm_min_ps(_mm_max_ps(normalized, zero), one);
+        const __m128i quantized =
+            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(normalized, _mm_set1_ps(UNORM16_MAX)), _mm_set1_ps(0.5f)));
+        _mm_storeu_si128((__m128i *)position_lanes[axis], quantized);
+    }
+
+    const auto gather_normal = [vertices](u32 axis) {
+        return _mm_setr_ps(
+            vertices[0].normal[axis], vertices[1].normal[axis], vertices[2].normal[axis], vertices[3].normal[axis]);
+    };
+    const __m128 nx = gather_normal(0);
+    const __m128 ny = gather_normal(1);
+    const __m128 nz = gather_normal(2);
+    __m128 l1_norm = _mm_add_ps(_mm_add_ps(Abs(nx), Abs(ny)), Abs(nz));
+    l1_norm = Select(_mm_cmpeq_ps(l1_norm, zero), one, l1_norm);
+    const __m128 ox = _mm_div_ps(nx, l1_norm);
+    const __m128 oy = _mm_div_ps(ny, l1_norm);
+    const __m128 folded_x = _mm_mul_ps(_mm_sub_ps(one, Abs(oy)), SignNotZero(ox));
+    const __m128 folded_y = _mm_mul_ps(_mm_sub_ps(one, Abs(ox)), SignNotZero(oy));
+    const __m128 lower_hemisphere = _mm_cmplt_ps(nz, zero);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_set1_ps(snorm_max);
+    const __m128 ex = _mm_min_ps(_mm_max_ps(Select(lower_hemisphere, folded_x, ox), minus_one), one);
+    const __m128 ey = _mm_min_ps(_mm_max_ps(Select(lower_hemisphere, folded_y, oy), minus_one), one);
+
+    s32 normal_lanes[2][4];
+    _mm_storeu_si128((__m128i *)normal_lanes[0], _mm_cvtps_epi32(_mm_mul_ps(ex, scale)));
+    _mm_storeu_si128((__m128i *)normal_lanes[1], _mm_cvtps_epi32(_mm_mul_ps(ey, scale)));
+
+    for (u32 lane = 0; lane < 4; lane++) {
+        out[lane] = {{position_lanes[0][lane], position_lanes[1][lane], position_lanes[2][lane]},
+            {normal_lanes[0][lane], normal_lanes[1][lane]}};
+    }
+}
+
+void DecodeBlock4(const EncodedVertex *encoded, const VertexQuantization &quantization, f32 snorm_max,
+    Mesh::Vertex *out)
+{
+    const __m128 inverse_unorm = _mm_set1_ps(1.0f / UNORM16_MAX);
+    f32 position_lanes[3][4];
+    for (u32 axis = 0; axis < 3; axis++) {
+        const __m128 quantized = _mm_cvtepi32_ps(_mm_setr_epi32(encoded[0].position[axis], encoded[1].position[axis],
+            encoded[2].position[axis], encoded[3].position[axis]));
+        const __m128 position = _mm_add_ps(_mm_set1_ps(quantization.position_offset[axis]),
+            _mm_mul_ps(_mm_mul_ps(quantized, inverse_unorm), _mm_set1_ps(quantization.position_scale[axis])));
+        _mm_storeu_ps(position_lanes[axis], position);
+    }
+
+    const __m128 inverse_snorm = _mm_set1_ps(1.0f / snorm_max);
+    const __m128 minus_one = _mm_set1_ps(-1.0f);
+    const auto gather_normal = [&](u32 axis) {
+        const __m128i quantized = _mm_setr_epi32(
+            encoded[0].normal[axis], encoded[1].normal[axis], encoded[2].normal[axis], encoded[3].normal[axis]);
+        return _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(quantized), inverse_snorm), minus_one);
+    };
+    __m128 x = gather_normal(0);
+    __m128 y = gather_normal(1);
+    const __m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), Abs(x)), Abs(y));
+    // Unfolds the lower hemisphere without a branch (Stubbe's variant of the octahedral decode)
+    const __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+    x = _mm_sub_ps(x, _mm_mul_ps(t, SignNotZero(x)));
+    y = _mm_sub_ps(y, _mm_mul_ps(t, SignNotZero(y)));
+    const __m128 length =
+        _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+    f32 normal_lanes[3][4];
+    _mm_storeu_ps(normal_lanes[0], _mm_div_ps(x, length));
+    _mm_storeu_ps(normal_lanes[1], _mm_div_ps(y, length));
+    _mm_storeu_ps(normal_lanes[2], _mm_div_ps(z, length));
+
+    for (u32 lane = 0; lane < 4; lane++) {
+        out[lane].position = {position_lanes[0][lane], position_lanes[1][lane], position_lanes[2][lane]};
+        out[lane].normal = {normal_lanes[0][lane], normal_lanes[1][lane], normal_lanes[2][lane]};
+    }
+}
+#endif
+
+} // namespace
+
+Size VertexFormatSize(VertexFormat format)
+{
+    switch (format) {
+    case VertexFormat::Float32:
+        return sizeof(Mesh::Vertex);
+    case VertexFormat::Compact12:
+        return sizeof(CompactVertex12);
+    case VertexFormat::Compact8:
+        return sizeof(CompactVertex8);
+    }
+    return 0;
+}
+
+VertexQuantization ComputeQuantization(const Bounds &bounds, VertexFormat format)
+{
+    return {
+        .format = format,
+        .position_offset = bounds.min,
+        .position_scale = bounds.max - bounds.min,
+    };
+}
+
+void EncodeVertices(std::span<const Mesh::Vertex> vertices, const VertexQuantization &quantization, std::span<u8> out)
+{
+    const Size stride = VertexFormatSize(quantization.format);
+    assert(out.size() >= vertices.size() * stride);
+    if (quantization.format == VertexFormat::Float32) {
+        memcpy(out.data(), vertices.data(), vertices.size_bytes());
+        return;
+    }
+
+    // Flat axes get a zero scale, everything on them encodes to 0
+    glm::vec3 inverse_scale;
+    for (u32 i = 0; i < 3; i++) {
+        inverse_scale[i] = quantization.position_scale[i] > 0.0f ? 1.0f / quantization.position_scale[i] : 0.0f;
+    }
+    const f32 snorm_max = SnormMax(quantization.format);
+
+    Size i = 0;
+#ifdef VERTEX_COMPRESSION_SSE2
+    EncodedVertex block[4];
+    for (; i + 4 <= vertices.size(); i += 4) {
+        EncodeBlock4(&vertices[i], inverse_scale, quantization.position_offset, snorm_max, block);
+        for (u32 lane = 0; lane < 4; lane++) {
+            StoreEncoded(out.data() + (i + lane) * stride, quantization.format, block[lane]);
+        }
+    }
+#endif
+    for (; i < vertices.size(); i++) {
+        StoreEncoded(out.data() + i * stride, quantization.format,
+            EncodeScalar(vertices[i], inverse_scale, quantization.position_offset, snorm_max));
+    }
+}
+
+void DecodeVertices(std::span<const u8> data, const VertexQuantization &quantization, std::span<Mesh::Vertex> out)
+{
+    const Size stride = VertexFormatSize(quantization.format);
+    assert(data.size() >= out.size() * stride);
+    if (quantization.format == VertexFormat::Float32) {
+        memcpy(out.data(), data.data(), out.size_bytes());
+        return;
+    }
+    const f32 snorm_max = SnormMax(quantization.format);
+
+    Size i = 0;
+#ifdef VERTEX_COMPRESSION_SSE2
+    EncodedVertex block[4];
+    for (; i + 4 <= out.size(); i += 4) {
+        for (u32 lane = 0; lane < 4; lane++) {
+            block[lane] = LoadEncoded(data.data() + (i + lane) * stride, quantization.format);
+        }
+        DecodeBlock4(block, quantization, snorm_max, &out[i]);
+    }
+#endif
+    for (; i < out.size(); i++) {
+        out[i] = DecodeScalar(LoadEncoded(data.data() + i * stride, quantization.format), quantization, snorm_max);
+    }
+}
+
+glm::vec2 OctahedralEncode(const glm::vec3 &normal)
+{
+    f32 l1_norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1_norm == 0.0f) {
+        l1_norm = 1.0f;
+    }
+    glm::vec2 encoded = {normal.x / l1_norm, normal.y / l1_norm};
+    if (normal.z < 0.0f) {
+        encoded = {(1.0f - std::abs(encoded.y)) * SignNotZero(encoded.x),
+            (1.0f - std::abs(encoded.x)) * SignNotZero(encoded.y)};
+    }
+    return encoded;
+}
+
+glm::vec3 OctahedralDecode(const glm::vec2 &encoded)
+{
+    glm::vec3 normal = {encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y)};
+    const f32 t = std::max(-normal.z, 0.0f);
+    normal.x -= t * SignNotZero(normal.x);
+    normal.y -= t * SignNotZero(normal.y);
+    return glm::normalize(normal);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+
+#pragma pack(push, 1)
+// unorm16 position relative to the mesh bounds, snorm16 octahedral normal. The position's w is unused and only keeps
+// the normal 4 byte aligned.
+struct CompactVertex12 {
+    u16 position[4];
+    s16 normal[2];
+};
+
+// unorm16 position relative to the mesh bounds, snorm8 octahedral normal
+struct CompactVertex8 {
+    u16 position[3];
+    s8 normal[2];
+};
+#pragma pack(pop)
+
+Size VertexFormatSize(VertexFormat format);
+VertexQuantization ComputeQuantization(const Bounds &bounds, VertexFormat format);
+
+// out needs vertices.size() * VertexFormatSize(quantization.format) bytes. Uses SSE2 for 4 vertices at a time when
+// available.
+void EncodeVertices(
+    std::span<const Mesh::Vertex> vertices, const VertexQuantization &quantization, std::span<u8> out);
+void DecodeVertices(std::span<const u8> data, const VertexQuantization &quantization, std::span<Mesh::Vertex> out);
+
+// Unit vector to [-1, 1]^2 and back
+glm::vec2 OctahedralEncode(const glm::vec3 &normal);
+glm::vec3 OctahedralDecode(const glm::vec2 &encoded);
@@ -0,0 +1,392 @@
+#include "voxel_components.hpp"
+
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxelizer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <string>
+
+namespace
+{
+
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+
+// Neighbouring rows at lower (z, y), together with how far a run may reach along x and still touch one there
+struct RowNeighbor {
+    s32 dy;
+    s32 dz;
+    u32 face_reach;
+    u32 edge_reach;
+    u32 vertex_reach;
+};
+
+constexpr u32 NOT_CONNECTED = ~0u;
+
+constexpr RowNeighbor ROW_NEIGHBORS[4] = {
+    {-1, 0, 0, 1, 1},
+    {0, -1, 0, 1, 1},
+    {-1, -1, NOT_CONNECTED, 0, 1},
+    {1, -1, NOT_CONNECTED, 0, 1},
+};
+
+u32 Reach(const RowNeighbor &neighbor, Connectivity connectivity)
+{
+    switch (connectivity) {
+    case Connectivity::Face6:
+        return neighbor.face_reach;
+    case Connectivity::Edge18:
+        return neighbor.edge_reach;
+    case Connectivity::Vertex26:
+        return neighbor.vertex_reach;
+    }
+    return NOT_CONNECTED;
+}
+
+u32 CountRuns(std::span<const u64> row)
+{
+    u32 count = 0;
+    u64 carry = 0;
+    for (const u64 word : row) {
+        count += (u32)std::popcount(word & ~((word << 1) | carry));
+        carry = word >> 63;
+    }
+    return count;
+}
+
+void FillRuns(std::span<const u64> row, VoxelRun *runs)
+{
+    const u32 words = (u32)row.size();
+    u64 carry = 0;
+    for (u32 word = 0; word < words; word++) {
+        u64 starts = row[word] & ~((row[word] << 1) | carry);
+        carry = row[word] >> 63;
+        while (starts != 0) {
+            const u32 begin = word * 64 + (u32)std::countr_zero(starts);
+            starts &= starts - 1;
+            // First clear bit after begin, the padding past dimensions.x is always clear
+            u32 end_word = begin / 64;
+            u64 clear = ~row[end_word] & (~0ull << (begin % 64));
+            while (clear == 0 && ++end_word < words) {
+                clear = ~row[end_word];
+            }
+            const u32 end = end_word < words ? end_word * 64 + (u32)std::countr_zero(clear) : words * 64;
+            *runs++ = {begin, end, VoxelComponents::NO_COMPONENT};
+        }
+    }
+}
+
+u32 Find(std::vector<u32> &parent, u32 run)
+{
+    while (parent[run] != run) {
+        parent[run] = parent[parent[run]];
+        run = parent[run];
+    }
+    return run;
+}
+
+// The root is always the lowest run of the set, which is what numbers the components in voxel order
+void Union(std::vector<u32> &parent, u32 a, u32 b)
+{
+    a = Find(parent, a);
+    b = Find(parent, b);
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+// Both rows are sorted and their runs at least one voxel apart, so whichever run ends first can't touch anything
+// further along the other row
+void UnionRows(std::span<const VoxelRun> a, u32 a_first, std::span<const VoxelRun> b, u32 b_first, u32 reach,
+    std::vector<u32> &parent)
+{
+    Size i = 0;
+    Size j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].begin < b[j].end + reach && b[j].begin < a[i].end + reach) {
+            Union(parent, a_first + (u32)i, b_first + (u32)j);
+        }
+        if (a[i].end < b[j].end) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+}
+
+VoxelGrid Invert(const VoxelGrid &grid)
+{
+    VoxelGrid inverted(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    const std::span<const u64> words = grid.Words();
+    const std::span<u64> out = inverted.Words();
+    const u32 words_per_row = grid.WordsPerRow();
+    const u64 last_word_mask = grid.LastWordMask();
+    for (Size i = 0; i < words.size(); i++) {
+        out[i] = ~words[i] & ((i + 1) % words_per_row == 0 ? last_word_mask : ~0ull);
+    }
+    return inverted;
+}
+
+} // namespace
+
+VoxelComponents::VoxelComponents(const VoxelGrid &grid, Connectivity connectivity)
+    : m_placement{grid.Dimensions(), grid.Origin(), grid.VoxelSize()}
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    const Size row_count = (Size)dimensions.y * dimensions.z;
+    m_row_offsets.assign(row_count + 1, 0);
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            m_row_offsets[row + 1] = CountRuns(grid.Row((u32)(row % dimensions.y), (u32)(row / dimensions.y)));
+        },
+        MIN_ROWS_PER_RANGE);
+    std::inclusive_scan(m_row_offsets.begin(), m_row_offsets.end(), m_row_offsets.begin());
+    m_runs.resize(m_row_offsets.back());
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            FillRuns(grid.Row((u32)(row % dimensions.y), (u32)(row / dimensions.y)), &m_runs[m_row_offsets[row]]);
+        },
+        MIN_ROWS_PER_RANGE);
+
+    std::vector<u32> parent(m_runs.size());
+    std::iota(parent.begin(), parent.end(), 0u);
+    const auto union_with_neighbor = [&](u32 y, u32 z, const RowNeighbor &neighbor) {
+        const u32 reach = Reach(neighbor, connectivity);
+        const s64 neighbor_y = (s64)y + neighbor.dy;
+        if (reach == NOT_CONNECTED || neighbor_y < 0 || neighbor_y >= dimensions.y) {
+            return;
+        }
+        const Size row = (Size)z * dimensions.y + y;
+        const Size neighbor_row = (Size)(z + neighbor.dz) * dimensions.y + (Size)neighbor_y;
+        UnionRows(Runs(y, z), m_row_offsets[row], Runs((u32)neighbor_y, (u32)(z + neighbor.dz)),
+            m_row_offsets[neighbor_row], reach, parent);
+    };
+
+    // Slabs only union runs of their own rows, so they touch disjoint parts of parent
+    std::vector<Size> slab_begins(WorkerCount());
+    const u32 slab_count = ParallelForRanges(dimensions.z, [&](Size z_begin, Size z_end, u32 slab) {
+        slab_begins[slab] = z_begin;
+        for (u32 z = (u32)z_begin; z < z_end; z++) {
+            for (u32 y = 0; y < dimensions.y; y++) {
+                for (const RowNeighbor &neighbor : ROW_NEIGHBORS) {
+                    if (neighbor.dz == 0 || z > z_begin) {
+                        union_with_neighbor(y, z, neighbor);
+                    }
+                }
+            }
+        }
+    });
+    for (u32 slab = 1; slab < slab_count; slab++) {
+        // The last slabs can be empty and start at dimensions.z
+        const u32 z = (u32)slab_begins[slab];
+        for (u32 y = 0; y < dimensions.y && z < dimensions.z; y++) {
+            for (const RowNeighbor &neighbor : ROW_NEIGHBORS) {
+                if (neighbor.dz != 0) {
+                    union_with_neighbor(y, z, neighbor);
+                }
+            }
+        }
+    }
+
+    for (Size row = 0; row < row_count; row++) {
+        const u32 y = (u32)(row % dimensions.y);
+        const u32 z = (u32)(row / dimensions.y);
+        const bool border_row = y == 0 || z == 0 || y + 1 == dimensions.y || z + 1 == dimensions.z;
+        for (u32 run = m_row_offsets[row]; run < m_row_offsets[row + 1]; run++) {
+            const u32 root = Find(parent, run);
+            if (root == run) {
+                m_runs[run].component = (u32)m_voxel_counts.size();
+                m_voxel_counts.push_back(0);
+                m_touches_border.push_back(0);
+            } else {
+                m_runs[run].component = m_runs[root].component;
+            }
+            const VoxelRun &voxels = m_runs[run];
+            m_voxel_counts[voxels.component] += voxels.end - voxels.begin;
+            if (border_row || voxels.begin == 0 || voxels.end == dimensions.x) {
+                m_touches_border[voxels.component] = 1;
+            }
+        }
+    }
+}
+
+u32 VoxelComponents::Largest() const
+{
+    if (m_voxel_counts.empty()) {
+        return NO_COMPONENT;
+    }
+    return (u32)(std::max_element(m_voxel_counts.begin(), m_voxel_counts.end()) - m_voxel_counts.begin());
+}
+
+std::span<const VoxelRun> VoxelComponents::Runs(u32 y, u32 z) const
+{
+    const Size row = (Size)z * m_placement.dimensions.y + y;
+    return {m_runs.data() + m_row_offsets[row], m_row_offsets[row + 1] - m_row_offsets[row]};
+}
+
+u32 VoxelComponents::Component(u32 x, u32 y, u32 z) const
+{
+    const std::span<const VoxelRun> runs = Runs(y, z);
+    const auto after =
+        std::upper_bound(runs.begin(), runs.end(), x, [](u32 value, const VoxelRun &run) { return value < run.begin; });
+    if (after == runs.begin() || x >= (after - 1)->end) {
+        return NO_COMPONENT;
+    }
+    return (after - 1)->component;
+}
+
+VoxelGrid VoxelComponents::Select(std::span<const u8> keep) const
+{
+    VoxelGrid out(m_placement.dimensions, m_placement.origin, m_placement.voxel_size);
+    const glm::uvec3 dimensions = m_placement.dimensions;
+    ParallelFor(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            const std::span<u64> words = out.Row(y, z);
+            for (const VoxelRun &run : Runs(y, z)) {
+                if (!keep[run.component]) {
+                    continue;
+                }
+                for (u32 word = run.begin / 64; word * 64 < run.end; word++) {
+                    const u32 low = std::max(run.begin, word * 64) - word * 64;
+                    const u32 high = std::min(run.end, word * 64 + 64) - word * 64;
+                    words[word] |= (high == 64 ? ~0ull : (1ull << high) - 1) & ~((1ull << low) - 1);
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    return out;
+}
+
+Connectivity DualConnectivity(Connectivity connectivity)
+{
+    return connectivity == Connectivity::Face6 ? Connectivity::Vertex26 : Connectivity::Face6;
+}
+
+VoxelGrid ExteriorVoxels(const VoxelGrid &grid, Connectivity connectivity)
+{
+    const VoxelComponents empty(Invert(grid), DualConnectivity(connectivity));
+    std::vector<u8> exterior(empty.Count());
+    for (u32 component = 0; component < empty.Count(); component++) {
+        exterior[component] = empty.TouchesBorder(component);
+    }
+    return empty.Select(exterior);
+}
+
+VoxelCleanupReport CleanUpVoxels(VoxelGrid &grid, const VoxelCleanupOptions &options)
+{
+    VoxelCleanupReport report;
+    const VoxelComponents solid(grid, options.connectivity);
+    report.component_voxels.assign(solid.VoxelCounts().begin(), solid.VoxelCounts().end());
+    const u32 largest = solid.Largest();
+    std::vector<u8> keep(solid.Count());
+    for (u32 component = 0; component < solid.Count(); component++) {
+        const Size voxels = solid.VoxelCounts()[component];
+        keep[component] =
+            voxels >= options.min_component_voxels && (!options.keep_largest_only || component == largest);
+        if (!keep[component]) {
+            report.dropped_components++;
+            report.dropped_voxels += voxels;
+        }
+    }
+    if (report.dropped_components > 0) {
+        grid = solid.Select(keep);
+    }
+
+    const VoxelComponents empty(Invert(grid), DualConnectivity(options.connectivity));
+    std::vector<u8> cavities(empty.Count());
+    for (u32 component = 0; component < empty.Count(); component++) {
+        cavities[component] = !empty.TouchesBorder(component);
+        if (cavities[component]) {
+            report.cavity_count++;
+            report.cavity_voxels += empty.VoxelCounts()[component];
+        }
+    }
+    if (options.fill_cavities && report.cavity_count > 0) {
+        const VoxelGrid filled = empty.Select(cavities);
+        const std::span<u64> words = grid.Words();
+        const std::span<const u64> filled_words = filled.Words();
+        for (Size i = 0; i < words.size(); i++) {
+            words[i] |= filled_words[i];
+        }
+        report.cavities_filled = true;
+    }
+    return report;
+}
+
+void PrintVoxelCleanupReport(const char *name, const VoxelCleanupReport &report)
+{
+    printf("Cleaned up %s: %zu components", name, report.component_voxels.size());
+    for (Size i = 0; i < report.component_voxels.size(); i++) {
+        printf("%s%zu", i == 0 ? ": " : ", ", report.component_voxels[i]);
+    }
+    printf("\ndropped %u components with %zu voxels, %u cavities with %zu voxels%s\n", report.dropped_components,
+        report.dropped_voxels, report.cavity_count, report.cavity_voxels, report.cavities_filled ? " filled" : "");
+}
+
+void BenchmarkVoxelComponents(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto best_of = [&](auto &&fn) {
+        f64 best = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            const auto start = Clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    };
+
+    printf("%-24s %16s %12s %10s %10s %12s %12s %10s %12s\n", "file", "grid", "solid", "runs", "parts",
+        "label ms", "exterior ms", "cavities", "cleanup ms");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+        VoxelizeSolid(mesh, grid);
+
+        VoxelComponents components;
+        const f64 label_ms = best_of([&]() { components = VoxelComponents(grid); });
+        Size run_count = 0;
+        const glm::uvec3 dimensions = grid.Dimensions();
+        for (u32 z = 0; z < dimensions.z; z++) {
+            for (u32 y = 0; y < dimensions.y; y++) {
+                run_count += components.Runs(y, z).size();
+            }
+        }
+        const f64 exterior_ms = best_of([&]() { ExteriorVoxels(grid); });
+        VoxelCleanupReport report;
+        const f64 cleanup_ms = best_of([&]() {
+            VoxelGrid cleaned = grid;
+            report = CleanUpVoxels(cleaned, {.fill_cavities = true});
+        });
+
+        const std::string grid_size = std::to_string(dimensions.x) + "x" + std::to_string(dimensions.y) + "x"
+                                      + std::to_string(dimensions.z);
+        printf("%-24s %16s %12zu %10zu %10u %12.3f %12.3f %10u %12.3f\n", path.filename().string().c_str(),
+            grid_size.c_str(), grid.CountSolid(), run_count, components.Count(), label_ms, exterior_ms,
+            report.cavity_count, cleanup_ms);
+    }
+}
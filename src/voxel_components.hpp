@@ -0,0 +1,84 @@
+#pragma once
+
+#include "common.h"
+#include "voxel_grid.hpp"
+#include "voxel_neighbors.hpp"
+
+#include <span>
+#include <vector>
+
+// Solid voxels [begin, end) of one row along x
+struct VoxelRun {
+    u32 begin;
+    u32 end;
+    u32 component;
+};
+
+// Connected components of the solid voxels. Works on maximal runs of set bits rather than single voxels: runs are
+// unioned with the overlapping runs of the neighbouring rows, slabs of z in parallel and then across the slab
+// borders. Components are numbered in the order of their first voxel in (z, y, x).
+class VoxelComponents
+{
+  public:
+    static constexpr u32 NO_COMPONENT = ~0u;
+
+    VoxelComponents() = default;
+    explicit VoxelComponents(const VoxelGrid &grid, Connectivity connectivity = Connectivity::Face6);
+
+    u32 Count() const { return (u32)m_voxel_counts.size(); }
+    std::span<const Size> VoxelCounts() const { return m_voxel_counts; }
+    // Whether a voxel of the component lies on the outermost layer of the grid
+    bool TouchesBorder(u32 component) const { return m_touches_border[component] != 0; }
+    // Largest component, NO_COMPONENT when there is none
+    u32 Largest() const;
+
+    std::span<const VoxelRun> Runs(u32 y, u32 z) const;
+    // NO_COMPONENT for empty voxels
+    u32 Component(u32 x, u32 y, u32 z) const;
+
+    // Grid with the voxels of every component c where keep[c] is non-zero
+    VoxelGrid Select(std::span<const u8> keep) const;
+
+  private:
+    GridPlacement m_placement = {};
+    // Runs of row (y, z) are m_runs[m_row_offsets[row]..m_row_offsets[row + 1]), row = z * dimensions.y + y
+    std::vector<u32> m_row_offsets;
+    std::vector<VoxelRun> m_runs;
+    std::vector<Size> m_voxel_counts;
+    std::vector<u8> m_touches_border;
+};
+
+// Connectivity of the empty space that can't leak through a solid connected with the given one: 6 for 18 and 26,
+// 26 for 6
+Connectivity DualConnectivity(Connectivity connectivity);
+
+// Empty voxels connected to the border of the grid through empty voxels, under the dual connectivity
+VoxelGrid ExteriorVoxels(const VoxelGrid &grid, Connectivity connectivity = Connectivity::Face6);
+
+struct VoxelCleanupOptions {
+    Connectivity connectivity = Connectivity::Face6;
+    // Drop every component but the largest
+    bool keep_largest_only = true;
+    // Drop components with fewer voxels
+    Size min_component_voxels = 0;
+    // Make the empty space that can't be reached from outside solid
+    bool fill_cavities = false;
+};
+
+struct VoxelCleanupReport {
+    // Voxels of every component before anything was dropped
+    std::vector<Size> component_voxels;
+    u32 dropped_components = 0;
+    Size dropped_voxels = 0;
+    // Sealed pockets of empty space left after dropping, filled or not
+    u32 cavity_count = 0;
+    Size cavity_voxels = 0;
+    bool cavities_filled = false;
+};
+
+// Drops floating fragments and optionally fills cavities, meant to run before a body's particles are set up
+VoxelCleanupReport CleanUpVoxels(VoxelGrid &grid, const VoxelCleanupOptions &options = {});
+void PrintVoxelCleanupReport(const char *name, const VoxelCleanupReport &report);
+
+// Labeling, exterior fill and cleanup times plus component and cavity counts, for every .obj in directory
+void BenchmarkVoxelComponents(const char *directory, u32 resolution);
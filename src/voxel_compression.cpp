@@ -0,0 +1,530 @@
+#include "voxel_compression.hpp"
+
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxel_neighbors.hpp"
+#include "voxelizer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+constexpr u32 MAX_PALETTE_SIZE = CompressedVoxels::MAX_MATERIALS + 1;
+
+struct SerializedHeader {
+    static constexpr u32 MAGIC = 0x43585356; // "VSXC"
+    static constexpr u32 VERSION = 1;
+
+    u32 magic = MAGIC;
+    u32 version = VERSION;
+    glm::uvec3 dimensions = {};
+    f32 voxel_size = 0.0f;
+    glm::vec3 origin = {};
+    u32 index_bits = 0;
+    u32 palette_size = 0;
+    u32 word_count = 0;
+};
+
+u64 MaterialKey(const VoxelMaterial &material)
+{
+    return std::bit_cast<u32>(material.density) | ((u64)std::bit_cast<u32>(material.stiffness) << 32);
+}
+
+u64 RangeMask(u32 word, u32 begin, u32 end)
+{
+    const u32 low = std::max(begin, word * 64) - word * 64;
+    const u32 high = std::min(end, word * 64 + 64) - word * 64;
+    return (high == 64 ? ~0ull : (1ull << high) - 1) & ~((1ull << low) - 1);
+}
+
+template<typename T>
+void Append(std::vector<u8> &bytes, std::span<const T> values)
+{
+    const auto *data = (const u8 *)values.data();
+    bytes.insert(bytes.end(), data, data + values.size_bytes());
+}
+
+// Reads count values into out, false when bytes run out
+template<typename T>
+bool Consume(std::span<const u8> &bytes, std::vector<T> &out, Size count)
+{
+    if (bytes.size() / sizeof(T) < count) {
+        return false;
+    }
+    out.resize(count);
+    memcpy(out.data(), bytes.data(), count * sizeof(T));
+    bytes = bytes.subspan(count * sizeof(T));
+    return true;
+}
+
+} // namespace
+
+std::optional<CompressedVoxels> CompressedVoxels::Compress(
+    const VoxelGrid &grid, std::span<const VoxelMaterial> materials)
+{
+    assert(materials.size() == grid.VoxelCount());
+    CompressedVoxels voxels;
+    if (!voxels.Encode(grid, materials, false)) {
+        return std::nullopt;
+    }
+    return voxels;
+}
+
+std::optional<CompressedVoxels> CompressedVoxels::Compress(const VoxelGrid &grid, const VoxelMaterial &material)
+{
+    CompressedVoxels voxels;
+    if (!voxels.Encode(grid, std::span(&material, 1), true)) {
+        return std::nullopt;
+    }
+    return voxels;
+}
+
+bool CompressedVoxels::Encode(const VoxelGrid &grid, std::span<const VoxelMaterial> materials, bool uniform)
+{
+    m_placement = {grid.Dimensions(), grid.Origin(), grid.VoxelSize()};
+    const glm::uvec3 dimensions = grid.Dimensions();
+    // Runs keep their first x in 16 bits
+    if (dimensions.x > 1u << 16) {
+        return false;
+    }
+    const Size row_count = (Size)dimensions.y * dimensions.z;
+    const auto material = [&](Size row, u32 x) -> const VoxelMaterial & {
+        return uniform ? materials[0] : materials[row * dimensions.x + x];
+    };
+
+    // Neighbouring voxels mostly share a material, so the map is only consulted when it changes
+    m_palette = {VoxelMaterial{}};
+    std::unordered_map<u64, u16> palette_indices;
+    u64 last_key = ~0ull;
+    for (Size row = 0; row < row_count; row++) {
+        const auto words = grid.Row((u32)(row % dimensions.y), (u32)(row / dimensions.y));
+        for (u32 word = 0; word < words.size(); word++) {
+            for (u64 bits = words[word]; bits != 0; bits &= bits - 1) {
+                const VoxelMaterial &voxel_material = material(row, word * 64 + (u32)std::countr_zero(bits));
+                const u64 key = MaterialKey(voxel_material);
+                if (key == last_key || palette_indices.contains(key)) {
+                    last_key = key;
+                    continue;
+                }
+                if (m_palette.size() == MAX_PALETTE_SIZE) {
+                    return false;
+                }
+                palette_indices.emplace(key, (u16)m_palette.size());
+                m_palette.push_back(voxel_material);
+                last_key = key;
+            }
+        }
+    }
+    m_index_bits = std::max(1u, (u32)std::bit_width(m_palette.size() - 1));
+
+    const u32 packed_words = (dimensions.x * m_index_bits + 31) / 32;
+    std::vector<std::vector<u16>> range_indices(WorkerCount());
+    const auto row_indices = [&](Size row, std::vector<u16> &indices) {
+        indices.assign(dimensions.x, EMPTY);
+        const auto words = grid.Row((u32)(row % dimensions.y), (u32)(row / dimensions.y));
+        u64 last_key = ~0ull;
+        u16 last_index = EMPTY;
+        for (u32 word = 0; word < words.size(); word++) {
+            for (u64 bits = words[word]; bits != 0; bits &= bits - 1) {
+                const u32 x = word * 64 + (u32)std::countr_zero(bits);
+                const u64 key = MaterialKey(material(row, x));
+                if (key != last_key) {
+                    last_index = palette_indices.at(key);
+                    last_key = key;
+                }
+                indices[x] = last_index;
+            }
+        }
+    };
+
+    // Sizes first, then every row writes its words at its prefix sum
+    m_row_offsets.assign(row_count + 1, 0);
+    m_row_first_solid.assign(row_count + 1, 0);
+    m_packed_rows.assign((row_count + 63) / 64, 0);
+    ParallelForRanges(
+        row_count,
+        [&](Size begin, Size end, u32 range) {
+            std::vector<u16> &indices = range_indices[range];
+            for (Size row = begin; row < end; row++) {
+                row_indices(row, indices);
+                u32 runs = 1;
+                u32 solid = indices[0] != EMPTY;
+                for (u32 x = 1; x < dimensions.x; x++) {
+                    runs += indices[x] != indices[x - 1];
+                    solid += indices[x] != EMPTY;
+                }
+                if (runs > packed_words) {
+                    std::atomic_ref<u64>(m_packed_rows[row / 64])
+                        .fetch_or(1ull << (row % 64), std::memory_order_relaxed);
+                }
+                m_row_offsets[row + 1] = std::min(runs, packed_words);
+                m_row_first_solid[row + 1] = solid;
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    std::inclusive_scan(m_row_offsets.begin(), m_row_offsets.end(), m_row_offsets.begin());
+    std::inclusive_scan(m_row_first_solid.begin(), m_row_first_solid.end(), m_row_first_solid.begin());
+
+    m_words.assign(m_row_offsets.back(), 0);
+    ParallelForRanges(
+        row_count,
+        [&](Size begin, Size end, u32 range) {
+            std::vector<u16> &indices = range_indices[range];
+            for (Size row = begin; row < end; row++) {
+                row_indices(row, indices);
+                u32 *out = &m_words[m_row_offsets[row]];
+                if (IsPacked(row)) {
+                    for (u32 x = 0; x < dimensions.x; x++) {
+                        const u32 bit = x * m_index_bits;
+                        out[bit / 32] |= (u32)indices[x] << (bit % 32);
+                        if (bit % 32 + m_index_bits > 32) {
+                            out[bit / 32 + 1] |= (u32)indices[x] >> (32 - bit % 32);
+                        }
+                    }
+                    continue;
+                }
+                *out++ = indices[0];
+                for (u32 x = 1; x < dimensions.x; x++) {
+                    if (indices[x] != indices[x - 1]) {
+                        *out++ = (x << 16) | indices[x];
+                    }
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    return true;
+}
+
+Size CompressedVoxels::CompressedBytes() const
+{
+    return m_palette.size() * sizeof(VoxelMaterial) + m_row_offsets.size() * sizeof(u32)
+           + m_packed_rows.size() * sizeof(u64) + m_row_first_solid.size() * sizeof(u32) + m_words.size() * sizeof(u32);
+}
+
+u16 CompressedVoxels::PaletteIndex(u32 x, u32 y, u32 z) const
+{
+    const Size row = (Size)z * m_placement.dimensions.y + y;
+    const u32 *words = &m_words[m_row_offsets[row]];
+    if (IsPacked(row)) {
+        const u32 bit = x * m_index_bits;
+        u64 value = words[bit / 32] >> (bit % 32);
+        if (bit % 32 + m_index_bits > 32) {
+            value |= (u64)words[bit / 32 + 1] << (32 - bit % 32);
+        }
+        return (u16)(value & ((1u << m_index_bits) - 1));
+    }
+    // Last run starting at or before x
+    const u32 *end = &m_words[m_row_offsets[row + 1]];
+    const u32 *run = std::upper_bound(words, end, x, [](u32 value, u32 word) { return value < (word >> 16); });
+    return (u16)(*(run - 1) & 0xFFFF);
+}
+
+void CompressedVoxels::DecodeRow(u32 y, u32 z, std::span<u16> indices) const
+{
+    const u32 width = m_placement.dimensions.x;
+    const Size row = (Size)z * m_placement.dimensions.y + y;
+    const u32 *words = &m_words[m_row_offsets[row]];
+    const u32 word_count = m_row_offsets[row + 1] - m_row_offsets[row];
+    if (IsPacked(row)) {
+        const u32 mask = (1u << m_index_bits) - 1;
+        for (u32 x = 0; x < width; x++) {
+            const u32 bit = x * m_index_bits;
+            u64 value = words[bit / 32] >> (bit % 32);
+            if (bit % 32 + m_index_bits > 32) {
+                value |= (u64)words[bit / 32 + 1] << (32 - bit % 32);
+            }
+            indices[x] = (u16)(value & mask);
+        }
+        return;
+    }
+    for (u32 run = 0; run < word_count; run++) {
+        const u32 begin = words[run] >> 16;
+        const u32 end = run + 1 < word_count ? words[run + 1] >> 16 : width;
+        std::fill(indices.begin() + begin, indices.begin() + end, (u16)(words[run] & 0xFFFF));
+    }
+}
+
+VoxelGrid CompressedVoxels::DecodeOccupancy() const
+{
+    VoxelGrid grid(m_placement.dimensions, m_placement.origin, m_placement.voxel_size);
+    const glm::uvec3 dimensions = m_placement.dimensions;
+    std::vector<std::vector<u16>> range_indices(WorkerCount());
+    ParallelForRanges(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size begin, Size end, u32 range) {
+            for (Size row = begin; row < end; row++) {
+                const u32 y = (u32)(row % dimensions.y);
+                const u32 z = (u32)(row / dimensions.y);
+                const std::span<u64> out = grid.Row(y, z);
+                if (IsPacked(row)) {
+                    std::vector<u16> &indices = range_indices[range];
+                    indices.resize(dimensions.x);
+                    DecodeRow(y, z, indices);
+                    for (u32 x = 0; x < dimensions.x; x++) {
+                        out[x / 64] |= (u64)(indices[x] != EMPTY) << (x % 64);
+                    }
+                    continue;
+                }
+                // Whole words per run
+                const u32 first = m_row_offsets[row];
+                const u32 last = m_row_offsets[row + 1];
+                for (u32 run = first; run < last; run++) {
+                    if ((m_words[run] & 0xFFFF) == EMPTY) {
+                        continue;
+                    }
+                    const u32 run_begin = m_words[run] >> 16;
+                    const u32 run_end = run + 1 < last ? m_words[run + 1] >> 16 : dimensions.x;
+                    for (u32 word = run_begin / 64; word * 64 < run_end; word++) {
+                        out[word] |= RangeMask(word, run_begin, run_end);
+                    }
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    return grid;
+}
+
+void CompressedVoxels::DecodeSolidMaterials(std::span<f32> densities, std::span<f32> stiffnesses) const
+{
+    assert(densities.size() == SolidCount() && stiffnesses.size() == SolidCount());
+    const glm::uvec3 dimensions = m_placement.dimensions;
+    std::vector<std::vector<u16>> range_indices(WorkerCount());
+    ParallelForRanges(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size begin, Size end, u32 range) {
+            for (Size row = begin; row < end; row++) {
+                Size solid = m_row_first_solid[row];
+                if (IsPacked(row)) {
+                    std::vector<u16> &indices = range_indices[range];
+                    indices.resize(dimensions.x);
+                    DecodeRow((u32)(row % dimensions.y), (u32)(row / dimensions.y), indices);
+                    for (const u16 index : indices) {
+                        if (index != EMPTY) {
+                            densities[solid] = m_palette[index].density;
+                            stiffnesses[solid] = m_palette[index].stiffness;
+                            solid++;
+                        }
+                    }
+                    continue;
+                }
+                const u32 first = m_row_offsets[row];
+                const u32 last = m_row_offsets[row + 1];
+                for (u32 run = first; run < last; run++) {
+                    const u16 index = (u16)(m_words[run] & 0xFFFF);
+                    if (index == EMPTY) {
+                        continue;
+                    }
+                    const u32 run_begin = m_words[run] >> 16;
+                    const u32 run_end = run + 1 < last ? m_words[run + 1] >> 16 : dimensions.x;
+                    std::fill_n(densities.begin() + solid, run_end - run_begin, m_palette[index].density);
+                    std::fill_n(stiffnesses.begin() + solid, run_end - run_begin, m_palette[index].stiffness);
+                    solid += run_end - run_begin;
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+}
+
+bool CompressedVoxels::RowsAreValid() const
+{
+    const u32 width = m_placement.dimensions.x;
+    const u32 palette_size = (u32)m_palette.size();
+    const u32 packed_words = (width * m_index_bits + 31) / 32;
+    std::atomic<bool> valid = true;
+    ParallelFor(
+        m_row_offsets.size() - 1,
+        [&](Size row) {
+            const u32 first = m_row_offsets[row];
+            const u32 last = m_row_offsets[row + 1];
+            u64 solid = 0;
+            if (IsPacked(row)) {
+                if (last - first != packed_words) {
+                    valid.store(false, std::memory_order_relaxed);
+                    return;
+                }
+                const u32 *words = &m_words[first];
+                for (u32 x = 0; x < width; x++) {
+                    const u32 bit = x * m_index_bits;
+                    u64 value = words[bit / 32] >> (bit % 32);
+                    if (bit % 32 + m_index_bits > 32) {
+                        value |= (u64)words[bit / 32 + 1] << (32 - bit % 32);
+                    }
+                    const u32 index = (u32)(value & ((1u << m_index_bits) - 1));
+                    if (index >= palette_size) {
+                        valid.store(false, std::memory_order_relaxed);
+                        return;
+                    }
+                    solid += index != EMPTY;
+                }
+            } else {
+                // Runs start at x = 0 and strictly increase inside the row
+                if (first == last || (m_words[first] >> 16) != 0) {
+                    valid.store(false, std::memory_order_relaxed);
+                    return;
+                }
+                for (u32 run = first; run < last; run++) {
+                    const u32 run_begin = m_words[run] >> 16;
+                    const u32 run_end = run + 1 < last ? m_words[run + 1] >> 16 : width;
+                    if (run_begin >= run_end || run_end > width || (m_words[run] & 0xFFFF) >= palette_size) {
+                        valid.store(false, std::memory_order_relaxed);
+                        return;
+                    }
+                    solid += (m_words[run] & 0xFFFF) != EMPTY ? run_end - run_begin : 0;
+                }
+            }
+            if (m_row_first_solid[row + 1] != m_row_first_solid[row] + solid) {
+                valid.store(false, std::memory_order_relaxed);
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    return valid.load(std::memory_order_relaxed);
+}
+
+std::vector<u8> CompressedVoxels::Serialize() const
+{
+    const SerializedHeader header = {
+        .dimensions = m_placement.dimensions,
+        .voxel_size = m_placement.voxel_size,
+        .origin = m_placement.origin,
+        .index_bits = m_index_bits,
+        .palette_size = (u32)m_palette.size(),
+        .word_count = (u32)m_words.size(),
+    };
+    std::vector<u8> bytes;
+    bytes.reserve(sizeof(header) + CompressedBytes());
+    Append(bytes, std::span(&header, 1));
+    Append(bytes, std::span(m_palette));
+    Append(bytes, std::span(m_row_offsets));
+    Append(bytes, std::span(m_packed_rows));
+    Append(bytes, std::span(m_row_first_solid));
+    Append(bytes, std::span(m_words));
+    return bytes;
+}
+
+std::optional<CompressedVoxels> CompressedVoxels::Deserialize(std::span<const u8> bytes)
+{
+    SerializedHeader header;
+    if (bytes.size() < sizeof(header)) {
+        return std::nullopt;
+    }
+    memcpy(&header, bytes.data(), sizeof(header));
+    bytes = bytes.subspan(sizeof(header));
+    if (header.magic != SerializedHeader::MAGIC || header.version != SerializedHeader::VERSION
+        || header.palette_size == 0 || header.palette_size > MAX_PALETTE_SIZE || header.index_bits == 0
+        || header.index_bits != std::max(1u, (u32)std::bit_width(header.palette_size - 1)) || header.dimensions.x == 0
+        || header.dimensions.x > 1u << 16) {
+        return std::nullopt;
+    }
+
+    CompressedVoxels voxels;
+    voxels.m_placement = {header.dimensions, header.origin, header.voxel_size};
+    voxels.m_index_bits = header.index_bits;
+    const Size row_count = (Size)header.dimensions.y * header.dimensions.z;
+    if (!Consume(bytes, voxels.m_palette, header.palette_size) || !Consume(bytes, voxels.m_row_offsets, row_count + 1)
+        || !Consume(bytes, voxels.m_packed_rows, (row_count + 63) / 64)
+        || !Consume(bytes, voxels.m_row_first_solid, row_count + 1)
+        || !Consume(bytes, voxels.m_words, header.word_count)) {
+        return std::nullopt;
+    }
+    if (voxels.m_row_offsets.front() != 0 || voxels.m_row_offsets.back() != header.word_count
+        || !std::is_sorted(voxels.m_row_offsets.begin(), voxels.m_row_offsets.end())
+        || voxels.m_row_first_solid.front() != 0 || !voxels.RowsAreValid()) {
+        return std::nullopt;
+    }
+    return voxels;
+}
+
+void BenchmarkVoxelCompression(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+    constexpr u32 LOOKUPS = 1 << 20;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto best_of = [&](auto &&fn) {
+        f64 best = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            const auto start = Clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    };
+
+    // Dense is a bit per voxel plus a material for every voxel, per solid only stores materials of solid voxels
+    printf("%-24s %16s %8s %12s %10s %10s %12s %12s %8s %12s %12s\n", "file", "grid", "palette", "bytes", "vs dense",
+        "vs solid", "encode ms", "lookup ns", "solid %", "occupancy ms", "material ms");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+        VoxelizeSolid(mesh, grid);
+        const glm::uvec3 dimensions = grid.Dimensions();
+
+        // Four density layers from bottom to top, the surface shell stiffer than the inside
+        const VoxelGrid surface = ExtractSurfaceVoxels(grid);
+        std::vector<VoxelMaterial> materials(grid.VoxelCount());
+        for (u32 z = 0; z < dimensions.z; z++) {
+            for (u32 y = 0; y < dimensions.y; y++) {
+                for (u32 x = 0; x < dimensions.x; x++) {
+                    materials[((Size)z * dimensions.y + y) * dimensions.x + x] = {
+                        .density = 1.0f + (f32)(y * 4 / dimensions.y),
+                        .stiffness = surface.Get(x, y, z) ? 10.0f : 1.0f,
+                    };
+                }
+            }
+        }
+
+        CompressedVoxels compressed;
+        const f64 encode_ms = best_of([&]() { compressed = *CompressedVoxels::Compress(grid, materials); });
+
+        std::mt19937 rng(1);
+        std::vector<glm::uvec3> lookups(LOOKUPS);
+        for (glm::uvec3 &lookup : lookups) {
+            lookup = {rng() % dimensions.x, rng() % dimensions.y, rng() % dimensions.z};
+        }
+        Size solid_lookups = 0;
+        const f64 lookup_ms = best_of([&]() {
+            for (const glm::uvec3 &lookup : lookups) {
+                solid_lookups += compressed.IsSolid(lookup.x, lookup.y, lookup.z);
+            }
+        });
+
+        const f64 occupancy_ms = best_of([&]() { compressed.DecodeOccupancy(); });
+        std::vector<f32> densities(compressed.SolidCount());
+        std::vector<f32> stiffnesses(compressed.SolidCount());
+        const f64 material_ms = best_of([&]() { compressed.DecodeSolidMaterials(densities, stiffnesses); });
+
+        const f64 bytes = (f64)compressed.CompressedBytes();
+        const f64 occupancy_bytes = (f64)grid.Words().size_bytes();
+        const f64 dense = occupancy_bytes + (f64)grid.VoxelCount() * sizeof(VoxelMaterial);
+        const f64 per_solid = occupancy_bytes + (f64)compressed.SolidCount() * sizeof(VoxelMaterial);
+        const std::string grid_size = std::to_string(dimensions.x) + "x" + std::to_string(dimensions.y) + "x"
+                                      + std::to_string(dimensions.z);
+        printf("%-24s %16s %8zu %12.0f %9.1fx %9.1fx %12.3f %12.2f %8.1f %12.3f %12.3f\n",
+            path.filename().string().c_str(), grid_size.c_str(), compressed.Palette().size(), bytes, dense / bytes,
+            per_solid / bytes, encode_ms, lookup_ms * 1e6 / LOOKUPS,
+            100.0 * (f64)solid_lookups / ((f64)LOOKUPS * ITERATIONS), occupancy_ms, material_ms);
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "common.h"
+#include "voxel_grid.hpp"
+
+#include <glm/vec3.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+struct VoxelMaterial {
+    f32 density = 1.0f;
+    f32 stiffness = 1.0f;
+
+    bool operator==(const VoxelMaterial &other) const = default;
+};
+
+// Occupancy plus a material per solid voxel, stored as palette indices with index 0 meaning empty. Every row along x
+// is either run-length encoded or bit-packed at IndexBits() per voxel, whichever is smaller, and a row index gives
+// random access to both. Solid bodies with a handful of materials come down to a few runs per row.
+class CompressedVoxels
+{
+  public:
+    static constexpr u16 EMPTY = 0;
+    static constexpr u32 MAX_MATERIALS = (1u << 16) - 1;
+
+    CompressedVoxels() = default;
+    // materials holds one entry per voxel of grid, x fastest, entries of empty voxels are ignored. Nothing when there
+    // are more than MAX_MATERIALS distinct materials or the grid is more than 2^16 voxels wide.
+    static std::optional<CompressedVoxels> Compress(const VoxelGrid &grid, std::span<const VoxelMaterial> materials);
+    // Every solid voxel gets material
+    static std::optional<CompressedVoxels> Compress(const VoxelGrid &grid, const VoxelMaterial &material);
+
+    glm::uvec3 Dimensions() const { return m_placement.dimensions; }
+    glm::vec3 Origin() const { return m_placement.origin; }
+    f32 VoxelSize() const { return m_placement.voxel_size; }
+    // Entry 0 stands for empty and holds a default material
+    std::span<const VoxelMaterial> Palette() const { return m_palette; }
+    u32 IndexBits() const { return m_index_bits; }
+    Size SolidCount() const { return m_row_first_solid.empty() ? 0 : m_row_first_solid.back(); }
+    // Memory held by the encoded rows, the row index and the palette
+    Size CompressedBytes() const;
+
+    u16 PaletteIndex(u32 x, u32 y, u32 z) const;
+    bool IsSolid(u32 x, u32 y, u32 z) const { return PaletteIndex(x, y, z) != EMPTY; }
+    // indices needs Dimensions().x entries
+    void DecodeRow(u32 y, u32 z, std::span<u16> indices) const;
+
+    // Bulk decodes, in parallel over rows
+    VoxelGrid DecodeOccupancy() const;
+    // One entry per solid voxel in (z, y, x) order, the particle order of a SimulationBody
+    void DecodeSolidMaterials(std::span<f32> densities, std::span<f32> stiffnesses) const;
+
+    std::vector<u8> Serialize() const;
+    // Nothing when bytes aren't a serialized CompressedVoxels of this version, or when any row index, run or palette
+    // index in them is out of range
+    static std::optional<CompressedVoxels> Deserialize(std::span<const u8> bytes);
+
+  private:
+    GridPlacement m_placement = {};
+    std::vector<VoxelMaterial> m_palette;
+    u32 m_index_bits = 1;
+    // Words of row (y, z) are m_words[m_row_offsets[row]..m_row_offsets[row + 1]), row = z * dimensions.y + y. Runs
+    // are (first x << 16) | palette index, packed rows hold IndexBits() per voxel from the low bits up.
+    std::vector<u32> m_row_offsets;
+    // Bit row is set for bit-packed rows
+    std::vector<u64> m_packed_rows;
+    // Solid voxels before each row
+    std::vector<u32> m_row_first_solid;
+    std::vector<u32> m_words;
+
+    // False when the materials don't fit the palette or the grid doesn't fit the runs
+    bool Encode(const VoxelGrid &grid, std::span<const VoxelMaterial> materials, bool uniform);
+    // Whether every row decodes inside its words with palette indices in range and matches m_row_first_solid.
+    // Expects m_row_offsets to already be checked.
+    bool RowsAreValid() const;
+    bool IsPacked(Size row) const { return (m_packed_rows[row / 64] >> (row % 64)) & 1; }
+};
+
+// Compression ratio, encode and decode times for layered test materials, for every .obj in directory
+void BenchmarkVoxelCompression(const char *directory, u32 resolution);
@@ -0,0 +1,55 @@
+#include "voxel_grid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+VoxelGrid::VoxelGrid(glm::uvec3 dimensions, glm::vec3 origin, f32 voxel_size)
+    : m_dimensions(dimensions), m_origin(origin), m_voxel_size(voxel_size), m_words_per_row((dimensions.x + 63) / 64),
+      m_words((Size)m_words_per_row * dimensions.y * dimensions.z, 0)
+{
+}
+
+u64 VoxelGrid::LastWordMask() const
+{
+    const u32 used_bits = m_dimensions.x % 64;
+    return used_bits == 0 ? ~0ull : (1ull << used_bits) - 1;
+}
+
+Size VoxelGrid::CountSolid() const
+{
+    // Bits past the end of a row are never set, so there's no need to mask
+    Size count = 0;
+    for (u64 word : m_words) {
+        count += std::popcount(word);
+    }
+    return count;
+}
+
+void VoxelGrid::Clear()
+{
+    std::fill(m_words.begin(), m_words.end(), 0);
+}
+
+glm::vec3 VoxelGrid::VoxelCenter(u32 x, u32 y, u32 z) const
+{
+    return m_origin + (glm::vec3(x, y, z) + 0.5f) * m_voxel_size;
+}
+
+GridPlacement PlaceGrid(const Bounds &bounds, u32 resolution, u32 padding)
+{
+    const glm::vec3 extent = bounds.max - bounds.min;
+    const f32 longest = std::max({extent.x, extent.y, extent.z});
+    const f32 voxel_size = longest > 0.0f ? longest / (f32)std::max(resolution, 1u) : 1.0f;
+    glm::uvec3 dimensions;
+    for (u32 axis = 0; axis < 3; axis++) {
+        dimensions[axis] = std::max(1u, (u32)std::ceil(extent[axis] / voxel_size)) + 2 * padding;
+    }
+    return {dimensions, bounds.min - voxel_size * (f32)padding, voxel_size};
+}
+
+VoxelGrid CreateGridForBounds(const Bounds &bounds, u32 resolution, u32 padding)
+{
+    const GridPlacement placement = PlaceGrid(bounds, resolution, padding);
+    return VoxelGrid(placement.dimensions, placement.origin, placement.voxel_size);
+}
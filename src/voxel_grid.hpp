@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+
+#include <atomic>
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// Dense occupancy grid with one bit per voxel. Rows along x are packed into 64 bit words and padded to a whole word,
+// row (y, z) starts at word (z * dimensions.y + y) * WordsPerRow(). Voxel (x, y, z) covers
+// [origin + voxel_size * (x, y, z), origin + voxel_size * (x + 1, y + 1, z + 1)).
+class VoxelGrid
+{
+  public:
+    VoxelGrid() = default;
+    VoxelGrid(glm::uvec3 dimensions, glm::vec3 origin, f32 voxel_size);
+
+    glm::uvec3 Dimensions() const { return m_dimensions; }
+    glm::vec3 Origin() const { return m_origin; }
+    f32 VoxelSize() const { return m_voxel_size; }
+    u32 WordsPerRow() const { return m_words_per_row; }
+    Size VoxelCount() const { return (Size)m_dimensions.x * m_dimensions.y * m_dimensions.z; }
+
+    bool Get(u32 x, u32 y, u32 z) const { return (Row(y, z)[x / 64] >> (x % 64)) & 1; }
+    void Set(u32 x, u32 y, u32 z) { Row(y, z)[x / 64] |= 1ull << (x % 64); }
+    void Reset(u32 x, u32 y, u32 z) { Row(y, z)[x / 64] &= ~(1ull << (x % 64)); }
+    // For threads that share words, e.g. voxelizing neighbouring triangles of the same row
+    void SetAtomic(u32 x, u32 y, u32 z)
+    {
+        std::atomic_ref<u64>(Row(y, z)[x / 64]).fetch_or(1ull << (x % 64), std::memory_order_relaxed);
+    }
+
+    std::span<u64> Row(u32 y, u32 z) { return {&m_words[RowOffset(y, z)], m_words_per_row}; }
+    std::span<const u64> Row(u32 y, u32 z) const { return {&m_words[RowOffset(y, z)], m_words_per_row}; }
+    std::span<u64> Words() { return m_words; }
+    std::span<const u64> Words() const { return m_words; }
+
+    // Bits past dimensions.x in the last word of a row, callers doing whole-word operations mask with this
+    u64 LastWordMask() const;
+
+    Size CountSolid() const;
+    void Clear();
+
+    glm::vec3 VoxelCenter(u32 x, u32 y, u32 z) const;
+    // Position in voxel units relative to the origin, voxel (x, y, z) spans [x, x + 1) etc.
+    glm::vec3 ToGridSpace(const glm::vec3 &position) const { return (position - m_origin) / m_voxel_size; }
+
+  private:
+    glm::uvec3 m_dimensions = {};
+    glm::vec3 m_origin = {};
+    f32 m_voxel_size = 1.0f;
+    u32 m_words_per_row = 0;
+    std::vector<u64> m_words;
+
+    Size RowOffset(u32 y, u32 z) const { return ((Size)z * m_dimensions.y + y) * m_words_per_row; }
+};
+
+struct GridPlacement {
+    glm::uvec3 dimensions;
+    glm::vec3 origin;
+    f32 voxel_size;
+};
+
+// Grid whose longest axis has `resolution` voxels across the bounds, plus `padding` empty voxels on every side
+GridPlacement PlaceGrid(const Bounds &bounds, u32 resolution, u32 padding = 1);
+
+// Empty grid at PlaceGrid(bounds, resolution, padding)
+VoxelGrid CreateGridForBounds(const Bounds &bounds, u32 resolution, u32 padding = 1);
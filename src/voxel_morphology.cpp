@@ -0,0 +1,150 @@
+#include "voxel_morphology.hpp"
+
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxelizer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <utility>
+
+namespace
+{
+
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+
+enum class Operation {
+    Dilate,
+    Erode,
+};
+
+// One step from source into target, which has the same placement
+void Step(const VoxelGrid &source, VoxelGrid &target, Operation operation, Connectivity connectivity)
+{
+    const glm::uvec3 dimensions = source.Dimensions();
+    ParallelFor(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            const auto solid = source.Row(y, z);
+            const auto out = target.Row(y, z);
+            if (operation == Operation::Dilate) {
+                AnyNeighborSolidRow(source, y, z, connectivity, out);
+                for (Size word = 0; word < out.size(); word++) {
+                    out[word] |= solid[word];
+                }
+            } else {
+                AllNeighborsSolidRow(source, y, z, connectivity, out);
+                for (Size word = 0; word < out.size(); word++) {
+                    out[word] &= solid[word];
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+}
+
+VoxelGrid Apply(const VoxelGrid &grid, u32 steps, Operation operation, Connectivity connectivity)
+{
+    if (steps == 0) {
+        return grid;
+    }
+    VoxelGrid result(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    Step(grid, result, operation, connectivity);
+    if (steps > 1) {
+        VoxelGrid scratch(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+        for (u32 i = 1; i < steps; i++) {
+            Step(result, scratch, operation, connectivity);
+            std::swap(result, scratch);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+VoxelGrid DilateVoxels(const VoxelGrid &grid, u32 steps, Connectivity connectivity)
+{
+    return Apply(grid, steps, Operation::Dilate, connectivity);
+}
+
+VoxelGrid ErodeVoxels(const VoxelGrid &grid, u32 steps, Connectivity connectivity)
+{
+    return Apply(grid, steps, Operation::Erode, connectivity);
+}
+
+VoxelGrid OpenVoxels(const VoxelGrid &grid, u32 steps, Connectivity connectivity)
+{
+    return DilateVoxels(ErodeVoxels(grid, steps, connectivity), steps, connectivity);
+}
+
+VoxelGrid CloseVoxels(const VoxelGrid &grid, u32 steps, Connectivity connectivity)
+{
+    return ErodeVoxels(DilateVoxels(grid, steps, connectivity), steps, connectivity);
+}
+
+VoxelGrid ShellVoxels(const VoxelGrid &grid, u32 thickness, Connectivity connectivity)
+{
+    VoxelGrid shell = grid;
+    const VoxelGrid core = ErodeVoxels(grid, thickness, connectivity);
+    const auto core_words = core.Words();
+    const auto words = shell.Words();
+    for (Size word = 0; word < words.size(); word++) {
+        words[word] &= ~core_words[word];
+    }
+    return shell;
+}
+
+void BenchmarkVoxelMorphology(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+    constexpr u32 SHELL_VOXELS = 2;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto best_of = [&](auto &&fn) {
+        f64 best = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            const auto start = Clock::now();
+            fn();
+            best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    };
+
+    printf("%-24s %16s %12s %12s %14s %14s %10s %10s %10s %10s %10s\n", "file", "grid", "solid", "shell",
+        "solid pairs", "shell pairs", "dilate ms", "erode ms", "open ms", "close ms", "shell ms");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+        VoxelizeSolid(mesh, grid);
+
+        const f64 dilate_ms = best_of([&]() { DilateVoxels(grid); });
+        const f64 erode_ms = best_of([&]() { ErodeVoxels(grid); });
+        const f64 open_ms = best_of([&]() { OpenVoxels(grid, 2); });
+        const f64 close_ms = best_of([&]() { CloseVoxels(grid, 2); });
+        VoxelGrid shell;
+        const f64 shell_ms = best_of([&]() { shell = ShellVoxels(grid, SHELL_VOXELS); });
+
+        // Particles and the distance constraints a body would get, solid vs hollow
+        const glm::uvec3 dimensions = grid.Dimensions();
+        const std::string grid_size = std::to_string(dimensions.x) + "x" + std::to_string(dimensions.y) + "x"
+                                      + std::to_string(dimensions.z);
+        printf("%-24s %16s %12zu %12zu %14zu %14zu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+            path.filename().string().c_str(), grid_size.c_str(), grid.CountSolid(), shell.CountSolid(),
+            CountNeighborPairs(grid, Connectivity::Edge18), CountNeighborPairs(shell, Connectivity::Edge18), dilate_ms,
+            erode_ms, open_ms, close_ms, shell_ms);
+    }
+}
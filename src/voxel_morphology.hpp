@@ -0,0 +1,23 @@
+#pragma once
+
+#include "common.h"
+#include "voxel_grid.hpp"
+#include "voxel_neighbors.hpp"
+
+// Binary morphology on whole words of the bit rows. Every step ORs (dilate) or ANDs (erode) a voxel with its
+// neighbours under the connectivity, so Vertex26 grows or shrinks by a cube per step and Face6 by an octahedron. Steps
+// ping-pong between two grids in parallel over rows. Voxels outside the grid read as empty: erosion eats into solids
+// that touch the border, which the padding of PlaceGrid keeps clear of.
+VoxelGrid DilateVoxels(const VoxelGrid &grid, u32 steps = 1, Connectivity connectivity = Connectivity::Vertex26);
+VoxelGrid ErodeVoxels(const VoxelGrid &grid, u32 steps = 1, Connectivity connectivity = Connectivity::Vertex26);
+// Erode then dilate, drops spikes and bridges thinner than 2 * steps + 1 voxels
+VoxelGrid OpenVoxels(const VoxelGrid &grid, u32 steps = 1, Connectivity connectivity = Connectivity::Vertex26);
+// Dilate then erode, fills dents and gaps narrower than 2 * steps + 1 voxels
+VoxelGrid CloseVoxels(const VoxelGrid &grid, u32 steps = 1, Connectivity connectivity = Connectivity::Vertex26);
+
+// Solid voxels within `thickness` steps of empty space, the grid minus its erosion. Cavities count as empty space and
+// get a shell of their own.
+VoxelGrid ShellVoxels(const VoxelGrid &grid, u32 thickness, Connectivity connectivity = Connectivity::Vertex26);
+
+// Morphology times plus solid vs shell voxel and constraint counts, for every .obj in directory
+void BenchmarkVoxelMorphology(const char *directory, u32 resolution);
@@ -0,0 +1,268 @@
+#include "voxel_neighbors.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+// Enough bit planes to count to 26
+constexpr u32 COUNT_PLANES = 5;
+
+constexpr std::array<glm::ivec3, 26> MakeNeighborOffsets()
+{
+    std::array<glm::ivec3, 26> offsets = {};
+    u32 count = 0;
+    // Number of non zero components: 1 for faces, 2 for edges, 3 for corners
+    for (s32 kind = 1; kind <= 3; kind++) {
+        for (s32 z = -1; z <= 1; z++) {
+            for (s32 y = -1; y <= 1; y++) {
+                for (s32 x = -1; x <= 1; x++) {
+                    if ((x != 0) + (y != 0) + (z != 0) == kind) {
+                        offsets[count++] = glm::ivec3(x, y, z);
+                    }
+                }
+            }
+        }
+    }
+    return offsets;
+}
+
+constexpr bool IsForward(const glm::ivec3 &offset)
+{
+    return offset.z > 0 || (offset.z == 0 && (offset.y > 0 || (offset.y == 0 && offset.x > 0)));
+}
+
+// Forward offsets keep the face/edge/corner grouping, so the prefixes still line up with the connectivities
+constexpr std::array<glm::ivec3, 13> MakeForwardOffsets()
+{
+    const auto all = MakeNeighborOffsets();
+    std::array<glm::ivec3, 13> offsets = {};
+    u32 count = 0;
+    for (const glm::ivec3 &offset : all) {
+        if (IsForward(offset)) {
+            offsets[count++] = offset;
+        }
+    }
+    return offsets;
+}
+
+constexpr std::array<glm::ivec3, 26> NEIGHBOR_OFFSETS = MakeNeighborOffsets();
+constexpr std::array<glm::ivec3, 13> FORWARD_OFFSETS = MakeForwardOffsets();
+
+// Word `word` of the row shifted so bit x holds bit x + shift, shift in [-1, 1]. An empty row reads as all zero.
+inline u64 ShiftedWord(std::span<const u64> row, Size word, s32 shift, u64 last_word_mask)
+{
+    if (row.empty()) {
+        return 0;
+    }
+    if (shift > 0) {
+        return (row[word] >> 1) | (word + 1 < row.size() ? row[word + 1] << 63 : 0);
+    }
+    if (shift < 0) {
+        const u64 shifted = (row[word] << 1) | (word > 0 ? row[word - 1] >> 63 : 0);
+        return word + 1 == row.size() ? shifted & last_word_mask : shifted;
+    }
+    return row[word];
+}
+
+// Source row of every offset around row (y, z), empty where it falls outside the grid
+struct NeighborRows {
+    std::array<std::span<const u64>, 26> rows;
+    std::array<s32, 26> shifts;
+    u32 count = 0;
+};
+
+NeighborRows GatherNeighborRows(const VoxelGrid &grid, u32 y, u32 z, std::span<const glm::ivec3> offsets)
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    NeighborRows neighbors;
+    for (const glm::ivec3 &offset : offsets) {
+        const s64 neighbor_y = (s64)y + offset.y;
+        const s64 neighbor_z = (s64)z + offset.z;
+        const bool inside =
+            neighbor_y >= 0 && neighbor_y < dimensions.y && neighbor_z >= 0 && neighbor_z < dimensions.z;
+        neighbors.rows[neighbors.count] = inside ? grid.Row((u32)neighbor_y, (u32)neighbor_z) : std::span<const u64>();
+        neighbors.shifts[neighbors.count] = offset.x;
+        neighbors.count++;
+    }
+    return neighbors;
+}
+
+} // namespace
+
+std::span<const glm::ivec3> NeighborOffsets(Connectivity connectivity)
+{
+    return std::span(NEIGHBOR_OFFSETS).first((Size)connectivity);
+}
+
+std::span<const glm::ivec3> ForwardNeighborOffsets(Connectivity connectivity)
+{
+    return std::span(FORWARD_OFFSETS).first((Size)connectivity / 2);
+}
+
+void NeighborRow(const VoxelGrid &grid, u32 y, u32 z, glm::ivec3 offset, std::span<u64> out)
+{
+    const NeighborRows neighbors = GatherNeighborRows(grid, y, z, std::span(&offset, 1));
+    for (Size word = 0; word < out.size(); word++) {
+        out[word] = ShiftedWord(neighbors.rows[0], word, offset.x, grid.LastWordMask());
+    }
+}
+
+void AllNeighborsSolidRow(const VoxelGrid &grid, u32 y, u32 z, Connectivity connectivity, std::span<u64> out)
+{
+    const NeighborRows neighbors = GatherNeighborRows(grid, y, z, NeighborOffsets(connectivity));
+    const u64 last_word_mask = grid.LastWordMask();
+    for (Size word = 0; word < out.size(); word++) {
+        u64 all = word + 1 == out.size() ? last_word_mask : ~0ull;
+        for (u32 i = 0; i < neighbors.count && all != 0; i++) {
+            all &= ShiftedWord(neighbors.rows[i], word, neighbors.shifts[i], last_word_mask);
+        }
+        out[word] = all;
+    }
+}
+
+void AnyNeighborSolidRow(const VoxelGrid &grid, u32 y, u32 z, Connectivity connectivity, std::span<u64> out)
+{
+    const NeighborRows neighbors = GatherNeighborRows(grid, y, z, NeighborOffsets(connectivity));
+    const u64 last_word_mask = grid.LastWordMask();
+    for (Size word = 0; word < out.size(); word++) {
+        u64 any = 0;
+        for (u32 i = 0; i < neighbors.count; i++) {
+            any |= ShiftedWord(neighbors.rows[i], word, neighbors.shifts[i], last_word_mask);
+        }
+        out[word] = any;
+    }
+}
+
+void SurfaceRow(const VoxelGrid &grid, u32 y, u32 z, std::span<u64> out)
+{
+    const NeighborRows neighbors = GatherNeighborRows(grid, y, z, NeighborOffsets(Connectivity::Face6));
+    const auto solid = grid.Row(y, z);
+    const u64 last_word_mask = grid.LastWordMask();
+    for (Size word = 0; word < out.size(); word++) {
+        u64 surface = 0;
+        for (u32 i = 0; i < neighbors.count && surface != solid[word]; i++) {
+            surface |= solid[word] & ~ShiftedWord(neighbors.rows[i], word, neighbors.shifts[i], last_word_mask);
+        }
+        out[word] = surface;
+    }
+}
+
+VoxelGrid ExtractSurfaceVoxels(const VoxelGrid &grid)
+{
+    VoxelGrid surface(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    const glm::uvec3 dimensions = grid.Dimensions();
+    ParallelFor(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            SurfaceRow(grid, y, z, surface.Row(y, z));
+        },
+        MIN_ROWS_PER_RANGE);
+    return surface;
+}
+
+u32 CountSolidNeighbors(const VoxelGrid &grid, u32 x, u32 y, u32 z, Connectivity connectivity)
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    // Three bits around x from each of the nine rows, then drop the center and whatever the connectivity excludes
+    u32 count = 0;
+    for (s32 dz = -1; dz <= 1; dz++) {
+        for (s32 dy = -1; dy <= 1; dy++) {
+            const s64 row_y = (s64)y + dy;
+            const s64 row_z = (s64)z + dz;
+            if (row_y < 0 || row_y >= dimensions.y || row_z < 0 || row_z >= dimensions.z) {
+                continue;
+            }
+            const auto row = grid.Row((u32)row_y, (u32)row_z);
+            u64 window = 0;
+            for (s32 dx = -1; dx <= 1; dx++) {
+                const s64 column = (s64)x + dx;
+                if (column >= 0 && column < dimensions.x) {
+                    window |= ((row[column / 64] >> (column % 64)) & 1) << (dx + 1);
+                }
+            }
+            // Which of the three dx in this (dy, dz) row belong to the neighbourhood
+            const s32 row_kind = (dy != 0) + (dz != 0);
+            u64 mask = 0;
+            for (s32 dx = -1; dx <= 1; dx++) {
+                const s32 kind = row_kind + (dx != 0);
+                const bool included = kind > 0
+                                      && (connectivity == Connectivity::Vertex26
+                                          || (connectivity == Connectivity::Edge18 && kind <= 2) || kind == 1);
+                mask |= (u64)included << (dx + 1);
+            }
+            count += (u32)std::popcount(window & mask);
+        }
+    }
+    return count;
+}
+
+void CountSolidNeighborsRow(const VoxelGrid &grid, u32 y, u32 z, Connectivity connectivity, std::span<u8> counts)
+{
+    const u32 words = grid.WordsPerRow();
+    std::vector<u64> planes((Size)COUNT_PLANES * words, 0);
+    const NeighborRows neighbors = GatherNeighborRows(grid, y, z, NeighborOffsets(connectivity));
+    const u64 last_word_mask = grid.LastWordMask();
+    for (u32 word = 0; word < words; word++) {
+        u64 sums[COUNT_PLANES] = {};
+        for (u32 i = 0; i < neighbors.count; i++) {
+            // Ripple add one bit per voxel into the planes, 64 voxels per operation
+            u64 carry = ShiftedWord(neighbors.rows[i], word, neighbors.shifts[i], last_word_mask);
+            for (u32 plane = 0; plane < COUNT_PLANES && carry != 0; plane++) {
+                const u64 next_carry = sums[plane] & carry;
+                sums[plane] ^= carry;
+                carry = next_carry;
+            }
+        }
+        for (u32 plane = 0; plane < COUNT_PLANES; plane++) {
+            planes[(Size)plane * words + word] = sums[plane];
+        }
+    }
+    for (u32 x = 0; x < grid.Dimensions().x; x++) {
+        u8 count = 0;
+        for (u32 plane = 0; plane < COUNT_PLANES; plane++) {
+            count |= (u8)(((planes[(Size)plane * words + x / 64] >> (x % 64)) & 1) << plane);
+        }
+        counts[x] = count;
+    }
+}
+
+Size CountNeighborPairs(const VoxelGrid &grid, Connectivity connectivity)
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    std::vector<Size> range_counts(WorkerCount(), 0);
+    const u32 range_count = ParallelForRanges(
+        (Size)dimensions.y * dimensions.z,
+        [&](Size begin, Size end, u32 range) {
+            const u64 last_word_mask = grid.LastWordMask();
+            Size count = 0;
+            for (Size row = begin; row < end; row++) {
+                const u32 y = (u32)(row % dimensions.y);
+                const u32 z = (u32)(row / dimensions.y);
+                const auto solid = grid.Row(y, z);
+                const NeighborRows neighbors = GatherNeighborRows(grid, y, z, ForwardNeighborOffsets(connectivity));
+                for (Size word = 0; word < solid.size(); word++) {
+                    if (solid[word] == 0) {
+                        continue;
+                    }
+                    for (u32 i = 0; i < neighbors.count; i++) {
+                        count += std::popcount(
+                            solid[word] & ShiftedWord(neighbors.rows[i], word, neighbors.shifts[i], last_word_mask));
+                    }
+                }
+            }
+            range_counts[range] = count;
+        },
+        MIN_ROWS_PER_RANGE);
+    Size total = 0;
+    for (u32 range = 0; range < range_count; range++) {
+        total += range_counts[range];
+    }
+    return total;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "common.h"
+#include "voxel_grid.hpp"
+
+#include <bit>
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+enum class Connectivity {
+    Face6 = 6,
+    Edge18 = 18,
+    Vertex26 = 26,
+};
+
+// Faces first, then edges, then corners, so every connectivity is a prefix of the 26 offsets
+std::span<const glm::ivec3> NeighborOffsets(Connectivity connectivity);
+// The half of NeighborOffsets that points towards higher (z, y, x), so each pair of voxels is visited once
+std::span<const glm::ivec3> ForwardNeighborOffsets(Connectivity connectivity);
+
+// The row of neighbours at offset from row (y, z): bit x of out is voxel (x + offset.x, y + offset.y, z + offset.z).
+// Voxels outside the grid read as empty. out needs WordsPerRow() words.
+void NeighborRow(const VoxelGrid &grid, u32 y, u32 z, glm::ivec3 offset, std::span<u64> out);
+
+// Bit x is set when every neighbour of voxel (x, y, z) is solid
+void AllNeighborsSolidRow(const VoxelGrid &grid, u32 y, u32 z, Connectivity connectivity, std::span<u64> out);
+// Bit x is set when at least one neighbour of voxel (x, y, z) is solid
+void AnyNeighborSolidRow(const VoxelGrid &grid, u32 y, u32 z, Connectivity connectivity, std::span<u64> out);
+// Bit x is set when voxel (x, y, z) is solid and at least one of its face neighbours isn't
+void SurfaceRow(const VoxelGrid &grid, u32 y, u32 z, std::span<u64> out);
+VoxelGrid ExtractSurfaceVoxels(const VoxelGrid &grid);
+
+// Popcount over the 3x3x3 block around the voxel, masked down to the connectivity
+u32 CountSolidNeighbors(const VoxelGrid &grid, u32 x, u32 y, u32 z, Connectivity connectivity);
+// The same count for a whole row at once, summing the neighbour rows with a bit-sliced adder. counts needs
+// Dimensions().x entries.
+void CountSolidNeighborsRow(const VoxelGrid &grid, u32 y, u32 z, Connectivity connectivity, std::span<u8> counts);
+
+// Number of solid-solid neighbour pairs, e.g. the distance constraints a soft body built from the grid would get
+Size CountNeighborPairs(const VoxelGrid &grid, Connectivity connectivity);
+
+// Calls fn(a, b) for every pair of solid neighbours in rows [row_begin, row_end), where row = z * dimensions.y + y.
+// Each pair is reported once, from the voxel with the lower (z, y, x). Split the rows with ParallelForRanges to build
+// constraints on several threads.
+template<typename F>
+void ForEachNeighborPair(const VoxelGrid &grid, Connectivity connectivity, Size row_begin, Size row_end, F &&fn)
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    std::vector<u64> neighbors(grid.WordsPerRow());
+    for (Size row = row_begin; row < row_end; row++) {
+        const u32 y = (u32)(row % dimensions.y);
+        const u32 z = (u32)(row / dimensions.y);
+        const auto solid = grid.Row(y, z);
+        for (const glm::ivec3 &offset : ForwardNeighborOffsets(connectivity)) {
+            NeighborRow(grid, y, z, offset, neighbors);
+            for (u32 word = 0; word < neighbors.size(); word++) {
+                u64 pairs = solid[word] & neighbors[word];
+                while (pairs != 0) {
+                    const u32 x = word * 64 + (u32)std::countr_zero(pairs);
+                    fn(glm::uvec3(x, y, z), glm::uvec3(glm::ivec3(x, y, z) + offset));
+                    pairs &= pairs - 1;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#include "voxel_pyramid.hpp"
+
+#include "mesh_processing.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <glm/vector_relational.hpp>
+
+namespace
+{
+
+constexpr Size MIN_ROWS_PER_RANGE = 16;
+
+u32 LevelResolution(u32 finest_resolution, u32 level)
+{
+    return (finest_resolution + (1u << level) - 1) >> level;
+}
+
+} // namespace
+
+VoxelPyramid::VoxelPyramid(VoxelGrid finest)
+{
+    m_levels.push_back({std::move(finest), {}});
+    while (glm::any(glm::greaterThan(m_levels.back().occupancy.Dimensions(), glm::uvec3(1)))) {
+        const Level &fine = m_levels.back();
+        const glm::uvec3 fine_dimensions = fine.occupancy.Dimensions();
+        const glm::uvec3 dimensions = (fine_dimensions + 1u) / 2u;
+        Level coarse = {VoxelGrid(dimensions, fine.occupancy.Origin(), 2.0f * fine.occupancy.VoxelSize()),
+            std::vector<f32>((Size)dimensions.x * dimensions.y * dimensions.z)};
+        const bool from_bits = m_levels.size() == 1;
+
+        // Every coarse row reads up to four fine rows and is written by one thread only
+        ParallelFor(
+            (Size)dimensions.y * dimensions.z,
+            [&](Size row) {
+                const u32 y = (u32)(row % dimensions.y);
+                const u32 z = (u32)(row / dimensions.y);
+                const auto occupancy = coarse.occupancy.Row(y, z);
+                f32 *fractions = &coarse.fractions[row * dimensions.x];
+                for (u32 dz = 0; dz < 2 && 2 * z + dz < fine_dimensions.z; dz++) {
+                    for (u32 dy = 0; dy < 2 && 2 * y + dy < fine_dimensions.y; dy++) {
+                        const u32 fine_y = 2 * y + dy;
+                        const u32 fine_z = 2 * z + dz;
+                        if (from_bits) {
+                            // Pairs of bits never straddle a word, and bits past the end of a row are zero
+                            const auto bits = fine.occupancy.Row(fine_y, fine_z);
+                            for (u32 x = 0; x < dimensions.x; x++) {
+                                fractions[x] += (f32)std::popcount((bits[x / 32] >> (2 * (x % 32))) & 3);
+                            }
+                        } else {
+                            const f32 *fine_fractions =
+                                &fine.fractions[((Size)fine_z * fine_dimensions.y + fine_y) * fine_dimensions.x];
+                            for (u32 x = 0; x < dimensions.x; x++) {
+                                fractions[x] += fine_fractions[2 * x];
+                                fractions[x] += 2 * x + 1 < fine_dimensions.x ? fine_fractions[2 * x + 1] : 0.0f;
+                            }
+                        }
+                    }
+                }
+                for (u32 x = 0; x < dimensions.x; x++) {
+                    fractions[x] *= 0.125f;
+                    occupancy[x / 64] |= (u64)(fractions[x] > 0.0f) << (x % 64);
+                }
+            },
+            MIN_ROWS_PER_RANGE);
+        m_levels.push_back(std::move(coarse));
+    }
+}
+
+f32 VoxelPyramid::Fraction(u32 level, u32 x, u32 y, u32 z) const
+{
+    const Level &data = m_levels[level];
+    if (level == 0) {
+        return data.occupancy.Get(x, y, z) ? 1.0f : 0.0f;
+    }
+    const glm::uvec3 dimensions = data.occupancy.Dimensions();
+    return data.fractions[((Size)z * dimensions.y + y) * dimensions.x + x];
+}
+
+u32 VoxelPyramid::LevelForVoxelSize(f32 voxel_size) const
+{
+    u32 level = 0;
+    while (level + 1 < m_levels.size() && m_levels[level + 1].occupancy.VoxelSize() <= voxel_size) {
+        level++;
+    }
+    return level;
+}
+
+VoxelBody::VoxelBody(const Mesh &mesh, u32 resolution, SolidFillMode mode) : m_mode(mode)
+{
+    SetResolution(mesh, resolution);
+}
+
+VoxelBody::VoxelBody(VoxelGrid finest, u32 resolution, SolidFillMode mode)
+    : m_pyramid(std::move(finest)), m_mode(mode), m_finest_resolution(resolution), m_resolution(resolution)
+{
+}
+
+bool VoxelBody::SetResolution(const Mesh &mesh, u32 resolution)
+{
+    m_resolution = resolution;
+    if (m_pyramid.LevelCount() > 0 && resolution <= m_finest_resolution) {
+        m_level = 0;
+        while (m_level + 1 < m_pyramid.LevelCount()
+               && LevelResolution(m_finest_resolution, m_level + 1) >= resolution) {
+            m_level++;
+        }
+        return false;
+    }
+    VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+    VoxelizeSolid(mesh, grid, m_mode);
+    m_pyramid = VoxelPyramid(std::move(grid));
+    m_finest_resolution = resolution;
+    m_level = 0;
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "voxel_grid.hpp"
+#include "voxelizer.hpp"
+
+#include <span>
+#include <vector>
+
+// Occupancy and solid fraction at successively halved resolutions. Level 0 is the grid it was built from, every
+// voxel of level i + 1 covers 2x2x2 voxels of level i with the same origin, and the last level is a single voxel wide
+// along its longest axis.
+class VoxelPyramid
+{
+  public:
+    VoxelPyramid() = default;
+    explicit VoxelPyramid(VoxelGrid finest);
+
+    u32 LevelCount() const { return (u32)m_levels.size(); }
+    // A voxel is solid when any level 0 voxel below it is
+    const VoxelGrid &Occupancy(u32 level) const { return m_levels[level].occupancy; }
+    // Solid share of the level 0 voxels below each voxel, x fastest. Empty for level 0, which is all zeros and ones.
+    std::span<const f32> Fractions(u32 level) const { return m_levels[level].fractions; }
+    f32 Fraction(u32 level, u32 x, u32 y, u32 z) const;
+
+    // Coarsest level whose voxels are no larger than voxel_size, level 0 when even that is too coarse
+    u32 LevelForVoxelSize(f32 voxel_size) const;
+
+  private:
+    struct Level {
+        VoxelGrid occupancy;
+        std::vector<f32> fractions;
+    };
+
+    std::vector<Level> m_levels;
+};
+
+// A voxelized mesh at some resolution together with its pyramid. Asking for a coarser resolution picks a pyramid
+// level, only a finer one voxelizes the mesh again.
+class VoxelBody
+{
+  public:
+    VoxelBody() = default;
+    VoxelBody(const Mesh &mesh, u32 resolution, SolidFillMode mode = SolidFillMode::Parity);
+    // From a mesh voxelized at resolution already, e.g. the grid a body cache kept. Only the pyramid gets built.
+    VoxelBody(VoxelGrid finest, u32 resolution, SolidFillMode mode = SolidFillMode::Parity);
+
+    // Returns true when the mesh had to be voxelized again. Coarser resolutions snap to the coarsest level that is
+    // still at least resolution voxels across.
+    bool SetResolution(const Mesh &mesh, u32 resolution);
+
+    u32 Resolution() const { return m_resolution; }
+    u32 Level() const { return m_level; }
+    const VoxelGrid &Occupancy() const { return m_pyramid.Occupancy(m_level); }
+    const VoxelPyramid &Pyramid() const { return m_pyramid; }
+
+  private:
+    VoxelPyramid m_pyramid;
+    SolidFillMode m_mode = SolidFillMode::Parity;
+    // Resolution that level 0 was voxelized at and the one that was last asked for
+    u32 m_finest_resolution = 0;
+    u32 m_resolution = 0;
+    u32 m_level = 0;
+};
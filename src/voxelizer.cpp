@@ -0,0 +1,531 @@
+#include "voxelizer.hpp"
+
+#include "bvh.hpp"
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxel_pyramid.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr Size MIN_TRIANGLES_PER_RANGE = 1024;
+
+struct EdgeTest {
+    glm::vec2 normal;
+    f32 offset;
+};
+
+// Everything the per voxel overlap test needs, in grid space where voxels are unit cubes
+struct TriangleSetup {
+    glm::ivec3 min;
+    glm::ivec3 max;
+    glm::vec3 normal;
+    f32 plane_near;
+    f32 plane_far;
+    EdgeTest xy[3];
+    EdgeTest yz[3];
+    EdgeTest zx[3];
+};
+
+// Edge normal of the triangle's 2D projection, pointing inwards, with the offset moved to the box corner that is
+// furthest along it
+EdgeTest MakeEdgeTest(glm::vec2 edge, glm::vec2 start, f32 orientation)
+{
+    const glm::vec2 normal = glm::vec2(-edge.y, edge.x) * orientation;
+    return {normal, -glm::dot(normal, start) + std::max(0.0f, normal.x) + std::max(0.0f, normal.y)};
+}
+
+bool PassesEdgeTests(const EdgeTest (&tests)[3], glm::vec2 point)
+{
+    return glm::dot(tests[0].normal, point) + tests[0].offset >= 0.0f
+           && glm::dot(tests[1].normal, point) + tests[1].offset >= 0.0f
+           && glm::dot(tests[2].normal, point) + tests[2].offset >= 0.0f;
+}
+
+bool SetupTriangle(const glm::vec3 (&v)[3], glm::uvec3 dimensions, TriangleSetup &setup)
+{
+    const glm::vec3 edges[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+    setup.normal = glm::cross(edges[0], edges[1]);
+    if (setup.normal == glm::vec3(0.0f)) {
+        return false;
+    }
+    const glm::vec3 lower = glm::min(v[0], glm::min(v[1], v[2]));
+    const glm::vec3 upper = glm::max(v[0], glm::max(v[1], v[2]));
+    for (u32 axis = 0; axis < 3; axis++) {
+        setup.min[axis] = std::max(0, (s32)std::floor(lower[axis]));
+        setup.max[axis] = std::min((s32)dimensions[axis] - 1, (s32)std::floor(upper[axis]));
+        if (setup.min[axis] > setup.max[axis]) {
+            return false;
+        }
+    }
+
+    // The box corners closest to and furthest from the plane along its normal
+    const glm::vec3 critical = {
+        setup.normal.x > 0.0f ? 1.0f : 0.0f, setup.normal.y > 0.0f ? 1.0f : 0.0f, setup.normal.z > 0.0f ? 1.0f : 0.0f};
+    setup.plane_near = glm::dot(setup.normal, critical - v[0]);
+    setup.plane_far = glm::dot(setup.normal, glm::vec3(1.0f) - critical - v[0]);
+
+    const f32 xy_orientation = setup.normal.z >= 0.0f ? 1.0f : -1.0f;
+    const f32 yz_orientation = setup.normal.x >= 0.0f ? 1.0f : -1.0f;
+    const f32 zx_orientation = setup.normal.y >= 0.0f ? 1.0f : -1.0f;
+    for (u32 i = 0; i < 3; i++) {
+        setup.xy[i] = MakeEdgeTest({edges[i].x, edges[i].y}, {v[i].x, v[i].y}, xy_orientation);
+        setup.yz[i] = MakeEdgeTest({edges[i].y, edges[i].z}, {v[i].y, v[i].z}, yz_orientation);
+        setup.zx[i] = MakeEdgeTest({edges[i].z, edges[i].x}, {v[i].z, v[i].x}, zx_orientation);
+    }
+    return true;
+}
+
+template<typename SetVoxel>
+void RasterizeSlice(const TriangleSetup &setup, u32 z, SetVoxel &&set_voxel)
+{
+    const f32 fz = (f32)z;
+    for (s32 y = setup.min.y; y <= setup.max.y; y++) {
+        const f32 fy = (f32)y;
+        if (!PassesEdgeTests(setup.yz, {fy, fz})) {
+            continue;
+        }
+        for (s32 x = setup.min.x; x <= setup.max.x; x++) {
+            const glm::vec3 corner = {(f32)x, fy, fz};
+            const f32 distance = glm::dot(setup.normal, corner);
+            if ((distance + setup.plane_near) * (distance + setup.plane_far) > 0.0f) {
+                continue;
+            }
+            if (PassesEdgeTests(setup.xy, {corner.x, fy}) && PassesEdgeTests(setup.zx, {fz, corner.x})) {
+                set_voxel((u32)x, (u32)y, z);
+            }
+        }
+    }
+}
+
+struct SurfaceBins {
+    std::vector<TriangleSetup> setups;
+    std::vector<u8> valid;
+    // Triangles touching each z slice
+    std::vector<u32> slice_offsets;
+    std::vector<u32> slice_triangles;
+};
+
+template<typename Grid>
+SurfaceBins BinTriangles(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, const Grid &grid)
+{
+    const Size triangle_count = indices.size() / 3;
+    const glm::uvec3 dimensions = grid.Dimensions();
+    SurfaceBins bins;
+    bins.setups.resize(triangle_count);
+    bins.valid.resize(triangle_count);
+    ParallelFor(
+        triangle_count,
+        [&](Size triangle) {
+            const glm::vec3 v[3] = {grid.ToGridSpace(vertices[indices[triangle * 3]].position),
+                grid.ToGridSpace(vertices[indices[triangle * 3 + 1]].position),
+                grid.ToGridSpace(vertices[indices[triangle * 3 + 2]].position)};
+            bins.valid[triangle] = SetupTriangle(v, dimensions, bins.setups[triangle]);
+        },
+        MIN_TRIANGLES_PER_RANGE);
+
+    // Counting sort of triangles into every z slice they touch
+    bins.slice_offsets.assign(dimensions.z + 1, 0);
+    for (Size triangle = 0; triangle < triangle_count; triangle++) {
+        if (bins.valid[triangle]) {
+            for (s32 z = bins.setups[triangle].min.z; z <= bins.setups[triangle].max.z; z++) {
+                bins.slice_offsets[z + 1]++;
+            }
+        }
+    }
+    for (u32 z = 0; z < dimensions.z; z++) {
+        bins.slice_offsets[z + 1] += bins.slice_offsets[z];
+    }
+    bins.slice_triangles.resize(bins.slice_offsets.back());
+    std::vector<u32> cursors(bins.slice_offsets.begin(), bins.slice_offsets.end() - 1);
+    for (Size triangle = 0; triangle < triangle_count; triangle++) {
+        if (bins.valid[triangle]) {
+            for (s32 z = bins.setups[triangle].min.z; z <= bins.setups[triangle].max.z; z++) {
+                bins.slice_triangles[cursors[z]++] = (u32)triangle;
+            }
+        }
+    }
+    return bins;
+}
+
+// Projection of a triangle onto the plane perpendicular to the ray axis, wound counter clockwise
+struct RayTriangle {
+    glm::vec2 v[3];
+    // Ray axis coordinate of the plane as a function of the other two
+    glm::vec3 plane;
+    glm::ivec2 min;
+    glm::ivec2 max;
+};
+
+// Half-open edge rule: a ray through a shared edge or vertex is claimed by exactly one of the triangles on either side,
+// while at a silhouette both or neither claim it, which leaves the parity alone
+bool CoversPoint(const RayTriangle &triangle, glm::vec2 point)
+{
+    for (u32 i = 0; i < 3; i++) {
+        const glm::vec2 a = triangle.v[i];
+        const glm::vec2 edge = triangle.v[(i + 1) % 3] - a;
+        const f32 side = edge.x * (point.y - a.y) - edge.y * (point.x - a.x);
+        if (side < 0.0f || (side == 0.0f && !(edge.y < 0.0f || (edge.y == 0.0f && edge.x > 0.0f)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Ray centers covered by [lower, upper], which might be an empty range
+glm::ivec2 CenterRange(f32 lower, f32 upper, u32 dimension)
+{
+    return {std::max(0, (s32)std::ceil(lower - 0.5f)), std::min((s32)dimension - 1, (s32)std::floor(upper - 0.5f))};
+}
+
+bool SetupRayTriangle(const glm::vec3 (&v)[3], u32 axis, glm::uvec3 dimensions, RayTriangle &out)
+{
+    const u32 u = (axis + 1) % 3;
+    const u32 w = (axis + 2) % 3;
+    for (u32 i = 0; i < 3; i++) {
+        out.v[i] = {v[i][u], v[i][w]};
+    }
+    const f32 area = (out.v[1].x - out.v[0].x) * (out.v[2].y - out.v[0].y)
+                     - (out.v[1].y - out.v[0].y) * (out.v[2].x - out.v[0].x);
+    if (area == 0.0f) {
+        return false;
+    }
+    if (area < 0.0f) {
+        std::swap(out.v[1], out.v[2]);
+    }
+    const glm::vec3 normal = glm::cross(v[1] - v[0], v[2] - v[0]);
+    out.plane = {-normal[u] / normal[axis], -normal[w] / normal[axis],
+        v[0][axis] + (normal[u] * v[0][u] + normal[w] * v[0][w]) / normal[axis]};
+
+    const glm::vec2 lower = glm::min(out.v[0], glm::min(out.v[1], out.v[2]));
+    const glm::vec2 upper = glm::max(out.v[0], glm::max(out.v[1], out.v[2]));
+    const glm::ivec2 u_range = CenterRange(lower.x, upper.x, dimensions[u]);
+    const glm::ivec2 w_range = CenterRange(lower.y, upper.y, dimensions[w]);
+    out.min = {u_range.x, w_range.x};
+    out.max = {u_range.y, w_range.y};
+    return out.min.x <= out.max.x && out.min.y <= out.max.y;
+}
+
+u64 PrefixXor(u64 word)
+{
+    word ^= word << 1;
+    word ^= word << 2;
+    word ^= word << 4;
+    word ^= word << 8;
+    word ^= word << 16;
+    word ^= word << 32;
+    return word;
+}
+
+// Solid occupancy from rays along one axis, written into `out` which has the same layout as the target grid
+void FillAlongAxis(std::span<const glm::vec3> positions, std::span<const u32> indices, u32 axis, VoxelGrid &out)
+{
+    const glm::uvec3 dimensions = out.Dimensions();
+    const u32 u = (axis + 1) % 3;
+    const u32 w = (axis + 2) % 3;
+    // Threads own slabs of whole rows: rays along x or y write rows of a single z, rays along z rows of a single y
+    const u32 slab_axis = axis == 2 ? 1 : 2;
+    // Which of the two projected coordinates the slab axis is
+    const u32 slab_component = slab_axis == u ? 0 : 1;
+
+    const Size triangle_count = indices.size() / 3;
+    std::vector<RayTriangle> triangles(triangle_count);
+    std::vector<u8> valid(triangle_count);
+    ParallelFor(
+        triangle_count,
+        [&](Size triangle) {
+            const glm::vec3 v[3] = {positions[indices[triangle * 3]], positions[indices[triangle * 3 + 1]],
+                positions[indices[triangle * 3 + 2]]};
+            valid[triangle] = SetupRayTriangle(v, axis, dimensions, triangles[triangle]);
+        },
+        MIN_TRIANGLES_PER_RANGE);
+
+    std::vector<u32> slab_offsets(dimensions[slab_axis] + 1, 0);
+    for (Size triangle = 0; triangle < triangle_count; triangle++) {
+        if (valid[triangle]) {
+            for (s32 s = triangles[triangle].min[slab_component]; s <= triangles[triangle].max[slab_component]; s++) {
+                slab_offsets[s + 1]++;
+            }
+        }
+    }
+    for (u32 s = 0; s < dimensions[slab_axis]; s++) {
+        slab_offsets[s + 1] += slab_offsets[s];
+    }
+    std::vector<u32> slab_triangles(slab_offsets.back());
+    std::vector<u32> cursors(slab_offsets.begin(), slab_offsets.end() - 1);
+    for (Size triangle = 0; triangle < triangle_count; triangle++) {
+        if (valid[triangle]) {
+            for (s32 s = triangles[triangle].min[slab_component]; s <= triangles[triangle].max[slab_component]; s++) {
+                slab_triangles[cursors[s]++] = (u32)triangle;
+            }
+        }
+    }
+
+    ParallelFor(dimensions[slab_axis], [&](Size slab) {
+        // Toggle the first voxel whose center lies past each crossing
+        for (u32 i = slab_offsets[slab]; i < slab_offsets[slab + 1]; i++) {
+            const RayTriangle &triangle = triangles[slab_triangles[i]];
+            const u32 other_component = 1 - slab_component;
+            for (s32 other = triangle.min[other_component]; other <= triangle.max[other_component]; other++) {
+                glm::ivec2 ray;
+                ray[slab_component] = (s32)slab;
+                ray[other_component] = other;
+                const glm::vec2 center = glm::vec2(ray) + 0.5f;
+                if (!CoversPoint(triangle, center)) {
+                    continue;
+                }
+                const f32 hit = triangle.plane.x * center.x + triangle.plane.y * center.y + triangle.plane.z;
+                const s32 first_inside = std::max(0, (s32)std::floor(hit - 0.5f) + 1);
+                if (first_inside >= (s32)dimensions[axis]) {
+                    continue;
+                }
+                glm::uvec3 voxel;
+                voxel[axis] = (u32)first_inside;
+                voxel[u] = (u32)ray.x;
+                voxel[w] = (u32)ray.y;
+                out.Row(voxel.y, voxel.z)[voxel.x / 64] ^= 1ull << (voxel.x % 64);
+            }
+        }
+
+        // Parity prefix along the ray axis
+        if (axis == 0) {
+            const u64 last_word_mask = out.LastWordMask();
+            for (u32 y = 0; y < dimensions.y; y++) {
+                auto row = out.Row(y, (u32)slab);
+                u64 carry = 0;
+                for (u64 &word : row) {
+                    word = PrefixXor(word) ^ carry;
+                    carry = (u64)((s64)word >> 63);
+                }
+                row.back() &= last_word_mask;
+            }
+        } else if (axis == 1) {
+            for (u32 y = 1; y < dimensions.y; y++) {
+                const auto previous = out.Row(y - 1, (u32)slab);
+                auto row = out.Row(y, (u32)slab);
+                for (u32 word = 0; word < row.size(); word++) {
+                    row[word] ^= previous[word];
+                }
+            }
+        } else {
+            for (u32 z = 1; z < dimensions.z; z++) {
+                const auto previous = out.Row((u32)slab, z - 1);
+                auto row = out.Row((u32)slab, z);
+                for (u32 word = 0; word < row.size(); word++) {
+                    row[word] ^= previous[word];
+                }
+            }
+        }
+    });
+}
+
+// Longest run of empty voxels that shares one winding number evaluation. Without surface in between the field is
+// smooth, but near holes it does drift from 1 to 0 over a few voxels.
+constexpr u32 MAX_WINDING_RUN = 32;
+
+void FillByWindingNumber(
+    std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, f32 accuracy, VoxelGrid &grid)
+{
+    const TriangleBvh bvh(vertices, indices);
+    const FastWindingNumber winding(bvh);
+    VoxelGrid surface(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    VoxelizeSurface(vertices, indices, surface);
+
+    const glm::uvec3 dimensions = grid.Dimensions();
+    ParallelFor((Size)dimensions.y * dimensions.z, [&](Size row_index) {
+        const u32 y = (u32)(row_index % dimensions.y);
+        const u32 z = (u32)(row_index / dimensions.y);
+        const auto surface_row = surface.Row(y, z);
+        auto row = grid.Row(y, z);
+        const auto is_surface = [&](u32 x) { return (surface_row[x / 64] >> (x % 64)) & 1; };
+        for (u32 x = 0; x < dimensions.x;) {
+            u32 end = x + 1;
+            if (!is_surface(x)) {
+                while (end < dimensions.x && end - x < MAX_WINDING_RUN && !is_surface(end)) {
+                    end++;
+                }
+            }
+            // Inverted meshes wind to -1, count those as inside too
+            if (std::abs(winding.Evaluate(grid.VoxelCenter((x + end - 1) / 2, y, z), accuracy)) > 0.5f) {
+                for (u32 inside = x; inside < end; inside++) {
+                    row[inside / 64] |= 1ull << (inside % 64);
+                }
+            }
+            x = end;
+        }
+    });
+}
+
+} // namespace
+
+void VoxelizeSurface(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, VoxelGrid &grid)
+{
+    const SurfaceBins bins = BinTriangles(vertices, indices, grid);
+    ParallelFor(grid.Dimensions().z, [&](Size z) {
+        for (u32 i = bins.slice_offsets[z]; i < bins.slice_offsets[z + 1]; i++) {
+            RasterizeSlice(bins.setups[bins.slice_triangles[i]], (u32)z, [&](u32 x, u32 y, u32 z) {
+                grid.Row(y, z)[x / 64] |= 1ull << (x % 64);
+            });
+        }
+    });
+}
+
+void VoxelizeSurface(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, SparseVoxelGrid &grid)
+{
+    const SurfaceBins bins = BinTriangles(vertices, indices, grid);
+    // Upper bound on the bricks touched, so the insertions below never have to grow the table
+    const glm::uvec3 brick_dimensions = grid.BrickDimensions();
+    Size brick_bound = 0;
+    for (Size triangle = 0; triangle < bins.setups.size(); triangle++) {
+        if (bins.valid[triangle]) {
+            const glm::ivec3 bricks =
+                bins.setups[triangle].max / (s32)BRICK_SIZE - bins.setups[triangle].min / (s32)BRICK_SIZE + 1;
+            brick_bound += (Size)bricks.x * bricks.y * bricks.z;
+        }
+    }
+    grid.Reserve(std::min(brick_bound, (Size)brick_dimensions.x * brick_dimensions.y * brick_dimensions.z));
+
+    // Bricks are 8 slices deep, so neighbouring slices share them and the bits have to be set atomically
+    ParallelFor(grid.Dimensions().z, [&](Size z) {
+        for (u32 i = bins.slice_offsets[z]; i < bins.slice_offsets[z + 1]; i++) {
+            RasterizeSlice(bins.setups[bins.slice_triangles[i]], (u32)z,
+                [&](u32 x, u32 y, u32 z) { grid.SetAtomic(x, y, z); });
+        }
+    });
+    grid.ShrinkToFit();
+}
+
+void VoxelizeSurface(const Mesh &mesh, VoxelGrid &grid)
+{
+    VoxelizeSurface(mesh.vertices, mesh.indices, grid);
+}
+
+void VoxelizeSurface(const Mesh &mesh, SparseVoxelGrid &grid)
+{
+    VoxelizeSurface(mesh.vertices, mesh.indices, grid);
+}
+
+void VoxelizeSolid(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, VoxelGrid &grid,
+    SolidFillMode mode, f32 winding_accuracy)
+{
+    if (mode == SolidFillMode::WindingNumber) {
+        FillByWindingNumber(vertices, indices, winding_accuracy, grid);
+        return;
+    }
+
+    std::vector<glm::vec3> positions(vertices.size());
+    ParallelFor(
+        vertices.size(), [&](Size vertex) { positions[vertex] = grid.ToGridSpace(vertices[vertex].position); },
+        MIN_TRIANGLES_PER_RANGE);
+
+    VoxelGrid along_x(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    FillAlongAxis(positions, indices, 0, along_x);
+    auto words = grid.Words();
+    const auto x_words = along_x.Words();
+    if (mode == SolidFillMode::Parity) {
+        for (Size word = 0; word < words.size(); word++) {
+            words[word] |= x_words[word];
+        }
+        return;
+    }
+
+    VoxelGrid along_y(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    VoxelGrid along_z(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+    FillAlongAxis(positions, indices, 1, along_y);
+    FillAlongAxis(positions, indices, 2, along_z);
+    const auto y_words = along_y.Words();
+    const auto z_words = along_z.Words();
+    ParallelFor(
+        words.size(),
+        [&](Size word) {
+            const u64 x = x_words[word];
+            const u64 y = y_words[word];
+            const u64 z = z_words[word];
+            words[word] |= (x & y) | (y & z) | (x & z);
+        },
+        MIN_TRIANGLES_PER_RANGE);
+}
+
+void VoxelizeSolid(const Mesh &mesh, VoxelGrid &grid, SolidFillMode mode, f32 winding_accuracy)
+{
+    VoxelizeSolid(mesh.vertices, mesh.indices, grid, mode, winding_accuracy);
+}
+
+void BenchmarkVoxelizer(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto best_of = [&](VoxelGrid &grid, auto &&voxelize) {
+        f64 best = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            grid.Clear();
+            const auto start = Clock::now();
+            voxelize();
+            best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    };
+
+    printf("%-24s %16s %12s %12s %12s %12s %12s %12s %12s %12s %12s %12s %12s %12s\n", "file", "grid", "surface",
+        "surface ms", "parity", "parity ms", "pyramid ms", "majority", "majority ms", "winding", "winding ms",
+        "sparse ms", "dense KB", "sparse KB");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+        const f64 surface_ms = best_of(grid, [&]() { VoxelizeSurface(mesh, grid); });
+        const Size surface_count = grid.CountSolid();
+        f64 sparse_ms = std::numeric_limits<f64>::max();
+        Size sparse_bytes = 0;
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            SparseVoxelGrid sparse(grid.Dimensions(), grid.Origin(), grid.VoxelSize());
+            const auto start = Clock::now();
+            VoxelizeSurface(mesh, sparse);
+            sparse_ms = std::min(sparse_ms, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+            sparse_bytes = sparse.MemoryUsage();
+            if (CountSolid(sparse) != surface_count) {
+                printf("    sparse voxel count mismatch: dense %zu, sparse %zu\n", surface_count, CountSolid(sparse));
+            }
+        }
+        const f64 parity_ms = best_of(grid, [&]() { VoxelizeSolid(mesh, grid, SolidFillMode::Parity); });
+        const Size parity_count = grid.CountSolid();
+        f64 pyramid_ms = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            VoxelGrid finest = grid;
+            const auto start = Clock::now();
+            const VoxelPyramid pyramid(std::move(finest));
+            pyramid_ms = std::min(pyramid_ms, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        const f64 majority_ms = best_of(grid, [&]() { VoxelizeSolid(mesh, grid, SolidFillMode::MajorityVote); });
+        const Size majority_count = grid.CountSolid();
+        const f64 winding_ms = best_of(grid, [&]() { VoxelizeSolid(mesh, grid, SolidFillMode::WindingNumber); });
+        const Size winding_count = grid.CountSolid();
+        const glm::uvec3 dimensions = grid.Dimensions();
+        const std::string grid_size = std::to_string(dimensions.x) + "x" + std::to_string(dimensions.y) + "x"
+                                      + std::to_string(dimensions.z);
+        printf("%-24s %16s %12zu %12.3f %12zu %12.3f %12.3f %12zu %12.3f %12zu %12.3f %12.3f %12zu %12zu\n",
+            path.filename().string().c_str(), grid_size.c_str(), surface_count, surface_ms, parity_count, parity_ms,
+            pyramid_ms, majority_count, majority_ms, winding_count, winding_ms, sparse_ms,
+            grid.Words().size_bytes() / 1024, sparse_bytes / 1024);
+    }
+}
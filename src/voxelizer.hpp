@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+#include "components.hpp"
+#include "sparse_voxel_grid.hpp"
+#include "voxel_grid.hpp"
+#include "winding_number.hpp"
+
+#include <span>
+
+// Conservative surface voxelization: sets every voxel whose box overlaps a triangle, using the separating axis test
+// factored into a plane test and three 2D edge tests (Schwarz and Seidel 2010). Triangles are binned by z slice and
+// threads take whole slices, so no two threads write the same row and no atomics are needed. Bits already set in the
+// grid are kept.
+void VoxelizeSurface(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, VoxelGrid &grid);
+void VoxelizeSurface(const Mesh &mesh, VoxelGrid &grid);
+// Same test into a brick map, bricks are inserted from all threads at once
+void VoxelizeSurface(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, SparseVoxelGrid &grid);
+void VoxelizeSurface(const Mesh &mesh, SparseVoxelGrid &grid);
+
+enum class SolidFillMode {
+    // Rays along x toggle occupancy at every crossing, exact for watertight meshes
+    Parity,
+    // Parity along x, y and z, voxels are solid where at least two axes agree. Holes only streak along one axis, so
+    // this cleans up meshes that are not quite closed.
+    MajorityVote,
+    // Generalized winding number above 0.5 in magnitude at the voxel center, see FastWindingNumber. Slower, but holes
+    // and self intersections don't leave streaks.
+    WindingNumber,
+};
+
+// Solid voxelization by voxel center: a voxel is set when its center is inside the mesh. For the parity modes crossings
+// are XORed into bit rows and then turned into occupancy with XOR prefix scans, inside words for rays along x and
+// across whole rows for rays along y and z. The winding number is only evaluated at surface voxels and once per short
+// run of empty voxels between them, since it can't jump inside a run. winding_accuracy is passed on to
+// FastWindingNumber::Evaluate. OR the result with VoxelizeSurface for a conservative solid.
+void VoxelizeSolid(std::span<const Mesh::Vertex> vertices, std::span<const u32> indices, VoxelGrid &grid,
+    SolidFillMode mode = SolidFillMode::Parity, f32 winding_accuracy = DEFAULT_WINDING_ACCURACY);
+void VoxelizeSolid(const Mesh &mesh, VoxelGrid &grid, SolidFillMode mode = SolidFillMode::Parity,
+    f32 winding_accuracy = DEFAULT_WINDING_ACCURACY);
+
+// Best of a few runs for every OBJ in directory, at `resolution` voxels along the longest axis
+void BenchmarkVoxelizer(const char *directory, u32 resolution);
@@ -0,0 +1,100 @@
+#include "winding_number.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <numbers>
+
+namespace
+{
+
+constexpr f32 INV_FOUR_PI = 0.25f * std::numbers::inv_pi_v<f32>;
+
+// Van Oosterom and Strackee's formula for the signed solid angle of a triangle seen from the origin
+f32 SolidAngle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    const f32 la = glm::length(a);
+    const f32 lb = glm::length(b);
+    const f32 lc = glm::length(c);
+    const f32 numerator = glm::dot(a, glm::cross(b, c));
+    const f32 denominator = la * lb * lc + glm::dot(a, b) * lc + glm::dot(b, c) * la + glm::dot(c, a) * lb;
+    return 2.0f * std::atan2(numerator, denominator);
+}
+
+} // namespace
+
+FastWindingNumber::FastWindingNumber(const TriangleBvh &bvh) : m_bvh(bvh)
+{
+    const auto nodes = bvh.Nodes();
+    const auto triangles = bvh.Triangles();
+    m_expansions.resize(nodes.size());
+    // Children always come after their parent, so walking backwards finishes them first
+    for (Size i = nodes.size(); i-- > 0;) {
+        const BvhNode &node = nodes[i];
+        NodeExpansion &expansion = m_expansions[i];
+        expansion = {};
+        if (node.count > 0) {
+            glm::vec3 weighted_center(0.0f);
+            for (u32 t = node.first; t < node.first + node.count; t++) {
+                const BvhTriangle &triangle = triangles[t];
+                const glm::vec3 normal =
+                    0.5f * glm::cross(triangle.v[1] - triangle.v[0], triangle.v[2] - triangle.v[0]);
+                const f32 area = glm::length(normal);
+                expansion.normal_sum += normal;
+                expansion.area += area;
+                weighted_center += area * (triangle.v[0] + triangle.v[1] + triangle.v[2]) / 3.0f;
+            }
+            expansion.center = expansion.area > 0.0f ? weighted_center / expansion.area : 0.5f * (node.min + node.max);
+            for (u32 t = node.first; t < node.first + node.count; t++) {
+                for (const glm::vec3 &corner : triangles[t].v) {
+                    expansion.radius = std::max(expansion.radius, glm::length(corner - expansion.center));
+                }
+            }
+        } else {
+            const NodeExpansion &left = m_expansions[node.first];
+            const NodeExpansion &right = m_expansions[node.first + 1];
+            expansion.normal_sum = left.normal_sum + right.normal_sum;
+            expansion.area = left.area + right.area;
+            expansion.center = expansion.area > 0.0f
+                                   ? (left.center * left.area + right.center * right.area) / expansion.area
+                                   : 0.5f * (node.min + node.max);
+            expansion.radius = std::max(glm::length(left.center - expansion.center) + left.radius,
+                glm::length(right.center - expansion.center) + right.radius);
+        }
+    }
+}
+
+f32 FastWindingNumber::Evaluate(const glm::vec3 &point, f32 accuracy) const
+{
+    if (m_bvh.IsEmpty()) {
+        return 0.0f;
+    }
+    const auto nodes = m_bvh.Nodes();
+    const auto triangles = m_bvh.Triangles();
+    f32 solid_angle = 0.0f;
+    // Depth first with both children pushed, so the stack never holds more than depth + 1 nodes
+    u32 stack[64];
+    u32 stack_size = 0;
+    stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const u32 index = stack[--stack_size];
+        const BvhNode &node = nodes[index];
+        const NodeExpansion &expansion = m_expansions[index];
+        const glm::vec3 offset = expansion.center - point;
+        const f32 distance = glm::length(offset);
+        if (distance > accuracy * expansion.radius) {
+            solid_angle += glm::dot(offset, expansion.normal_sum) / (distance * distance * distance);
+            continue;
+        }
+        if (node.count > 0) {
+            for (u32 t = node.first; t < node.first + node.count; t++) {
+                const BvhTriangle &triangle = triangles[t];
+                solid_angle += SolidAngle(triangle.v[0] - point, triangle.v[1] - point, triangle.v[2] - point);
+            }
+            continue;
+        }
+        stack[stack_size++] = node.first;
+        stack[stack_size++] = node.first + 1;
+    }
+    return solid_angle * INV_FOUR_PI;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "bvh.hpp"
+#include "common.h"
+
+#include <glm/vec3.hpp>
+#include <vector>
+
+// Barill et al. 2018 fast winding numbers is the default accuracy they recommend
+constexpr f32 DEFAULT_WINDING_ACCURACY = 2.0f;
+
+// Generalized winding number of a triangle soup (Jacobson et al. 2013), close to 1 inside and 0 outside even when the
+// mesh has holes or overlapping parts. Far away BVH nodes are replaced by the dipole of their area weighted normals
+// (Barill et al. 2018), nearby triangles use the exact solid angle.
+class FastWindingNumber
+{
+  public:
+    // Keeps a reference to bvh
+    explicit FastWindingNumber(const TriangleBvh &bvh);
+
+    // Nodes further than accuracy times their radius from point use the dipole. Larger values are slower and closer
+    // to the exact sum over all triangles.
+    f32 Evaluate(const glm::vec3 &point, f32 accuracy = DEFAULT_WINDING_ACCURACY) const;
+
+  private:
+    struct NodeExpansion {
+        glm::vec3 center;
+        f32 radius;
+        // Sum of the area weighted triangle normals below the node
+        glm::vec3 normal_sum;
+        f32 area;
+    };
+
+    const TriangleBvh &m_bvh;
+    std::vector<NodeExpansion> m_expansions;
+};
@@ -0,0 +1,353 @@
+#include "z_order.hpp"
+
+#include "mesh_processing.hpp"
+#include "obj_loader.hpp"
+#include "parallel.hpp"
+#include "voxelizer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+
+constexpr u32 RADIX_BITS = 11;
+constexpr u32 RADIX_SIZE = 1u << RADIX_BITS;
+constexpr Size MIN_ROWS_PER_RANGE = 64;
+constexpr Size MIN_PARTICLES_PER_RANGE = 4096;
+
+// Least significant digit first radix sort over only the bits some code uses, values are moved along when given
+void RadixSort(std::vector<u64> &codes, std::vector<u32> *values)
+{
+    u64 used = 0;
+    for (u64 code : codes) {
+        used |= code;
+    }
+    const u32 bits = 64 - (u32)std::countl_zero(used);
+    std::vector<u64> code_buffer(codes.size());
+    std::vector<u32> value_buffer(values ? values->size() : 0);
+    std::vector<Size> offsets(RADIX_SIZE);
+    for (u32 shift = 0; shift < bits; shift += RADIX_BITS) {
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (u64 code : codes) {
+            offsets[(code >> shift) & (RADIX_SIZE - 1)]++;
+        }
+        std::exclusive_scan(offsets.begin(), offsets.end(), offsets.begin(), (Size)0);
+        for (Size i = 0; i < codes.size(); i++) {
+            const Size target = offsets[(codes[i] >> shift) & (RADIX_SIZE - 1)]++;
+            code_buffer[target] = codes[i];
+            if (values) {
+                value_buffer[target] = (*values)[i];
+            }
+        }
+        codes.swap(code_buffer);
+        if (values) {
+            values->swap(value_buffer);
+        }
+    }
+}
+
+// Face neighbours of every particle, NO_VOXEL where there is none
+struct ParticleSet {
+    std::vector<glm::vec3> positions;
+    std::vector<u32> neighbors;
+};
+
+// Replaces every particle with the average of itself and its face neighbours, the memory access pattern of a
+// constraint projection pass without the constraint math
+void SmoothParticles(std::span<const u32> neighbors, std::span<const glm::vec3> positions, std::span<glm::vec3> out)
+{
+    ParallelForRanges(
+        positions.size(),
+        [&](Size begin, Size end, u32) {
+            for (Size i = begin; i < end; i++) {
+                glm::vec3 sum = positions[i];
+                f32 count = 1.0f;
+                for (u32 k = 0; k < 6; k++) {
+                    const u32 neighbor = neighbors[i * 6 + k];
+                    if (neighbor != ZOrderVoxels::NO_VOXEL) {
+                        sum += positions[neighbor];
+                        count += 1.0f;
+                    }
+                }
+                out[i] = sum / count;
+            }
+        },
+        MIN_PARTICLES_PER_RANGE);
+}
+
+// Misses of a 512 KB, 8 way LRU cache over the position reads of one sweep. Counts locality directly, the timings
+// also include whatever the hardware prefetcher hides, which favours the long sequential runs of a row major order.
+f64 SimulatedMissesPerParticle(const ParticleSet &particles)
+{
+    constexpr Size LINE_SIZE = 64;
+    constexpr u32 WAYS = 8;
+    constexpr Size SETS = 1024;
+    std::vector<u64> lines(SETS * WAYS, ~0ull);
+    Size misses = 0;
+    const auto access = [&](Size particle) {
+        const u64 line = particle * sizeof(glm::vec3) / LINE_SIZE;
+        u64 *set = &lines[(line % SETS) * WAYS];
+        // Ways are kept most recently used first
+        u32 way = 0;
+        while (way < WAYS && set[way] != line) {
+            way++;
+        }
+        if (way == WAYS) {
+            misses++;
+            way = WAYS - 1;
+        }
+        for (; way > 0; way--) {
+            set[way] = set[way - 1];
+        }
+        set[0] = line;
+    };
+    for (Size i = 0; i < particles.positions.size(); i++) {
+        access(i);
+        for (u32 k = 0; k < 6; k++) {
+            if (particles.neighbors[i * 6 + k] != ZOrderVoxels::NO_VOXEL) {
+                access(particles.neighbors[i * 6 + k]);
+            }
+        }
+    }
+    return particles.positions.empty() ? 0.0 : (f64)misses / (f64)particles.positions.size();
+}
+
+} // namespace
+
+ZOrderVoxels::ZOrderVoxels(const VoxelGrid &grid)
+{
+    const glm::uvec3 dimensions = grid.Dimensions();
+    const Size row_count = (Size)dimensions.y * dimensions.z;
+    std::vector<Size> row_offsets(row_count + 1, 0);
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            for (u64 word : grid.Row((u32)(row % dimensions.y), (u32)(row / dimensions.y))) {
+                row_offsets[row + 1] += std::popcount(word);
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    std::inclusive_scan(row_offsets.begin(), row_offsets.end(), row_offsets.begin());
+
+    m_codes.resize(row_offsets.back());
+    ParallelFor(
+        row_count,
+        [&](Size row) {
+            const u32 y = (u32)(row % dimensions.y);
+            const u32 z = (u32)(row / dimensions.y);
+            const auto words = grid.Row(y, z);
+            Size next = row_offsets[row];
+            for (u32 word = 0; word < words.size(); word++) {
+                for (u64 bits = words[word]; bits != 0; bits &= bits - 1) {
+                    m_codes[next++] = MortonEncode(word * 64 + (u32)std::countr_zero(bits), y, z);
+                }
+            }
+        },
+        MIN_ROWS_PER_RANGE);
+    RadixSort(m_codes, nullptr);
+}
+
+u32 ZOrderVoxels::Find(u64 code, u32 hint) const
+{
+    if (m_codes.empty()) {
+        return NO_VOXEL;
+    }
+    // Gallop away from the hint until the code is bracketed, then binary search the bracket
+    Size low = std::min<Size>(hint, m_codes.size() - 1);
+    Size high = low + 1;
+    if (m_codes[low] < code) {
+        Size step = 1;
+        while (high < m_codes.size() && m_codes[high] < code) {
+            low = high;
+            high = std::min(high + step, m_codes.size());
+            step *= 2;
+        }
+        high = std::min(high + 1, m_codes.size());
+    } else {
+        Size step = 1;
+        while (low > 0 && m_codes[low] > code) {
+            high = low + 1;
+            low = low > step ? low - step : 0;
+            step *= 2;
+        }
+    }
+    const auto found = std::lower_bound(m_codes.begin() + low, m_codes.begin() + high, code);
+    return found != m_codes.begin() + high && *found == code ? (u32)(found - m_codes.begin()) : NO_VOXEL;
+}
+
+u32 ZOrderVoxels::Neighbor(u32 index, u32 axis, s32 direction) const
+{
+    // Stepping below zero wraps to 2^21 - 1 and past the top wraps to zero, neither is ever a voxel of a real grid
+    const u64 code = direction > 0 ? MortonIncrement(m_codes[index], axis) : MortonDecrement(m_codes[index], axis);
+    return Find(code, index);
+}
+
+std::vector<u32> ZOrderPermutation(std::span<const glm::uvec3> coordinates)
+{
+    std::vector<u64> codes(coordinates.size());
+    ParallelFor(
+        coordinates.size(),
+        [&](Size i) { codes[i] = MortonEncode(coordinates[i].x, coordinates[i].y, coordinates[i].z); },
+        MIN_PARTICLES_PER_RANGE);
+    std::vector<u32> order(coordinates.size());
+    std::iota(order.begin(), order.end(), 0);
+    RadixSort(codes, &order);
+    return order;
+}
+
+void BenchmarkZOrder(const char *directory, u32 resolution)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr u32 ITERATIONS = 5;
+    constexpr u32 SWEEPS = 4;
+
+    std::vector<std::filesystem::path> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.path().extension() == ".obj") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    const auto best_of = [&](auto &&run) {
+        f64 best = std::numeric_limits<f64>::max();
+        for (u32 i = 0; i < ITERATIONS; i++) {
+            const auto start = Clock::now();
+            run();
+            best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    };
+
+    // Encoding cost on its own, keeping the sum so the loop isn't optimized away
+    {
+        constexpr u32 SIDE = 128;
+        u64 checksum = 0;
+        const f64 encode_ms = best_of([&]() {
+            for (u32 z = 0; z < SIDE; z++) {
+                for (u32 y = 0; y < SIDE; y++) {
+                    for (u32 x = 0; x < SIDE; x++) {
+                        checksum += MortonEncode(x, y, z);
+                    }
+                }
+            }
+        });
+        const f64 portable_ms = best_of([&]() {
+            for (u32 z = 0; z < SIDE; z++) {
+                for (u32 y = 0; y < SIDE; y++) {
+                    for (u32 x = 0; x < SIDE; x++) {
+                        checksum += MortonEncodePortable(x, y, z);
+                    }
+                }
+            }
+        });
+#ifdef MORTON_BMI2
+        const char *path = "bmi2";
+#else
+        const char *path = "portable";
+#endif
+        printf("MortonEncode (%s) %.2f ns, portable %.2f ns per code (checksum %llx)\n", path,
+            encode_ms * 1e6 / (SIDE * SIDE * SIDE), portable_ms * 1e6 / (SIDE * SIDE * SIDE),
+            (unsigned long long)checksum);
+    }
+
+    printf("%-24s %12s %14s %12s %14s %16s %16s\n", "file", "particles", "neighbors ms", "linear ms", "z-order ms",
+        "linear misses", "z-order misses");
+    for (const auto &path : paths) {
+        const Mesh mesh = LoadObjParallel(path.string().c_str());
+        VoxelGrid grid = CreateGridForBounds(ComputeBounds(mesh.vertices), resolution);
+        VoxelizeSolid(mesh, grid);
+        const glm::uvec3 dimensions = grid.Dimensions();
+
+        // Row major particles, neighbours through a dense index per voxel
+        ParticleSet linear;
+        std::vector<u32> voxel_to_particle(grid.VoxelCount(), ZOrderVoxels::NO_VOXEL);
+        for (u32 z = 0; z < dimensions.z; z++) {
+            for (u32 y = 0; y < dimensions.y; y++) {
+                for (u32 x = 0; x < dimensions.x; x++) {
+                    if (grid.Get(x, y, z)) {
+                        voxel_to_particle[((Size)z * dimensions.y + y) * dimensions.x + x] =
+                            (u32)linear.positions.size();
+                        linear.positions.push_back(grid.VoxelCenter(x, y, z));
+                    }
+                }
+            }
+        }
+        const auto particle_at = [&](glm::ivec3 voxel) {
+            if (voxel.x < 0 || voxel.y < 0 || voxel.z < 0 || (u32)voxel.x >= dimensions.x
+                || (u32)voxel.y >= dimensions.y || (u32)voxel.z >= dimensions.z) {
+                return ZOrderVoxels::NO_VOXEL;
+            }
+            return voxel_to_particle[((Size)voxel.z * dimensions.y + voxel.y) * dimensions.x + voxel.x];
+        };
+        linear.neighbors.resize(linear.positions.size() * 6);
+        for (u32 z = 0, particle = 0; z < dimensions.z; z++) {
+            for (u32 y = 0; y < dimensions.y; y++) {
+                for (u32 x = 0; x < dimensions.x; x++) {
+                    if (!grid.Get(x, y, z)) {
+                        continue;
+                    }
+                    for (u32 axis = 0, k = 0; axis < 3; axis++) {
+                        for (s32 direction : {-1, 1}) {
+                            glm::ivec3 neighbor(x, y, z);
+                            neighbor[axis] += direction;
+                            linear.neighbors[(Size)particle * 6 + k++] = particle_at(neighbor);
+                        }
+                    }
+                    particle++;
+                }
+            }
+        }
+        voxel_to_particle = {};
+
+        // Z-order particles, neighbours by stepping Morton codes
+        const ZOrderVoxels voxels(grid);
+        ParticleSet z_order;
+        z_order.positions.resize(voxels.Count());
+        z_order.neighbors.resize((Size)voxels.Count() * 6);
+        const f64 neighbors_ms = best_of([&]() {
+            ParallelFor(
+                voxels.Count(),
+                [&](Size i) {
+                    for (u32 axis = 0, k = 0; axis < 3; axis++) {
+                        for (s32 direction : {-1, 1}) {
+                            z_order.neighbors[i * 6 + k++] = voxels.Neighbor((u32)i, axis, direction);
+                        }
+                    }
+                },
+                MIN_PARTICLES_PER_RANGE);
+        });
+        for (u32 i = 0; i < voxels.Count(); i++) {
+            const glm::uvec3 coordinate = voxels.Coordinate(i);
+            z_order.positions[i] = grid.VoxelCenter(coordinate.x, coordinate.y, coordinate.z);
+        }
+
+        // Positions are reset outside the timed part, only the sweeps count
+        const auto time_sweeps = [&](const ParticleSet &particles) {
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec3> scratch(particles.positions.size());
+            f64 best = std::numeric_limits<f64>::max();
+            for (u32 i = 0; i < ITERATIONS; i++) {
+                positions = particles.positions;
+                const auto start = Clock::now();
+                for (u32 sweep = 0; sweep < SWEEPS; sweep++) {
+                    SmoothParticles(particles.neighbors, positions, scratch);
+                    positions.swap(scratch);
+                }
+                best = std::min(best, std::chrono::duration<f64, std::milli>(Clock::now() - start).count());
+            }
+            return best;
+        };
+        const f64 linear_ms = time_sweeps(linear);
+        const f64 z_order_ms = time_sweeps(z_order);
+        printf("%-24s %12zu %14.3f %12.3f %14.3f %16.3f %16.3f\n", path.filename().string().c_str(),
+            linear.positions.size(), neighbors_ms, linear_ms, z_order_ms, SimulatedMissesPerParticle(linear),
+            SimulatedMissesPerParticle(z_order));
+    }
+}
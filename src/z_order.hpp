@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.h"
+#include "morton.hpp"
+#include "voxel_grid.hpp"
+
+#include <glm/vec3.hpp>
+#include <span>
+#include <vector>
+
+// The solid voxels of a grid listed along the Morton curve. Arrays indexed the same way, e.g. one particle per voxel,
+// keep voxels that are close in 3D close in memory, which a row major order only does along x.
+class ZOrderVoxels
+{
+  public:
+    static constexpr u32 NO_VOXEL = 0xFFFFFFFF;
+
+    ZOrderVoxels() = default;
+    explicit ZOrderVoxels(const VoxelGrid &grid);
+
+    u32 Count() const { return (u32)m_codes.size(); }
+    std::span<const u64> Codes() const { return m_codes; }
+    glm::uvec3 Coordinate(u32 index) const { return MortonDecode(m_codes[index]); }
+
+    // Index of the voxel with this code, searching outwards from hint since neighbours are usually nearby
+    u32 Find(u64 code, u32 hint = 0) const;
+    // Face neighbour along axis in direction -1 or 1, NO_VOXEL when it's empty or outside the grid. Steps the code
+    // without decoding it.
+    u32 Neighbor(u32 index, u32 axis, s32 direction) const;
+
+  private:
+    std::vector<u64> m_codes;
+};
+
+// order[i] is the index of the coordinate that comes i-th along the Morton curve
+std::vector<u32> ZOrderPermutation(std::span<const glm::uvec3> coordinates);
+
+// Gathers values into the order of a permutation, result[i] = values[order[i]]
+template<typename T>
+std::vector<T> ApplyPermutation(std::span<const T> values, std::span<const u32> order)
+{
+    std::vector<T> result(order.size());
+    for (Size i = 0; i < order.size(); i++) {
+        result[i] = values[order[i]];
+    }
+    return result;
+}
+
+// Runs a Jacobi style smoothing pass over one particle per solid voxel, once with the particles in row major order and
+// once in Z-order, for every .obj in directory
+void BenchmarkZOrder(const char *directory, u32 resolution);